@@ -14,6 +14,9 @@
 #include <QtWidgets/qtoolbutton.h>
 #include <QtWidgets/qtreeview.h>
 #include <QtWidgets/qlineedit.h>
+#include <QtWidgets/qmessagebox.h>
+#include <QtWidgets/qprogressbar.h>
+#include <QtWidgets/qstatusbar.h>
 
 #include <QtGui/qpainter.h>
 #include <QtGui/qevent.h>
@@ -91,6 +94,12 @@ namespace TreeReaderApp
       _filteringTimer = new QTimer(this);
       _filteringTimer->setSingleShot(true);
 
+      _loadingTimer = new QTimer(this);
+      _loadingTimer->setSingleShot(true);
+
+      _savingTimer = new QTimer(this);
+      _savingTimer->setSingleShot(true);
+
       QToolBar* toolbar = new QToolBar();
          toolbar->setIconSize(QSize(32, 32));
 
@@ -156,6 +165,30 @@ namespace TreeReaderApp
       addToolBar(toolbar);
       addDockWidget(Qt::DockWidgetArea::LeftDockWidgetArea, filtersDock);
       addDockWidget(Qt::DockWidgetArea::TopDockWidgetArea, simpleSearchDock);
+
+      _loadingProgress = new QProgressBar;
+      _loadingProgress->setRange(0, 100);
+      _loadingProgress->setFormat(QString::fromWCharArray(L::t(L"Loading %p%")));
+      _loadingProgress->hide();
+      statusBar()->addPermanentWidget(_loadingProgress);
+
+      _savingProgress = new QProgressBar;
+      _savingProgress->setRange(0, 100);
+      _savingProgress->setFormat(QString::fromWCharArray(L::t(L"Saving %p%")));
+      _savingProgress->hide();
+      statusBar()->addPermanentWidget(_savingProgress);
+
+      _cancelSavingButton = new QToolButton;
+      _cancelSavingButton->setText(QString::fromWCharArray(L::t(L"Cancel")));
+      _cancelSavingButton->setToolTip(QString::fromWCharArray(L::t(L"Stop saving the filtered tree")));
+      _cancelSavingButton->hide();
+      statusBar()->addPermanentWidget(_cancelSavingButton);
+
+      _filteringProgress = new QProgressBar;
+      _filteringProgress->setRange(0, 100);
+      _filteringProgress->hide();
+      statusBar()->addPermanentWidget(_filteringProgress);
+
       setWindowIcon(QIcon(QtWin::fromHICON((HICON)::LoadImage(GetModuleHandle(0), MAKEINTRESOURCE(IDI_APP_ICON), IMAGE_ICON, 256, 256, 0))));
    }
 
@@ -170,6 +203,23 @@ namespace TreeReaderApp
          self->verifyAsyncFiltering();
       });
 
+      _loadingTimer->connect(_loadingTimer, &QTimer::timeout, [self = this]()
+      {
+         self->verifyAsyncLoading();
+      });
+
+      _savingTimer->connect(_savingTimer, &QTimer::timeout, [self = this]()
+      {
+         self->verifyAsyncSaving();
+      });
+
+      _cancelSavingButton->connect(_cancelSavingButton, &QToolButton::clicked, [self = this]()
+      {
+         // Note: cancelling the saving also cancels closing the window after it.
+         self->_closeWhenSaved = false;
+         self->_data.AbortAsyncSave();
+      });
+
       _data.UndoRedo().Changed = [self = this](UndoStack&)
       {
          self->UpdateUndoRedoActions();
@@ -273,6 +323,11 @@ namespace TreeReaderApp
          newTree = _data.GetCurrentTree();
       }
 
+      FillTextTreeUI(newTree);
+   }
+
+   void MainWindow::FillTextTreeUI(const shared_ptr<TextTree>& newTree)
+   {
       if (!_treeView->model() || !dynamic_cast<TextTreeModel*>(_treeView->model()) || dynamic_cast<TextTreeModel*>(_treeView->model())->Tree != newTree)
       {
          TextTreeModel* model = new TextTreeModel;
@@ -297,6 +352,7 @@ namespace TreeReaderApp
       _availableFiltersList->AddTreeFilter(Stop());
       _availableFiltersList->AddTreeFilter(Until(nullptr));
       _availableFiltersList->AddTreeFilter(Contains(L""));
+      _availableFiltersList->AddTreeFilter(ContainsAny(L""));
       _availableFiltersList->AddTreeFilter(Regex(L""));
       _availableFiltersList->AddTreeFilter(Not(nullptr));
       _availableFiltersList->AddTreeFilter(Any(vector<TreeFilterPtr>()));
@@ -349,7 +405,17 @@ namespace TreeReaderApp
 
    void MainWindow::closeEvent(QCloseEvent* ev)
    {
-      if (SaveIfRequired(L::t(L"close the window"), L::t(L"closing the window")))
+      // Note: while the filtered tree is being saved, the window is only closed once it is saved.
+      if (!_data.GetAsyncSaveProgress() && !SaveIfRequired(L::t(L"close the window"), L::t(L"closing the window")))
+      {
+         ev->ignore();
+      }
+      else if (_data.GetAsyncSaveProgress())
+      {
+         _closeWhenSaved = true;
+         ev->ignore();
+      }
+      else
       {
          try
          {
@@ -372,6 +438,8 @@ namespace TreeReaderApp
          try
          {
             _data.AbortAsyncFilter();
+            _data.AbortAsyncLoad();
+            _data.AbortTreeIndexing();
          }
          catch (const exception&)
          {
@@ -380,10 +448,6 @@ namespace TreeReaderApp
 
          QWidget::closeEvent(ev);
       }
-      else
-      {
-         ev->ignore();
-      }
    }
 
    bool MainWindow::SaveIfRequired(const wstring& action, const wstring& actioning)
@@ -410,12 +474,35 @@ namespace TreeReaderApp
          return;
 
       filesystem::path path = AskOpen(L::t(L"Load Text Tree"), L::t(TreeFileTypes), this);
-      _data.LoadTree(path);
-
-      if (_data.GetCurrentTree() == nullptr)
+      if (path.empty())
          return;
 
-      FillTextTreeUI();
+      _data.LoadTreeAsync(path);
+      _loadingTimer->start(50);
+   }
+
+   void MainWindow::verifyAsyncLoading()
+   {
+      if (_data.IsAsyncLoadReady())
+      {
+         _loadingProgress->hide();
+         FillTextTreeUI();
+      }
+      else if (auto progress = _data.GetAsyncLoadProgress())
+      {
+         // Note: the part of the tree loaded so far can be browsed while the rest is loading.
+         if (auto partial = _data.GetPartiallyLoadedTree())
+            FillTextTreeUI(partial);
+
+         _loadingProgress->setValue(int(progress->GetFraction() * 100));
+         _loadingProgress->show();
+         _loadingTimer->start(50);
+      }
+      else
+      {
+         // Note: the loading was aborted, for example by loading another tree.
+         _loadingProgress->hide();
+      }
    }
 
    bool MainWindow::SaveFilteredTree()
@@ -424,12 +511,56 @@ namespace TreeReaderApp
          return true;
 
       filesystem::path path = AskSave(L::t(L"Save Filtered Text Tree"), L::t(TreeFileTypes), L"",  this);
+      if (path.empty())
+         return false;
 
-      _data.SaveFilteredTree(path);
+      _data.SaveFilteredTreeAsync(path);
+      _savingTimer->start(50);
 
       return true;
    }
 
+   void MainWindow::verifyAsyncSaving()
+   {
+      try
+      {
+         if (_data.IsAsyncSaveReady())
+         {
+            _savingProgress->hide();
+            _cancelSavingButton->hide();
+
+            // Note: closing can still be cancelled when asked to save again,
+            //       so a later saving must not close the window.
+            if (_closeWhenSaved)
+            {
+               _closeWhenSaved = false;
+               close();
+            }
+         }
+         else if (auto progress = _data.GetAsyncSaveProgress())
+         {
+            _savingProgress->setValue(int(progress->GetFraction() * 100));
+            _savingProgress->show();
+            _cancelSavingButton->show();
+            _savingTimer->start(50);
+         }
+         else
+         {
+            // Note: the saving was cancelled, for example by saving again.
+            _savingProgress->hide();
+            _cancelSavingButton->hide();
+         }
+      }
+      catch (const exception&)
+      {
+         _savingProgress->hide();
+         _cancelSavingButton->hide();
+         _closeWhenSaved = false;
+
+         QMessageBox::warning(this, QString::fromWCharArray(L::t(L"Save Filtered Text Tree")), QString::fromWCharArray(L::t(L"The filtered tree could not be saved.")));
+      }
+   }
+
    /////////////////////////////////////////////////////////////////////////
    //
    // Tree filtering.
@@ -450,12 +581,20 @@ namespace TreeReaderApp
    {
       if (_data.IsAsyncFilterReady())
       {
+         _filteringProgress->hide();
          FillTextTreeUI();
       }
-      else
+      else if (auto progress = _data.GetAsyncFilterProgress())
       {
+         _filteringProgress->setValue(int(progress->GetFraction() * 100));
+         _filteringProgress->show();
          _filteringTimer->start(10);
       }
+      else
+      {
+         // Note: the filtering was aborted, for example by loading another tree.
+         _filteringProgress->hide();
+      }
    }
 
    void MainWindow::SearchInTree(const QString& text)
@@ -13,6 +13,7 @@ class QAction;
 class QTreeView;
 class QDockWidget;
 class QTimer;
+class QProgressBar;
 class QLineEdit;
 
 namespace TreeReaderApp
@@ -43,6 +44,7 @@ namespace TreeReaderApp
       // Fill the UI with the intial data.
       void FillUI();
       void FillTextTreeUI();
+      void FillTextTreeUI(const std::shared_ptr<TreeReader::TextTree>& newTree);
       void FillFilterEditorUI();
       void FillAvailableFiltersUI();
 
@@ -53,7 +55,9 @@ namespace TreeReaderApp
       void closeEvent(QCloseEvent* ev);
       bool SaveIfRequired(const std::wstring& action, const std::wstring& actioning);
       void LoadTree();
+      void verifyAsyncLoading();
       bool SaveFilteredTree();
+      void verifyAsyncSaving();
 
       // Tree filtering.
       void FilterTree();
@@ -97,6 +101,15 @@ namespace TreeReaderApp
       TreeFilterListWidget* _availableFiltersList = nullptr;
       QWidgetScrollListWidget* _scrollFiltersList = nullptr;
       QTimer* _filteringTimer = nullptr;
+      QProgressBar* _filteringProgress = nullptr;
+      QTimer* _loadingTimer = nullptr;
+      QProgressBar* _loadingProgress = nullptr;
+      QTimer* _savingTimer = nullptr;
+      QProgressBar* _savingProgress = nullptr;
+      QToolButton* _cancelSavingButton = nullptr;
+
+      // Close the window once the filtered tree being saved is saved.
+      bool _closeWhenSaved = false;
    };
 }
 
@@ -4,7 +4,8 @@ namespace TreeReaderApp
 {
    using namespace std;
    using namespace TreeReader;
-   using Node = TextTree::Node;
+
+   // Note: the internal id of the model indexes is the index of the node.
 
    QVariant TextTreeModel::data(const QModelIndex& index, int role) const
    {
@@ -17,11 +18,12 @@ namespace TreeReaderApp
       if (!index.isValid())
          return QVariant();
 
-      const Node* node = static_cast<Node*>(index.internalPointer());
-      if (!node)
+      const NodeIndex node = NodeIndex(index.internalId());
+      if (node == InvalidNode)
          return QVariant();
 
-      return QVariant(QString::fromWCharArray(node->TextPtr));
+      const string_view text = Tree->GetText(node);
+      return QVariant(QString::fromUtf8(text.data(), int(text.size())));
    }
 
    QVariant TextTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -34,12 +36,12 @@ namespace TreeReaderApp
       if (!Tree)
          return QModelIndex();
 
-      const Node* parentNode = parent.isValid() ? static_cast<Node*>(parent.internalPointer()) : nullptr;
-      const std::vector<Node*>& nodes = parentNode ? parentNode->Children : Tree->Roots;
-      if (row < 0 || row >= nodes.size())
+      const NodeIndex parentNode = parent.isValid() ? NodeIndex(parent.internalId()) : InvalidNode;
+      const vector<NodeIndex>& children = GetChildren(parentNode);
+      if (row < 0 || size_t(row) >= children.size())
          return QModelIndex();
 
-      return createIndex(row, column, static_cast<void*>(nodes[row]));
+      return createIndex(row, column, quintptr(children[row]));
    }
 
    QModelIndex TextTreeModel::parent(const QModelIndex& index) const
@@ -50,14 +52,15 @@ namespace TreeReaderApp
       if (!index.isValid())
          return QModelIndex();
 
-      const Node* node = static_cast<Node*>(index.internalPointer());
-      if (!node)
+      const NodeIndex node = NodeIndex(index.internalId());
+      if (node == InvalidNode)
          return QModelIndex();
 
-      if (!node->Parent)
+      const NodeIndex parentNode = Tree->GetParent(node);
+      if (parentNode == InvalidNode)
          return QModelIndex();
 
-      return createIndex(int(node->IndexInParent), 0, static_cast<void*>(node->Parent));
+      return createIndex(int(Tree->GetIndexInParent(parentNode)), 0, quintptr(parentNode));
    }
 
    int TextTreeModel::rowCount(const QModelIndex& parent) const
@@ -66,18 +69,33 @@ namespace TreeReaderApp
          return 0;
 
       if (!parent.isValid())
-         return int(Tree->Roots.size());
+         return int(Tree->CountChildren(InvalidNode));
 
-      const Node* node = static_cast<Node*>(parent.internalPointer());
-      if (!node)
+      const NodeIndex node = NodeIndex(parent.internalId());
+      if (node == InvalidNode)
          return 0;
 
-      return int(node->Children.size());
+      return int(Tree->CountChildren(node));
    }
+
    int TextTreeModel::columnCount(const QModelIndex& parent) const
    {
       if (!Tree)
          return 0;
       return 1;
    }
+
+   const vector<NodeIndex>& TextTreeModel::GetChildren(NodeIndex node) const
+   {
+      auto pos = _children.find(node);
+      if (pos != _children.end())
+         return pos->second;
+
+      vector<NodeIndex>& children = _children[node];
+      children.reserve(Tree->CountChildren(node));
+      for (NodeIndex child = Tree->GetFirstChild(node); child != InvalidNode; child = Tree->GetNextSibling(child))
+         children.emplace_back(child);
+
+      return children;
+   }
 }
@@ -3,12 +3,18 @@
 #include <QtCore/qabstractitemmodel.h>
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace TreeReaderApp
 {
    ////////////////////////////////////////////////////////////////////////////
    //
    // Tree model containing all lines of a text tree.
+   //
+   // The tree nodes only know their first child and next sibling,
+   // so the children of each node shown are gathered the first time
+   // they are needed to access them by row.
 
    struct TextTreeModel : QAbstractItemModel
    {
@@ -20,6 +26,11 @@ namespace TreeReaderApp
       QModelIndex parent(const QModelIndex& index) const override;
       int rowCount(const QModelIndex& parent = QModelIndex()) const override;
       int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+   private:
+      const std::vector<TreeReader::NodeIndex>& GetChildren(TreeReader::NodeIndex node) const;
+
+      mutable std::unordered_map<TreeReader::NodeIndex, std::vector<TreeReader::NodeIndex>> _children;
    };
 }
 
@@ -58,6 +58,11 @@ namespace TreeReaderApp
          return new TreeFilterListItem(filter, delFunc, editFunc, &filter->Contained);
       }
 
+      TreeFilterListItem* CreateFilterPanel(const shared_ptr<ContainsAnyTreeFilter>& filter, DeleteCallbackFunction delFunc, EditCallbackFunction editFunc)
+      {
+         return new TreeFilterListItem(filter, delFunc, editFunc, &filter->Contained);
+      }
+
       TreeFilterListItem* CreateFilterPanel(const shared_ptr<RegexTreeFilter>& filter, DeleteCallbackFunction delFunc, EditCallbackFunction editFunc)
       {
          return new TreeFilterListItem(filter, delFunc, editFunc, &filter->RegexTextForm);
@@ -134,6 +139,7 @@ namespace TreeReaderApp
          CALL_CONVERTER(StopTreeFilter)
          CALL_CONVERTER(UntilTreeFilter)
          CALL_CONVERTER(ContainsTreeFilter)
+         CALL_CONVERTER(ContainsAnyTreeFilter)
          CALL_CONVERTER(RegexTreeFilter)
          CALL_CONVERTER(NotTreeFilter)
          CALL_CONVERTER(IfSubTreeTreeFilter)
@@ -1,4 +1,6 @@
 #include "BuffersTextHolder.h"
+#include "TreeReaderHelpers.h"
+#include "LineScanner.h"
 
 #include <algorithm>
 
@@ -6,65 +8,117 @@ namespace TreeReader
 {
    using namespace std;
 
-   pair<wchar_t*, size_t> BuffersTextHolderReader::ReadLine(wistream& stream)
+   string_view BuffersTextHolder::AddText(string_view text)
    {
-      bool skipNewLines = true;
+      // Note: the buffers are never grown past their capacity, so the text already
+      //       in them never moves.
+      if (TextBuffers.empty() || TextBuffers.back()->capacity() - TextBuffers.back()->size() < text.size())
+      {
+         TextBuffers.emplace_back(make_shared<Buffer>());
+         TextBuffers.back()->reserve(max(size_t(64 * 1024), text.size()));
+      }
 
-      wchar_t* line = PosInBuffer;
+      Buffer& buffer = *TextBuffers.back();
+      const size_t start = buffer.size();
+      buffer.insert(buffer.end(), text.begin(), text.end());
+      return string_view(buffer.data() + start, text.size());
+   }
+
+   pair<char*, size_t> BuffersTextHolderReader::ReadLine(wistream& stream)
+   {
+      // Skip the end-of-line characters, which also skips empty lines.
       while (true)
       {
-         if (PosInBuffer >= BufferEnd)
-         {
-            // Record how much we will need to transfer between the buffer
-            // and how big the new buffer must be.
-            const size_t amountReadSoFar = PosInBuffer - line;
-            const size_t bufferSize = max(size_t(64 * 1024), amountReadSoFar * 2);
-
-            // Allocate new buffer.
-            Holder->TextBuffers.emplace_back(make_shared<BuffersTextHolder::Buffer>());
-            auto buffer = Holder->TextBuffers.back();
-            // Note: allocate one more character to be able to always put a terminating null.
-            buffer->resize(bufferSize + 1);
-
-            // Copy over the data that was reasd so far in th eprevious buffer.
-            if (amountReadSoFar > 0)
-               std::copy(line, line + amountReadSoFar, buffer->data());
-
-            // Adjust the variable to point into the new buffer.
-            line = buffer->data();
-            BufferEnd = line + bufferSize;
-            PosInBuffer = line + amountReadSoFar;
-
-            // Fill the empty part of the new buffer.
-            // Stop if there was nothign left to read.
-            stream.read(PosInBuffer, BufferEnd - PosInBuffer);
-            const auto readAmount = stream.gcount();
-            if (readAmount <= 0)
-               break;
-            BufferEnd = PosInBuffer + readAmount;
-         }
+         if (PosInBuffer >= BufferEnd && !ReadMore(stream, PosInBuffer))
+            return make_pair(PosInBuffer, 0);
+
+         if (*PosInBuffer != '\n' && *PosInBuffer != '\r')
+            break;
+
+         ++PosInBuffer;
+      }
 
-         if (skipNewLines)
+      char* line = PosInBuffer;
+      while (true)
+      {
+         PosInBuffer = FindEndOfLine(PosInBuffer, BufferEnd);
+         if (PosInBuffer < BufferEnd)
          {
-            if (*PosInBuffer != '\n' && *PosInBuffer != '\r')
-            {
-               line = PosInBuffer;
-               skipNewLines = false;
-            }
+            *PosInBuffer = 0;
+            const size_t count = PosInBuffer - line;
+            ++PosInBuffer;
+            return make_pair(line, count);
          }
-         else
+
+         // Note: the last line of the text is terminated by the null
+         //       always put after the text in the buffer.
+         if (!ReadMore(stream, line))
+            break;
+      }
+
+      return make_pair(line, PosInBuffer - line);
+   }
+
+   bool BuffersTextHolderReader::ReadMore(wistream& stream, char*& line)
+   {
+      // Read the next chunk of wide text, after any surrogate kept from the previous chunk.
+      const size_t wideChunkSize = 16 * 1024;
+      _wideText.resize(wideChunkSize);
+
+      size_t wideCount = 0;
+      if (_pendingHighSurrogate)
+      {
+         _wideText[wideCount++] = _pendingHighSurrogate;
+         _pendingHighSurrogate = 0;
+      }
+
+      stream.read(_wideText.data() + wideCount, wideChunkSize - wideCount);
+      const auto readAmount = stream.gcount();
+      if (readAmount > 0)
+         wideCount += readAmount;
+
+      if (wideCount <= 0)
+         return false;
+
+      // Keep a trailing high surrogate for the next chunk to avoid splitting a surrogate pair.
+      if constexpr (sizeof(wchar_t) == 2)
+      {
+         const wchar_t last = _wideText[wideCount - 1];
+         if (readAmount > 0 && wideCount > 1 && last >= 0xD800 && last < 0xDC00)
          {
-            if (*PosInBuffer == '\n' || *PosInBuffer == '\r')
-            {
-               *PosInBuffer = 0;
-               PosInBuffer++;
-               break;
-            }
+            _pendingHighSurrogate = last;
+            --wideCount;
          }
+      }
 
-         ++PosInBuffer;
+      // Move to a new buffer if the converted text might not fit in the current one.
+      // Note: keep room for one more character to be able to always put a terminating null.
+      const size_t neededSize = wideCount * MaxUtf8PerWideChar + 1;
+      if (!BufferEnd || size_t(_bufferLimit - BufferEnd) < neededSize)
+      {
+         // Record how much we will need to transfer between the buffer
+         // and how big the new buffer must be.
+         const size_t amountReadSoFar = PosInBuffer - line;
+         const size_t bufferSize = max(size_t(64 * 1024), (amountReadSoFar + neededSize) * 2);
+
+         // Allocate new buffer.
+         Holder->TextBuffers.emplace_back(make_shared<BuffersTextHolder::Buffer>(bufferSize));
+         auto buffer = Holder->TextBuffers.back();
+
+         // Copy over the data that was read so far in the previous buffer.
+         if (amountReadSoFar > 0)
+            std::copy(line, line + amountReadSoFar, buffer->data());
+
+         // Adjust the variable to point into the new buffer.
+         line = buffer->data();
+         PosInBuffer = line + amountReadSoFar;
+         BufferEnd = PosInBuffer;
+         _bufferLimit = line + bufferSize;
       }
 
-      return make_pair(line, PosInBuffer - line);
+      BufferEnd = ConvertToUtf8(_wideText.data(), _wideText.data() + wideCount, BufferEnd);
+      *BufferEnd = 0;
+
+      return true;
    }
 }
@@ -2,6 +2,8 @@
 
 #include "TextTree.h"
 
+#include <string_view>
+
 namespace TreeReader
 {
    // Holds text as a vector of raw characters buffers.
@@ -9,22 +11,42 @@ namespace TreeReader
 
    struct BuffersTextHolder : TextHolder
    {
-      typedef std::vector<wchar_t> Buffer;
+      typedef std::vector<char> Buffer;
       typedef std::shared_ptr<Buffer> BufferPtr;
       typedef std::vector<BufferPtr> Buffers;
 
       Buffers TextBuffers;
+
+      // Copy the text after the text of the last buffer and return the copy.
+      // A new large buffer is only added when the last one is full, so that
+      // keeping many small texts takes few allocations.
+      std::string_view AddText(std::string_view text);
    };
 
    // Read text lines from an input stream and stores them in the holder.
+   //
+   // The wide text that is read is converted to UTF-8.
 
    struct BuffersTextHolderReader
    {
       std::shared_ptr<BuffersTextHolder> Holder = std::make_shared<BuffersTextHolder>();
 
-      wchar_t* PosInBuffer = nullptr;
-      wchar_t* BufferEnd = nullptr;
+      char* PosInBuffer = nullptr;
+      char* BufferEnd = nullptr;
+
+      // Read the next non-empty line.
+      // Returns the null-terminated line and its length, excluding the terminating null.
+      // Returns a zero length when there are no more lines.
+      std::pair<char*, size_t> ReadLine(std::wistream& stream);
+
+   private:
+      // Read more text at the end of the buffer, keeping the partial line that starts
+      // at the given position. Moves to a new buffer if there is not enough room.
+      // Returns false when there was nothing left to read.
+      bool ReadMore(std::wistream& stream, char*& line);
 
-      std::pair<wchar_t*, size_t> ReadLine(std::wistream& stream);
+      char* _bufferLimit = nullptr;
+      std::vector<wchar_t> _wideText;
+      wchar_t _pendingHighSurrogate = 0;
    };
 }
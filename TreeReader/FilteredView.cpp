@@ -0,0 +1,163 @@
+#include "FilteredView.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace TreeReader
+{
+   using namespace std;
+   using Result = TreeVisitor::Result;
+
+   FilteredView::FilteredView(const TextTree& sourceTree)
+   {
+      Reset(sourceTree);
+   }
+
+   void FilteredView::Reset(const TextTree& sourceTree)
+   {
+      SourceTree = sourceTree;
+      SourceTree.Freeze();
+
+      _kept.assign((SourceTree.CountNodes() + 63) / 64, 0);
+   }
+
+   void FilteredView::KeepAll()
+   {
+      fill(_kept.begin(), _kept.end(), ~uint64_t(0));
+
+      // Note: the bits past the last node are left cleared, so counting the nodes stays exact.
+      const size_t lastBits = SourceTree.CountNodes() % 64;
+      if (lastBits)
+         _kept.back() = (uint64_t(1) << lastBits) - 1;
+   }
+
+   size_t FilteredView::CountNodes() const
+   {
+      size_t count = 0;
+      for (const uint64_t bits : _kept)
+         count += popcount(bits);
+      return count;
+   }
+
+   NodeIndex FilteredView::FindKept(NodeIndex begin, NodeIndex end) const
+   {
+      if (begin >= end)
+         return InvalidNode;
+
+      // Note: the bits before the beginning are masked in the first word.
+      size_t word = begin / 64;
+      uint64_t bits = _kept[word] & (~uint64_t(0) << (begin % 64));
+      const size_t lastWord = (end - 1) / 64;
+      while (!bits)
+      {
+         if (++word > lastWord)
+            return InvalidNode;
+         bits = _kept[word];
+      }
+
+      const NodeIndex found = NodeIndex(word * 64 + countr_zero(bits));
+      return found < end ? found : InvalidNode;
+   }
+
+   NodeIndex FilteredView::GetSubTreeEnd(NodeIndex node) const
+   {
+      return node == InvalidNode ? NodeIndex(SourceTree.CountNodes()) : SourceTree.GetSubTreeEnd(node);
+   }
+
+   NodeIndex FilteredView::GetParent(NodeIndex node) const
+   {
+      NodeIndex parent = SourceTree.GetParent(node);
+      while (parent != InvalidNode && !IsKept(parent))
+         parent = SourceTree.GetParent(parent);
+      return parent;
+   }
+
+   NodeIndex FilteredView::GetFirstChild(NodeIndex node) const
+   {
+      // Note: the first kept node of the sub-tree has no other kept ancestor in the sub-tree.
+      const NodeIndex begin = (node == InvalidNode) ? 0 : node + 1;
+      return FindKept(begin, GetSubTreeEnd(node));
+   }
+
+   NodeIndex FilteredView::GetNextSibling(NodeIndex node) const
+   {
+      // Note: the first kept node after the sub-tree of the node, within the sub-tree
+      //       of its parent, is the next child of that parent.
+      return FindKept(SourceTree.GetSubTreeEnd(node), GetSubTreeEnd(GetParent(node)));
+   }
+
+   TextTree FilteredView::CreateTree() const
+   {
+      vector<string_view> texts;
+      vector<NodeIndex> parents;
+
+      // The sub-tree end and the index in the new tree of the current kept ancestors.
+      vector<pair<NodeIndex, NodeIndex>> ancestors;
+
+      const NodeIndex end = NodeIndex(SourceTree.CountNodes());
+      for (NodeIndex node = FindKept(0, end); node != InvalidNode; node = FindKept(node + 1, end))
+      {
+         while (!ancestors.empty() && node >= ancestors.back().first)
+            ancestors.pop_back();
+
+         parents.emplace_back(ancestors.empty() ? InvalidNode : ancestors.back().second);
+         ancestors.emplace_back(SourceTree.GetSubTreeEnd(node), NodeIndex(texts.size()));
+         texts.emplace_back(SourceTree.GetText(node));
+      }
+
+      TextTree tree;
+      tree.SourceTextLines = SourceTree.SourceTextLines;
+      tree.AddNodes(texts, parents);
+      tree.Freeze();
+      return tree;
+   }
+
+   void VisitInOrder(const FilteredView& view, TreeVisitor& visitor)
+   {
+      VisitRangeInOrder(view, 0, NodeIndex(view.SourceTree.CountNodes()), visitor);
+   }
+
+   void VisitRangeInOrder(const FilteredView& view, NodeIndex begin, NodeIndex end, TreeVisitor& visitor)
+   {
+      const TextTree& tree = view.SourceTree;
+
+      // The ends of the sub-trees of the kept ancestors, one per level.
+      vector<NodeIndex> subTreeEnds;
+
+      NodeIndex pos = view.FindKept(begin, end);
+      while (pos != InvalidNode)
+      {
+         const Result result = visitor.Visit(tree, pos, subTreeEnds.size());
+         if (result.Stop)
+            return;
+
+         const NodeIndex subTreeEnd = tree.GetSubTreeEnd(pos);
+         const NodeIndex next = view.FindKept(result.SkipChildren ? subTreeEnd : pos + 1, end);
+
+         if (next != InvalidNode && next < subTreeEnd)
+         {
+            subTreeEnds.push_back(subTreeEnd);
+            if (visitor.GoDeeper(subTreeEnds.size()).Stop)
+               return;
+         }
+         else
+         {
+            const NodeIndex nextPos = (next == InvalidNode) ? end : next;
+            while (!subTreeEnds.empty() && nextPos >= subTreeEnds.back())
+            {
+               subTreeEnds.pop_back();
+               if (visitor.GoHigher(subTreeEnds.size()).Stop)
+                  return;
+            }
+         }
+
+         pos = next;
+      }
+   }
+
+   void VisitInOrder(const FilteredView& view, const NodeVisitFunction& func)
+   {
+      FunctionTreeVisitor visitor(func);
+      VisitInOrder(view, visitor);
+   }
+}
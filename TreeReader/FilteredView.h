@@ -0,0 +1,90 @@
+#pragma once
+
+#include "TextTree.h"
+#include "TextTreeVisitor.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace TreeReader
+{
+   // A filtered view of a text tree.
+   //
+   // Instead of copying the kept nodes in a new tree, the view keeps one bit
+   // per node of the source tree, telling if the node is kept. The parent of
+   // a kept node is its nearest kept ancestor, so the view has the same shape
+   // as the tree that filtering into a text tree produces.
+   //
+   // The nodes of the view are designated by their index in the source tree.
+   // The source tree is frozen, so that the kept nodes of a sub-tree can be
+   // found by scanning the bits over the range of the sub-tree.
+
+   struct FilteredView
+   {
+      // The source tree, frozen.
+      // Note: the copy of the tree shares the nodes of the tree.
+      TextTree SourceTree;
+
+      FilteredView() = default;
+      FilteredView(const TextTree& sourceTree);
+
+      // Reset the view over the given source tree, with no node kept.
+      void Reset(const TextTree& sourceTree);
+
+      // Keep all the nodes of the source tree.
+      void KeepAll();
+
+      // Keep a node of the source tree.
+      void Keep(NodeIndex node) { _kept[node / 64] |= std::uint64_t(1) << (node % 64); }
+
+      // Verify if a node of the source tree is kept.
+      bool IsKept(NodeIndex node) const { return (_kept[node / 64] >> (node % 64)) & 1; }
+
+      // Verify if no node is kept.
+      bool IsEmpty() const { return GetFirstChild(InvalidNode) == InvalidNode; }
+
+      // Count the number of kept nodes.
+      size_t CountNodes() const;
+
+      // Access the data of a kept node, as in a text tree.
+      // The parent, child or sibling is InvalidNode when there is none.
+      std::string_view GetText(NodeIndex node) const { return SourceTree.GetText(node); }
+      NodeIndex GetParent(NodeIndex node) const;
+      NodeIndex GetNextSibling(NodeIndex node) const;
+
+      // Get the first child of a kept node.
+      // Pass InvalidNode to get the first root.
+      NodeIndex GetFirstChild(NodeIndex node) const;
+
+      // Create a text tree containing only the kept nodes.
+      TextTree CreateTree() const;
+
+   private:
+      // Find the first kept node in the range, or InvalidNode if there is none.
+      NodeIndex FindKept(NodeIndex begin, NodeIndex end) const;
+
+      // The end of the sub-tree of the node, or of the whole tree for InvalidNode.
+      NodeIndex GetSubTreeEnd(NodeIndex node) const;
+
+      std::vector<std::uint64_t> _kept;
+
+      friend void VisitRangeInOrder(const FilteredView& view, NodeIndex begin, NodeIndex end, TreeVisitor& visitor);
+   };
+
+   // Visits each kept node of a filtered view in order.
+   //
+   // The visitor receives the source tree, the index of the node in the source
+   // tree and the level of the node in the view.
+
+   void VisitInOrder(const FilteredView& view, TreeVisitor& visitor);
+   void VisitInOrder(const FilteredView& view, const NodeVisitFunction& func);
+
+   // Visits the kept nodes of a filtered view in order, from the beginning to the end index
+   // in the source tree.
+   //
+   // The range must cover whole sibling sub-trees of the view, for example a range of
+   // roots of the view and their descendants. The nodes at the beginning of the range
+   // are at level zero.
+
+   void VisitRangeInOrder(const FilteredView& view, NodeIndex begin, NodeIndex end, TreeVisitor& visitor);
+}
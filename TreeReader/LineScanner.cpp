@@ -0,0 +1,244 @@
+#include "LineScanner.h"
+#include "TreeReaderHelpers.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+   #define TREE_READER_SSE2
+   #include <immintrin.h>
+   #if defined(_MSC_VER)
+      #include <intrin.h>
+   #endif
+#endif
+
+#if defined(TREE_READER_SSE2)
+   // Note: GCC and Clang only allow AVX2 instructions in functions marked for them.
+   #if defined(__GNUC__) || defined(__clang__)
+      #define TREE_READER_AVX2_FUNCTION __attribute__((target("avx2")))
+   #else
+      #define TREE_READER_AVX2_FUNCTION
+   #endif
+#endif
+
+namespace TreeReader
+{
+   using namespace std;
+
+   namespace
+   {
+      #if defined(TREE_READER_SSE2)
+
+      bool IsAvx2Supported()
+      {
+         #if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+               return false;
+
+            // Note: the OS must also save the AVX registers, which is verified with XGETBV.
+            __cpuid(info, 1);
+            const bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+            const bool cpuHasAvx = (info[2] & (1 << 28)) != 0;
+            if (!osUsesXSave || !cpuHasAvx || (_xgetbv(0) & 6) != 6)
+               return false;
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+         #else
+            return __builtin_cpu_supports("avx2");
+         #endif
+      }
+
+      const bool useAvx2 = IsAvx2Supported();
+
+      // Find the end-of-line in full blocks of 16 or 32 characters.
+      // Returns where the search stopped, which is either the end-of-line
+      // or the start of the last partial block.
+
+      const char* FindEndOfLineSse2(const char* pos, const char* end)
+      {
+         const __m128i lf = _mm_set1_epi8('\n');
+         const __m128i cr = _mm_set1_epi8('\r');
+         for (; end - pos >= 16; pos += 16)
+         {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            const __m128i eol = _mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, cr));
+            const uint32_t mask = uint32_t(_mm_movemask_epi8(eol));
+            if (mask)
+               return pos + countr_zero(mask);
+         }
+         return pos;
+      }
+
+      TREE_READER_AVX2_FUNCTION
+      const char* FindEndOfLineAvx2(const char* pos, const char* end)
+      {
+         const __m256i lf = _mm256_set1_epi8('\n');
+         const __m256i cr = _mm256_set1_epi8('\r');
+         for (; end - pos >= 32; pos += 32)
+         {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            const __m256i eol = _mm256_or_si256(_mm256_cmpeq_epi8(block, lf), _mm256_cmpeq_epi8(block, cr));
+            const uint32_t mask = uint32_t(_mm256_movemask_epi8(eol));
+            if (mask)
+               return pos + countr_zero(mask);
+         }
+         return pos;
+      }
+
+      // Count the leading indentation characters in full blocks of 16 or 32 characters,
+      // and how many of them are tabs. Returns where the count stopped.
+
+      const char* CountIndentsSse2(const char* pos, const char* end, const vector<char>& indentChars, size_t& tabCount)
+      {
+         const __m128i tab = _mm_set1_epi8('\t');
+         for (; end - pos >= 16; pos += 16)
+         {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            __m128i indents = _mm_setzero_si128();
+            for (const char c : indentChars)
+               indents = _mm_or_si128(indents, _mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+
+            const uint32_t indentMask = uint32_t(_mm_movemask_epi8(indents));
+            const uint32_t tabMask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(block, tab)));
+            const int count = countr_one(indentMask);
+            tabCount += popcount(tabMask & ((uint64_t(1) << count) - 1));
+            if (count < 16)
+               return pos + count;
+         }
+         return pos;
+      }
+
+      TREE_READER_AVX2_FUNCTION
+      const char* CountIndentsAvx2(const char* pos, const char* end, const vector<char>& indentChars, size_t& tabCount)
+      {
+         const __m256i tab = _mm256_set1_epi8('\t');
+         for (; end - pos >= 32; pos += 32)
+         {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            __m256i indents = _mm256_setzero_si256();
+            for (const char c : indentChars)
+               indents = _mm256_or_si256(indents, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)));
+
+            const uint32_t indentMask = uint32_t(_mm256_movemask_epi8(indents));
+            const uint32_t tabMask = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, tab)));
+            const int count = countr_one(indentMask);
+            tabCount += popcount(tabMask & ((uint64_t(1) << count) - 1));
+            if (count < 32)
+               return pos + count;
+         }
+         return pos;
+      }
+
+      #endif
+   }
+
+   const char* FindEndOfLine(const char* begin, const char* end)
+   {
+      const char* pos = begin;
+
+      #if defined(TREE_READER_SSE2)
+         pos = useAvx2 ? FindEndOfLineAvx2(pos, end) : FindEndOfLineSse2(pos, end);
+      #endif
+
+      for (; pos < end; ++pos)
+         if (*pos == '\n' || *pos == '\r')
+            break;
+
+      return pos;
+   }
+
+   char* FindEndOfLine(char* begin, char* end)
+   {
+      return begin + (FindEndOfLine(const_cast<const char*>(begin), end) - begin);
+   }
+
+   LineScanner::LineScanner(const wstring& indentChars, size_t tabSize)
+   : _tabSize(tabSize)
+   {
+      for (const wchar_t c : indentChars)
+      {
+         // Note: end-of-line characters cannot be indentation,
+         //       otherwise the indentation would run into the next line.
+         if (c == L'\n' || c == L'\r')
+            continue;
+
+         if (c >= 0 && c < 0x80)
+         {
+            if (_asciiIndents[c])
+               continue;
+            _asciiIndents[c] = true;
+            _asciiIndentChars.emplace_back(char(c));
+         }
+         else
+         {
+            _otherIndents.emplace_back(ConvertToUtf8(wstring(1, c)));
+         }
+      }
+   }
+
+   LineScanner::Indentation LineScanner::GetIndent(const char* line, const char* end) const
+   {
+      Indentation result;
+
+      const char* pos = line;
+      while (pos < end)
+      {
+         // Count the ASCII indentation, many characters at a time.
+         size_t tabCount = 0;
+         const char* asciiEnd = pos;
+
+         #if defined(TREE_READER_SSE2)
+            if (!_asciiIndentChars.empty())
+               asciiEnd = useAvx2 ? CountIndentsAvx2(pos, end, _asciiIndentChars, tabCount)
+                                  : CountIndentsSse2(pos, end, _asciiIndentChars, tabCount);
+         #endif
+
+         while (asciiEnd < end)
+         {
+            const unsigned char c = *asciiEnd;
+            if (c >= 0x80 || !_asciiIndents[c])
+               break;
+            if (c == '\t')
+               tabCount += 1;
+            ++asciiEnd;
+         }
+
+         // Note: a tab counts as the tab size instead of one.
+         const size_t asciiCount = asciiEnd - pos;
+         result.Indent += (asciiCount - tabCount) + tabCount * _tabSize;
+         pos = asciiEnd;
+
+         // Check for non-ASCII indentation, one character at a time.
+         if (pos >= end || static_cast<unsigned char>(*pos) < 0x80 || _otherIndents.empty())
+            break;
+
+         const auto other = find_if(_otherIndents.begin(), _otherIndents.end(), [&](const string& indentChar)
+         {
+            return size_t(end - pos) >= indentChar.size()
+                && equal(indentChar.begin(), indentChar.end(), pos);
+         });
+         if (other == _otherIndents.end())
+            break;
+
+         result.Indent += 1;
+         pos += other->size();
+      }
+
+      result.TextIndex = pos - line;
+      return result;
+   }
+
+   LineScanner::ScannedLine LineScanner::ScanLine(const char* line, const char* end) const
+   {
+      // Note: the indentation never contains an end-of-line, so the search for
+      //       the end-of-line continues where the indentation stopped.
+      ScannedLine result;
+      static_cast<Indentation&>(result) = GetIndent(line, end);
+      result.EndOfLine = FindEndOfLine(line + result.TextIndex, end);
+      return result;
+   }
+}
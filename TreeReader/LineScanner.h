@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace TreeReader
+{
+   // Find the first end-of-line character, either a line-feed or a carriage-return.
+   // Returns the end of the text if there is none.
+   //
+   // Uses AVX2 or SSE2 instructions when available, otherwise checks each character.
+
+   const char* FindEndOfLine(const char* begin, const char* end);
+   char* FindEndOfLine(char* begin, char* end);
+
+   // Calculates the indentation of UTF-8 text lines.
+   //
+   // The ASCII indentation characters are checked many at a time
+   // using the vector instructions. Other indentation characters
+   // are checked one at a time.
+
+   struct LineScanner
+   {
+      // The indentation of a line and the index where its text starts.
+      struct Indentation
+      {
+         size_t Indent = 0;
+         size_t TextIndex = 0;
+      };
+
+      // The indentation of a line and where the line ends.
+      struct ScannedLine : Indentation
+      {
+         const char* EndOfLine = nullptr;
+      };
+
+      LineScanner(const std::wstring& indentChars = L" \t", size_t tabSize = 8);
+
+      // Calculate the indentation of the line.
+      // Only the indentation itself is read, the rest of the line is not.
+      Indentation GetIndent(const char* line, const char* end) const;
+
+      // Calculate the indentation and find the end of the line in a single pass.
+      ScannedLine ScanLine(const char* line, const char* end) const;
+
+   private:
+      size_t _tabSize = 8;
+      bool _asciiIndents[0x80] = {};
+      std::vector<char> _asciiIndentChars;
+      std::vector<std::string> _otherIndents;
+   };
+}
@@ -0,0 +1,106 @@
+#include "MappedFileTextHolder.h"
+
+#ifdef _WIN32
+   #define WIN32_LEAN_AND_MEAN
+   #define NOMINMAX
+   #include <windows.h>
+#else
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+
+namespace TreeReader
+{
+   using namespace std;
+
+   #ifdef _WIN32
+
+   MappedFileTextHolder::MappedFileTextHolder(const filesystem::path& path)
+   {
+      HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+         return;
+
+      _file = file;
+
+      LARGE_INTEGER size;
+      if (!::GetFileSizeEx(file, &size))
+         return;
+
+      // Note: mapping an empty file is an error, so don't try.
+      if (size.QuadPart == 0)
+      {
+         _isValid = true;
+         return;
+      }
+
+      _mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (!_mapping)
+         return;
+
+      _data = static_cast<const char*>(::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+      if (!_data)
+         return;
+
+      _size = size_t(size.QuadPart);
+      _isValid = true;
+   }
+
+   MappedFileTextHolder::~MappedFileTextHolder()
+   {
+      if (_data)
+         ::UnmapViewOfFile(_data);
+      if (_mapping)
+         ::CloseHandle(_mapping);
+      if (_file)
+         ::CloseHandle(_file);
+   }
+
+   #else
+
+   MappedFileTextHolder::MappedFileTextHolder(const filesystem::path& path)
+   {
+      const int file = ::open(path.c_str(), O_RDONLY);
+      if (file < 0)
+         return;
+
+      struct stat info;
+      if (::fstat(file, &info) != 0 || !S_ISREG(info.st_mode))
+      {
+         ::close(file);
+         return;
+      }
+
+      // Note: mapping an empty file is an error, so don't try.
+      if (info.st_size == 0)
+      {
+         ::close(file);
+         _isValid = true;
+         return;
+      }
+
+      void* data = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+      // Note: the mapping stays valid after the file is closed.
+      ::close(file);
+
+      if (data == MAP_FAILED)
+         return;
+
+      ::madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+
+      _data = static_cast<const char*>(data);
+      _size = size_t(info.st_size);
+      _isValid = true;
+   }
+
+   MappedFileTextHolder::~MappedFileTextHolder()
+   {
+      if (_data)
+         ::munmap(const_cast<char*>(_data), _size);
+   }
+
+   #endif
+}
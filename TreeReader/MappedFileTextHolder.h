@@ -0,0 +1,41 @@
+#pragma once
+
+#include "TextTree.h"
+
+#include <filesystem>
+
+namespace TreeReader
+{
+   // Holds the text of a file mapped read-only in memory.
+   //
+   // The file contents are not copied: the memory is shared with the
+   // file cache of the operating system and only paged in when accessed.
+
+   struct MappedFileTextHolder : TextHolder
+   {
+      MappedFileTextHolder(const std::filesystem::path& path);
+      ~MappedFileTextHolder();
+
+      MappedFileTextHolder(const MappedFileTextHolder&) = delete;
+      MappedFileTextHolder& operator=(const MappedFileTextHolder&) = delete;
+
+      // Verify if the file could be opened and mapped.
+      // Note: an empty file is valid even though it has no data.
+      bool IsValid() const { return _isValid; }
+
+      // The raw bytes of the file.
+      const char* Begin() const { return _data; }
+      const char* End() const { return _data + _size; }
+      size_t Size() const { return _size; }
+
+   private:
+      const char* _data = nullptr;
+      size_t _size = 0;
+      bool _isValid = false;
+
+      #ifdef _WIN32
+      void* _file = nullptr;
+      void* _mapping = nullptr;
+      #endif
+   };
+}
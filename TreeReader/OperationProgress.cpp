@@ -0,0 +1,34 @@
+#include "OperationProgress.h"
+
+#include <algorithm>
+
+namespace TreeReader
+{
+   using namespace std;
+
+   double OperationProgress::GetFraction() const
+   {
+      const size_t total = GetTotal();
+      if (total == 0)
+         return 0.;
+
+      return min(1., double(GetDone()) / double(total));
+   }
+
+   bool ProgressBatch::Flush()
+   {
+      _work = 0;
+
+      if (!_progress)
+         return _cancelled;
+
+      if (_done)
+      {
+         _progress->AddDone(_done);
+         _done = 0;
+      }
+
+      _cancelled = _progress->IsCancelled();
+      return _cancelled;
+   }
+}
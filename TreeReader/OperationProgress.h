@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace TreeReader
+{
+   // The progress of a long operation, which can be cancelled from another thread.
+   //
+   // The operation adds the total amount of work it will do and the work it has done,
+   // in nodes or bytes, depending on the operation. The total can be zero when unknown.
+   //
+   // Note: the threads of the operation should go through a progress batch
+   //       to avoid touching the shared counters for each node or byte.
+
+   struct OperationProgress
+   {
+      // Request the operation to stop as soon as possible.
+      void Cancel() { _cancelled = true; }
+      bool IsCancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+
+      void AddTotal(size_t total) { _total.fetch_add(total, std::memory_order_relaxed); }
+      void AddDone(size_t done) { _done.fetch_add(done, std::memory_order_relaxed); }
+
+      size_t GetTotal() const { return _total.load(std::memory_order_relaxed); }
+      size_t GetDone() const { return _done.load(std::memory_order_relaxed); }
+
+      // The fraction of the work done, between zero and one. Zero when the total is unknown.
+      double GetFraction() const;
+
+   private:
+      std::atomic<bool> _cancelled = false;
+      std::atomic<size_t> _total = 0;
+      std::atomic<size_t> _done = 0;
+   };
+
+   // Reports the progress of one thread in batches.
+   //
+   // The work done is only added to the progress and the cancellation is only
+   // checked once per batch of work. The progress is optional: without it,
+   // the operation is never cancelled.
+
+   struct ProgressBatch
+   {
+      static constexpr size_t DefaultBatchSize = 16 * 1024;
+
+      ProgressBatch(OperationProgress* progress, size_t batchSize = DefaultBatchSize)
+      : _progress(progress), _batchSize(batchSize), _cancelled(progress && progress->IsCancelled()) {}
+
+      // Add the work not yet reported to the progress.
+      ~ProgressBatch() { if (_done) Flush(); }
+
+      ProgressBatch(const ProgressBatch&) = delete;
+      ProgressBatch& operator=(const ProgressBatch&) = delete;
+
+      // Add to the work done. Returns true if the operation was cancelled.
+      bool Advance(size_t done = 1)
+      {
+         _done += done;
+         return Poll(done);
+      }
+
+      // Account for work that is not counted in the progress, like searching
+      // the sub-tree of a node. Returns true if the operation was cancelled.
+      bool Poll(size_t work = 1)
+      {
+         _work += work;
+         return _work < _batchSize ? _cancelled : Flush();
+      }
+
+      // Report the work done now. Returns true if the operation was cancelled.
+      bool Flush();
+
+      // If the operation was cancelled, as of the last report.
+      bool IsCancelled() const { return _cancelled; }
+
+   private:
+      OperationProgress* _progress = nullptr;
+      size_t _batchSize = DefaultBatchSize;
+      size_t _done = 0;
+      size_t _work = 0;
+      bool _cancelled = false;
+   };
+}
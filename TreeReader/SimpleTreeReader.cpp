@@ -1,123 +1,363 @@
 #include "SimpleTreeReader.h"
 #include "BuffersTextHolder.h"
+#include "MappedFileTextHolder.h"
+#include "LineScanner.h"
+#include "TreeReaderHelpers.h"
+#include "TextRegex.h"
 
 #include <fstream>
 #include <sstream>
 #include <algorithm>
-#include <list>
+#include <iterator>
 
 namespace TreeReader
 {
    using namespace std;
    using namespace std::filesystem;
-   using Node = TextTree::Node;
 
-   struct BuffersTextHolderWithFilteredLines : BuffersTextHolder
-   {
-      list<wstring> FilteredLines;
-   };
+   // Move buffers to the end of other buffers.
+   // Note: moving the buffers keeps their text at the same address.
 
-   TextTree ReadSimpleTextTree(const path& path, const ReadSimpleTextTreeOptions& options)
+   static void MoveBuffers(BuffersTextHolder::Buffers& from, BuffersTextHolder::Buffers& to)
    {
-      wifstream stream(path);
-      return ReadSimpleTextTree(stream, options);
+      to.insert(to.end(), make_move_iterator(from.begin()), make_move_iterator(from.end()));
+      from.clear();
    }
 
-   static std::pair<size_t, size_t> GetIndent(const wchar_t* line, size_t count, const ReadSimpleTextTreeOptions& options)
+   struct MappedFileTextHolderWithFilteredLines : MappedFileTextHolder
    {
-      const size_t textIndex = wcsspn(line, options.InputIndent.c_str());
-      size_t indent = textIndex;
-      for (size_t i = 0; i < textIndex; ++i)
-         if (line[i] == L'\t')
-            indent += options.TabSize - 1;
-      return make_pair(indent, textIndex);
-}
+      MappedFileTextHolderWithFilteredLines(const path& path) : MappedFileTextHolder(path) {}
+
+      BuffersTextHolder::Buffers FilteredLines;
+   };
+
+   // The text lines read and their indentation.
+   //
+   // Applies the optional input filter to each line as it is added
+   // and builds the tree once all lines have been added.
+   //
+   // Lines that are modified by the input filter are kept in the filtered lines.
+   // They must be transferred to the text holder of the tree.
 
-   TextTree ReadSimpleTextTree(wistream& stream, const ReadSimpleTextTreeOptions& options)
+   struct IndentedLines
    {
-      BuffersTextHolderReader reader;
+      IndentedLines(const ReadSimpleTextTreeOptions& options, OperationProgress* progress)
+      : Scanner(options.InputIndent, options.TabSize), _threadCount(options.ThreadCount), _progress(progress)
+      {
+         _inputFilterUsed = !options.InputFilter.empty();
+         if (_inputFilterUsed)
+            _inputFilter = TextRegex(options.InputFilter);
+      }
 
-      // Reset the text holder for this private version that can hold extra filtered lines.
-      shared_ptr<BuffersTextHolderWithFilteredLines> holder;
-      wregex inputFilter;
-      const bool inputFilterUsed = !options.InputFilter.empty();
-      if (inputFilterUsed)
+      // Calculates the indentation of the lines.
+      const LineScanner Scanner;
+
+      // Note: the filtered lines are packed in a few large buffers.
+      BuffersTextHolder FilteredLines;
+
+      // Add a line of the given length.
+      void AddLine(const char* line, size_t count)
       {
-         inputFilter = wregex(options.InputFilter);
-         reader.Holder = holder = make_shared<BuffersTextHolderWithFilteredLines>();
+         AddLine(line, count, Scanner.GetIndent(line, line + count));
       }
 
-      vector<size_t> indents;
-      vector<wchar_t*> lines;
+      // Add a line for which the indentation was already calculated.
+      void AddLine(const char* line, size_t count, LineScanner::Indentation indentation)
       {
-         while (true)
+         if (_inputFilterUsed)
          {
-            auto result = reader.ReadLine(stream);
-            wchar_t* line = result.first;
-            size_t count = result.second;
-            if (count <= 0)
+            const vector<string_view> matches = _inputFilter.FindAll(string_view(line, count));
+            if (matches.empty())
+               return;
+
+            string cleanedLine;
+            for (const string_view& match : matches)
+               cleanedLine += match;
+
+            if (cleanedLine.size() < count)
+            {
+               const string_view filteredLine = FilteredLines.AddText(cleanedLine);
+               line = filteredLine.data();
+               count = filteredLine.size();
+               indentation = Scanner.GetIndent(line, line + count);
+            }
+         }
+
+         _lines.emplace_back(line + indentation.TextIndex, count - indentation.TextIndex);
+         _indents.emplace_back(indentation.Indent);
+      }
+
+      // Add all lines of the text. The text is not modified: the lines refer to it directly.
+      // Stops early if the progress is cancelled.
+      void AddLines(const char* line, const char* const end)
+      {
+         ProgressBatch progress(_progress);
+         while (line < end)
+         {
+            // Calculate the indentation and find the end of the line in a single pass.
+            const auto scanned = Scanner.ScanLine(line, end);
+            const char* const endOfLine = scanned.EndOfLine;
+
+            // Note: empty lines are skipped.
+            if (endOfLine > line)
+               AddLine(line, endOfLine - line, scanned);
+
+            const char* const next = (endOfLine < end) ? endOfLine + 1 : end;
+            if (progress.Advance(next - line))
                break;
+            line = next;
+         }
+      }
+
+      // Append the lines of another, which must come after the lines of this one.
+      void Append(IndentedLines&& other)
+      {
+         _indents.insert(_indents.end(), other._indents.begin(), other._indents.end());
+         _lines.insert(_lines.end(), other._lines.begin(), other._lines.end());
+
+         MoveBuffers(other.FilteredLines.TextBuffers, FilteredLines.TextBuffers);
+      }
+
+      TextTree BuildTree(const shared_ptr<TextHolder>& textHolder) const
+      {
+         TextTree tree;
+
+         tree.SourceTextLines = textHolder;
+         tree.AddNodes(_lines, FindParents(_indents, _threadCount), _threadCount);
+         tree.Freeze();
+
+         return tree;
+      }
 
-            if (inputFilterUsed)
+   private:
+      // Find the parent of each line: the nearest previous line that is less indented.
+      // Lines without such a line are roots.
+      //
+      // This is the all-nearest-smaller-values problem. It is solved in parallel:
+      // each chunk of lines finds the parents within itself using a stack and keeps
+      // the stack left at its end. Then, the lines without a parent in their chunk
+      // search the stacks of the previous chunks.
+      static vector<NodeIndex> FindParents(const vector<size_t>& indents, size_t threadCount)
+      {
+         const size_t lineCount = indents.size();
+         const size_t chunkCount = CountParallelChunks(lineCount, 64 * 1024, threadCount);
+         const auto chunkBegin = [&](size_t chunk) { return NodeIndex(lineCount * chunk / chunkCount); };
+
+         vector<NodeIndex> parents(lineCount, InvalidNode);
+         vector<vector<NodeIndex>> stacks(chunkCount);
+
+         RunInParallel(chunkCount, [&](size_t chunk)
+         {
+            // Note: the stack is always strictly increasing in indentation,
+            //       so its bottom is the least indented line of the chunk.
+            auto& stack = stacks[chunk];
+            for (NodeIndex i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
             {
-               auto pos = wcregex_iterator(line, line + count, inputFilter);
-               auto end = wcregex_iterator();
-               if (pos == end)
+               const size_t indent = indents[i];
+               while (!stack.empty() && indents[stack.back()] >= indent)
+                  stack.pop_back();
+               if (!stack.empty())
+                  parents[i] = stack.back();
+               stack.emplace_back(i);
+            }
+         });
+
+         RunInParallel(chunkCount, [&](size_t chunk)
+         {
+            // Note: the lines without a parent in the chunk are less and less indented,
+            //       so the previous chunks that are skipped never need to be searched again.
+            size_t searched = chunk;
+            for (NodeIndex i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+            {
+               if (parents[i] != InvalidNode)
                   continue;
 
-               wstring cleanedLine;
-               for (; pos != end; ++pos)
-                  cleanedLine += pos->str();
-
-               const size_t cleanedCount = cleanedLine.size();
-               if (cleanedCount < count)
-               {
-                  holder->FilteredLines.emplace_back(move(cleanedLine));
-                  line = holder->FilteredLines.back().data();
-                  count = cleanedCount;
-               }
+               const size_t indent = indents[i];
+               while (searched > 0 && (stacks[searched - 1].empty() || indents[stacks[searched - 1].front()] >= indent))
+                  --searched;
+
+               // Note: the following lines without a parent are all roots too.
+               if (searched == 0)
+                  break;
+
+               const auto& stack = stacks[searched - 1];
+               const auto pos = partition_point(stack.begin(), stack.end(), [&](NodeIndex line) { return indents[line] < indent; });
+               parents[i] = *(pos - 1);
             }
+         });
 
-            const auto [indent, textIndex] = GetIndent(line, count, options);
+         return parents;
+      }
 
-            lines.emplace_back(line + textIndex);
-            indents.emplace_back(indent);
-         }
+      size_t _threadCount = 0;
+      OperationProgress* _progress = nullptr;
+      TextRegex _inputFilter;
+      bool _inputFilterUsed = false;
+
+      vector<size_t> _indents;
+      vector<string_view> _lines;
+   };
+
+   // Read the lines of the text in chunks, each in its own thread.
+   //
+   // The chunks are split at end-of-lines so that no line is split
+   // between two chunks. The lines of each chunk are then appended
+   // in order, giving the same lines as reading in a single thread.
+
+   static IndentedLines ReadLinesInParallel(const char* begin, const char* end, const ReadSimpleTextTreeOptions& options, OperationProgress* progress)
+   {
+      // Note: small texts are not worth splitting, unless the number of threads was given.
+      const size_t minChunkSize = 1024 * 1024;
+      const size_t size = end - begin;
+      const size_t chunkCount = CountParallelChunks(size, minChunkSize, options.ThreadCount);
+
+      vector<const char*> chunkStarts;
+      chunkStarts.emplace_back(begin);
+      for (size_t i = 1; i < chunkCount; ++i)
+      {
+         const char* start = max(begin + size * i / chunkCount, chunkStarts.back());
+         start = FindEndOfLine(start, end);
+         if (start < end)
+            start += 1;
+         chunkStarts.emplace_back(start);
       }
+      chunkStarts.emplace_back(end);
+
+      vector<IndentedLines> chunks(chunkCount, IndentedLines(options, progress));
+      RunInParallel(chunkCount, [&](size_t chunk)
+      {
+         chunks[chunk].AddLines(chunkStarts[chunk], chunkStarts[chunk + 1]);
+      });
 
-      TextTree tree;
+      IndentedLines lines = move(chunks[0]);
+      for (size_t i = 1; i < chunkCount; ++i)
+         lines.Append(move(chunks[i]));
 
-      tree.SourceTextLines = reader.Holder;
+      return lines;
+   }
 
-      if (indents.empty())
-         return tree;
+   // Read the whole file in a buffer, for when it cannot be mapped.
+   //
+   // The file is read as bytes, not through a wide stream, so that its UTF-8 text
+   // is kept as is, like when it is mapped. A wide stream would decode it with the
+   // default locale and convert it again to UTF-8, encoding it twice.
+
+   static TextTree ReadSimpleTextTreeInBuffer(const path& path, const ReadSimpleTextTreeOptions& options, OperationProgress* progress)
+   {
+      auto holder = make_shared<BuffersTextHolder>();
+
+      ifstream stream(path, ios::binary);
+      auto buffer = make_shared<BuffersTextHolder::Buffer>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+      holder->TextBuffers.emplace_back(buffer);
+
+      if (progress)
+         progress->AddTotal(buffer->size());
+
+      IndentedLines lines = ReadLinesInParallel(buffer->data(), buffer->data() + buffer->size(), options, progress);
+      if (progress && progress->IsCancelled())
+         return TextTree();
+
+      // Note: the filtered lines are kept in the same holder as the text read.
+      MoveBuffers(lines.FilteredLines.TextBuffers, holder->TextBuffers);
+
+      return lines.BuildTree(holder);
+   }
+
+   TextTree ReadSimpleTextTree(const path& path, const ReadSimpleTextTreeOptions& options, OperationProgress* progress)
+   {
+      // Map the file directly in memory to avoid reading it through a stream.
+      // Fall back on reading the whole file if it cannot be mapped.
+      //
+      // The file is mapped read-only. The nodes point directly into the mapped text
+      // and keep the length of their text, so the text never needs to be modified.
+      auto holder = make_shared<MappedFileTextHolderWithFilteredLines>(path);
+      if (!holder->IsValid())
+         return ReadSimpleTextTreeInBuffer(path, options, progress);
+
+      if (progress)
+         progress->AddTotal(holder->End() - holder->Begin());
 
-      vector<size_t> previousIndents;
-      vector<Node *> previousNodes;
+      IndentedLines lines = ReadLinesInParallel(holder->Begin(), holder->End(), options, progress);
+      if (progress && progress->IsCancelled())
+         return TextTree();
 
-      previousIndents.emplace_back(indents[0]);
-      previousNodes.emplace_back(nullptr);
+      MoveBuffers(lines.FilteredLines.TextBuffers, holder->FilteredLines);
 
-      for (size_t i = 0; i < indents.size(); ++i)
+      return lines.BuildTree(holder);
+   }
+
+   TextTree ReadSimpleTextTreeInParts(const path& path, const ReadSimpleTextTreeOptions& options, const PartialTreeFunction& partialTree, OperationProgress* progress)
+   {
+      auto holder = make_shared<MappedFileTextHolderWithFilteredLines>(path);
+      if (!holder->IsValid())
       {
-         const size_t newIndent = indents[i];
+         // Note: a file that cannot be mapped is read in a single part.
+         return ReadSimpleTextTreeInBuffer(path, options, progress);
+      }
+
+      if (progress)
+         progress->AddTotal(holder->End() - holder->Begin());
+
+      // Note: each part is twice as large as the previous one, so the tree
+      //       of the lines read so far is only built a few times.
+      const char* begin = holder->Begin();
+      const char* const end = holder->End();
+      size_t partSize = 4 * 1024 * 1024;
 
-         size_t previousIndent = previousIndents.back();
-         while (newIndent < previousIndent)
+      IndentedLines lines(options, progress);
+      while (begin < end)
+      {
+         const char* partEnd = end;
+         if (size_t(end - begin) > partSize)
          {
-            previousIndents.pop_back();
-            previousNodes.pop_back();
-            previousIndent = previousIndents.back();
+            partEnd = FindEndOfLine(begin + partSize, end);
+            if (partEnd < end)
+               partEnd += 1;
          }
 
-         const wchar_t* newText = lines[i];
-         Node* addUnder = (newIndent > previousIndent) ? previousNodes.back()
-                        : previousNodes.back() ? previousNodes.back()->Parent : nullptr;
-         Node * newNode = tree.AddChild(addUnder, newText);
-         previousIndents.emplace_back(newIndent);
-         previousNodes.emplace_back(newNode);
+         lines.Append(ReadLinesInParallel(begin, partEnd, options, progress));
+         if (progress && progress->IsCancelled())
+            return TextTree();
+
+         // Note: the text of the filtered lines does not move, so the trees already built stay valid.
+         MoveBuffers(lines.FilteredLines.TextBuffers, holder->FilteredLines);
+
+         begin = partEnd;
+         partSize *= 2;
+
+         if (begin < end && partialTree)
+            partialTree(lines.BuildTree(holder));
+      }
+
+      return lines.BuildTree(holder);
+   }
+
+   TextTree ReadSimpleTextTree(wistream& stream, const ReadSimpleTextTreeOptions& options, OperationProgress* progress)
+   {
+      BuffersTextHolderReader reader;
+      auto holder = reader.Holder;
+
+      IndentedLines lines(options, progress);
+      ProgressBatch batch(progress);
+
+      while (true)
+      {
+         auto result = reader.ReadLine(stream);
+         char* line = result.first;
+         size_t count = result.second;
+         if (count <= 0)
+            break;
+
+         lines.AddLine(line, count);
+
+         // Note: the size of the stream is unknown, so only the characters read are counted.
+         if (batch.Advance(count + 1))
+            return TextTree();
       }
 
-      return tree;
+      // Note: the filtered lines are kept in the same holder as the lines read.
+      MoveBuffers(lines.FilteredLines.TextBuffers, holder->TextBuffers);
+
+      return lines.BuildTree(holder);
    }
 }
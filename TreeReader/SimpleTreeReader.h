@@ -1,9 +1,10 @@
 #pragma once
 
 #include "TextTree.h"
+#include "OperationProgress.h"
 
 #include <filesystem>
-#include <regex>
+#include <functional>
 
 namespace TreeReader
 {
@@ -19,10 +20,16 @@ namespace TreeReader
 
       // Optional input regular expression to filter input lines.
       // It is applied before indentation calculations.
-      // Only captured text will be kept for further processing.
-      // This allows cleaning up input lines.
+      // Only the matched text will be kept for further processing,
+      // with the same matches as ECMAScript. Lines without
+      // a match are dropped. This allows cleaning up input lines.
       std::wstring InputFilter;
 
+      // How many threads to use to read a file. Zero uses one per core,
+      // but only when the file is large enough.
+      // Note: it does not change the resulting tree, so it is not compared.
+      size_t ThreadCount = 0;
+
       bool operator!=(const ReadSimpleTextTreeOptions& other) const
       {
          return TabSize != other.TabSize
@@ -33,7 +40,24 @@ namespace TreeReader
    };
 
    // Read a simple flat text file, using initial white-space indentation to determine the tree structure.
+   // The tree is returned frozen.
+   //
+   // The optional progress counts the bytes read from a file, or the characters read from a stream.
+   // When it is cancelled, the reading stops early and the tree is returned empty.
+
+   TextTree ReadSimpleTextTree(const std::filesystem::path& path, const ReadSimpleTextTreeOptions& options = ReadSimpleTextTreeOptions(), OperationProgress* progress = nullptr);
+   TextTree ReadSimpleTextTree(std::wistream& stream, const ReadSimpleTextTreeOptions& options = ReadSimpleTextTreeOptions(), OperationProgress* progress = nullptr);
+
+   // Called with the frozen tree of the lines read so far, while a file is being read.
+
+   using PartialTreeFunction = std::function<void(const TextTree& partialTree)>;
+
+   // Read a simple flat text file like ReadSimpleTextTree, but in parts, each twice
+   // as large as the previous one. After each part but the last, the function is called
+   // with the tree of the lines read so far, for example to show it while the rest is read.
+   //
+   // Note: the partial trees are snapshots: the following lines are never added to them.
+   //       The tree of the whole file is returned.
 
-   TextTree ReadSimpleTextTree(const std::filesystem::path& path, const ReadSimpleTextTreeOptions& options = ReadSimpleTextTreeOptions());
-   TextTree ReadSimpleTextTree(std::wistream& stream, const ReadSimpleTextTreeOptions& options = ReadSimpleTextTreeOptions());
+   TextTree ReadSimpleTextTreeInParts(const std::filesystem::path& path, const ReadSimpleTextTreeOptions& options, const PartialTreeFunction& partialTree, OperationProgress* progress = nullptr);
 }
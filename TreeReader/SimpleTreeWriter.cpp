@@ -1,5 +1,6 @@
 #include "SimpleTreeWriter.h"
 #include "TextTreeVisitor.h"
+#include "TreeReaderHelpers.h"
 
 #include <fstream>
 
@@ -7,18 +8,48 @@ namespace TreeReader
 {
    using namespace std;
 
-   std::wostream& PrintTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation)
+   namespace
    {
-      VisitInOrder(tree, [&stream, &indentation](const TextTree& tree, const TextTree::Node& node, size_t level)
+      // Print each node of the tree in order, preceded by one indentation per level.
+      // Adds each printed node to the optional progress and stops early if it is cancelled.
+
+      template <class Stream, class Text, class Convert>
+      Stream& PrintTree(Stream& stream, const TextTree& tree, const Text& indentation, OperationProgress* progress, Convert&& convert)
       {
-         for (size_t indent = 0; indent < level; ++indent)
-            stream << indentation;
+         if (progress)
+            progress->AddTotal(tree.CountNodes());
+
+         ProgressBatch batch(progress);
+         VisitInOrder(tree, [&stream, &indentation, &batch, &convert](const TextTree& tree, NodeIndex node, size_t level)
+         {
+            if (batch.IsCancelled())
+               return TreeVisitor::Result{ true, false };
+
+            for (size_t indent = 0; indent < level; ++indent)
+               stream << indentation;
+
+            stream << convert(tree.GetText(node)) << "\n";
 
-         stream << node.TextPtr << L"\n";
+            batch.Advance();
+            return TreeVisitor::Result();
+         });
+         return stream;
+      }
 
-         return TreeVisitor::Result();
-      });
-      return stream;
+      wostream& PrintTree(wostream& stream, const TextTree& tree, const wstring& indentation, OperationProgress* progress)
+      {
+         return PrintTree(stream, tree, indentation, progress, [](string_view text) { return ConvertFromUtf8(text.data(), text.size()); });
+      }
+
+      ostream& PrintTree(ostream& stream, const TextTree& tree, const string& indentation, OperationProgress* progress)
+      {
+         return PrintTree(stream, tree, indentation, progress, [](string_view text) { return text; });
+      }
+   }
+
+   std::wostream& PrintTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation)
+   {
+      return PrintTree(stream, tree, indentation, nullptr);
    }
 
    wostream& operator<<(wostream& stream, const TextTree& tree)
@@ -26,14 +57,25 @@ namespace TreeReader
       return PrintTree(stream, tree);
    }
 
-   void WriteSimpleTextTree(const std::filesystem::path& path, const TextTree& tree, const std::wstring& indentation)
+   std::ostream& PrintTree(std::ostream& stream, const TextTree& tree, const std::string& indentation)
+   {
+      return PrintTree(stream, tree, indentation, nullptr);
+   }
+
+   ostream& operator<<(ostream& stream, const TextTree& tree)
+   {
+      return PrintTree(stream, tree);
+   }
+
+   void WriteSimpleTextTree(const std::filesystem::path& path, const TextTree& tree, const std::wstring& indentation, OperationProgress* progress)
    {
-      wofstream stream(path);
-      PrintTree(stream, tree, indentation);
+      // Note: write to a narrow stream to keep the UTF-8 text as-is.
+      ofstream stream(path);
+      PrintTree(stream, tree, ConvertToUtf8(indentation), progress);
    }
 
-   void WriteSimpleTextTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation)
+   void WriteSimpleTextTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation, OperationProgress* progress)
    {
-      PrintTree(stream, tree, indentation);
+      PrintTree(stream, tree, indentation, progress);
    }
 }
@@ -1,13 +1,17 @@
 #pragma once
 
 #include "TextTree.h"
+#include "OperationProgress.h"
 
 #include <filesystem>
 
 namespace TreeReader
 {
    // Write a simple flat text file, using initial white-space indentation to determine the tree structure.
+   //
+   // The optional progress counts the nodes written. When it is cancelled,
+   // the writing stops early and only part of the tree is written.
 
-   void WriteSimpleTextTree(const std::filesystem::path& path, const TextTree& tree, const std::wstring& indentation);
-   void WriteSimpleTextTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation);
+   void WriteSimpleTextTree(const std::filesystem::path& path, const TextTree& tree, const std::wstring& indentation, OperationProgress* progress = nullptr);
+   void WriteSimpleTextTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation, OperationProgress* progress = nullptr);
 }
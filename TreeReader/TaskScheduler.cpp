@@ -0,0 +1,222 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace TreeReader
+{
+   using namespace std;
+
+   struct TaskScheduler::Worker
+   {
+      mutex Mutex;
+      deque<function<void()>> Tasks[PriorityCount];
+      thread Thread;
+   };
+
+   namespace
+   {
+      // The scheduler and worker running on the current thread, if any,
+      // and the priority of the task being run.
+      thread_local TaskScheduler* CurrentScheduler = nullptr;
+      thread_local size_t CurrentWorker = 0;
+      thread_local TaskScheduler::Priority CurrentPriority = TaskScheduler::Priority::Normal;
+   }
+
+   TaskScheduler::TaskScheduler(size_t threadCount)
+   {
+      if (threadCount == 0)
+         threadCount = max(size_t(1), size_t(thread::hardware_concurrency()));
+
+      // Note: all workers exist before any thread starts, since they steal from each other.
+      for (size_t i = 0; i < threadCount; ++i)
+         _workers.emplace_back(make_unique<Worker>());
+
+      for (size_t i = 0; i < threadCount; ++i)
+         _workers[i]->Thread = thread([this, i]() { RunWorker(i); });
+   }
+
+   TaskScheduler::~TaskScheduler()
+   {
+      {
+         lock_guard lock(_sleepMutex);
+         _stopping = true;
+      }
+      _wakeUp.notify_all();
+
+      for (auto& worker : _workers)
+         worker->Thread.join();
+   }
+
+   TaskScheduler& TaskScheduler::GetShared()
+   {
+      static TaskScheduler scheduler;
+      return scheduler;
+   }
+
+   void TaskScheduler::Post(function<void()> task, Priority priority)
+   {
+      {
+         lock_guard lock(_sleepMutex);
+         _queuedCount += 1;
+      }
+
+      // Note: tasks posted by a task of this scheduler are kept by its thread.
+      if (CurrentScheduler == this)
+      {
+         Worker& worker = *_workers[CurrentWorker];
+         lock_guard lock(worker.Mutex);
+         worker.Tasks[size_t(priority)].emplace_back(move(task));
+      }
+      else
+      {
+         lock_guard lock(_sharedMutex);
+         _sharedTasks[size_t(priority)].emplace_back(move(task));
+      }
+
+      _wakeUp.notify_one();
+   }
+
+   bool TaskScheduler::TakeTask(size_t index, function<void()>& task, Priority& priority)
+   {
+      const auto takeFrom = [&task](mutex& queueMutex, deque<function<void()>>& tasks, bool newest)
+      {
+         lock_guard lock(queueMutex);
+         if (tasks.empty())
+            return false;
+
+         if (newest)
+         {
+            task = move(tasks.back());
+            tasks.pop_back();
+         }
+         else
+         {
+            task = move(tasks.front());
+            tasks.pop_front();
+         }
+         return true;
+      };
+
+      for (size_t level = PriorityCount; level-- > 0; )
+      {
+         priority = Priority(level);
+
+         if (takeFrom(_workers[index]->Mutex, _workers[index]->Tasks[level], true))
+            return true;
+
+         if (takeFrom(_sharedMutex, _sharedTasks[level], false))
+            return true;
+
+         for (size_t i = 1; i < _workers.size(); ++i)
+         {
+            Worker& other = *_workers[(index + i) % _workers.size()];
+            if (takeFrom(other.Mutex, other.Tasks[level], false))
+               return true;
+         }
+      }
+
+      return false;
+   }
+
+   void TaskScheduler::RunWorker(size_t index)
+   {
+      CurrentScheduler = this;
+      CurrentWorker = index;
+
+      // Note: the queued tasks are not run once stopping, since the
+      //       scheduler may be stopping because the program is exiting.
+      while (!_stopping)
+      {
+         function<void()> task;
+         Priority priority = Priority::Normal;
+         if (TakeTask(index, task, priority))
+         {
+            {
+               lock_guard lock(_sleepMutex);
+               _queuedCount -= 1;
+            }
+
+            CurrentPriority = priority;
+            try
+            {
+               task();
+            }
+            catch (...)
+            {
+            }
+            continue;
+         }
+
+         unique_lock lock(_sleepMutex);
+         _wakeUp.wait(lock, [this]() { return _stopping || _queuedCount > 0; });
+      }
+   }
+
+   void TaskScheduler::RunInParallel(size_t chunkCount, const function<void(size_t)>& func)
+   {
+      if (chunkCount == 0)
+         return;
+
+      if (chunkCount == 1)
+      {
+         func(0);
+         return;
+      }
+
+      // The chunks are shared with the helping tasks. A helping task may only
+      // start after all the chunks are done, so it checks if any chunk is left
+      // before calling the function, which may no longer exist.
+      struct Chunks
+      {
+         const function<void(size_t)>* Func = nullptr;
+         size_t Count = 0;
+         atomic<size_t> Next = 0;
+         atomic<size_t> Done = 0;
+
+         mutex Mutex;
+         condition_variable AllDone;
+         exception_ptr Error;
+      };
+
+      auto chunks = make_shared<Chunks>();
+      chunks->Func = &func;
+      chunks->Count = chunkCount;
+
+      const auto runChunks = [chunks]()
+      {
+         for (size_t chunk = chunks->Next++; chunk < chunks->Count; chunk = chunks->Next++)
+         {
+            try
+            {
+               (*chunks->Func)(chunk);
+            }
+            catch (...)
+            {
+               lock_guard lock(chunks->Mutex);
+               if (!chunks->Error)
+                  chunks->Error = current_exception();
+            }
+
+            if (++chunks->Done == chunks->Count)
+            {
+               lock_guard lock(chunks->Mutex);
+               chunks->AllDone.notify_all();
+            }
+         }
+      };
+
+      const Priority priority = (CurrentScheduler == this) ? CurrentPriority : Priority::Normal;
+      const size_t helperCount = min(chunkCount - 1, CountThreads());
+      for (size_t i = 0; i < helperCount; ++i)
+         Post(runChunks, priority);
+
+      runChunks();
+
+      unique_lock lock(chunks->Mutex);
+      chunks->AllDone.wait(lock, [&chunks]() { return chunks->Done == chunks->Count; });
+
+      if (chunks->Error)
+         rethrow_exception(chunks->Error);
+   }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace TreeReader
+{
+   // A fixed pool of threads running tasks.
+   //
+   // The tasks of the highest priority are always run first. A task submitted
+   // by another task goes in the queue of the thread running it, where the
+   // newest task is run first, since its data is likely still in the cache.
+   // A thread that has nothing left to do steals the oldest task of the other
+   // threads. The other tasks go in a queue shared by all threads.
+   //
+   // A task must not wait for another task, since all threads could end up
+   // waiting. Running chunks in parallel is the exception: the waiting thread
+   // runs the chunks that no other thread has started.
+   //
+   // The library submits all its work, reading, filtering, searching and
+   // indexing, to the shared scheduler, so the number of threads is bounded
+   // and no thread is created for each request.
+
+   struct TaskScheduler
+   {
+      // The priority of a task, from the lowest to the highest.
+      enum class Priority : std::uint8_t
+      {
+         Background,
+         Normal,
+         Interactive,
+      };
+
+      static constexpr size_t PriorityCount = 3;
+
+      // Create a scheduler with the given number of threads, or one per core if zero.
+      TaskScheduler(size_t threadCount = 0);
+
+      // Stop the threads once their current task is done.
+      // The tasks still queued are dropped: their futures report a broken promise.
+      ~TaskScheduler();
+
+      TaskScheduler(const TaskScheduler&) = delete;
+      TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+      // The scheduler shared by the whole library.
+      static TaskScheduler& GetShared();
+
+      // Count the number of threads of the scheduler.
+      size_t CountThreads() const { return _workers.size(); }
+
+      // Submit a function to be run by one of the threads, returning the future of its result.
+      template <class Func>
+      auto Submit(Func&& func, Priority priority = Priority::Normal)
+      {
+         using Result = std::invoke_result_t<std::decay_t<Func>>;
+         auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+         auto future = task->get_future();
+         Post([task]() { (*task)(); }, priority);
+         return future;
+      }
+
+      // Post a function to be run by one of the threads, without waiting for it.
+      // Note: exceptions thrown by the function are ignored.
+      void Post(std::function<void()> task, Priority priority = Priority::Normal);
+
+      // Call the function with the index of each chunk, on many threads.
+      // The calling thread also runs chunks. Returns when all chunks are done.
+      // Exceptions thrown by the function are propagated.
+      //
+      // The chunks have the priority of the task that runs them in parallel,
+      // or normal priority outside of a task.
+      void RunInParallel(size_t chunkCount, const std::function<void(size_t)>& func);
+
+   private:
+      struct Worker;
+
+      // Run the tasks of a thread, until the scheduler stops.
+      void RunWorker(size_t index);
+
+      // Take the next task for the given thread, from the highest priority,
+      // from its own queue, then from the shared queue, then from other threads.
+      bool TakeTask(size_t index, std::function<void()>& task, Priority& priority);
+
+      std::vector<std::unique_ptr<Worker>> _workers;
+
+      std::mutex _sharedMutex;
+      std::deque<std::function<void()>> _sharedTasks[PriorityCount];
+
+      // Note: the count of queued tasks is incremented before they are queued,
+      //       so a thread never waits when there is a task to run.
+      std::mutex _sleepMutex;
+      std::condition_variable _wakeUp;
+      size_t _queuedCount = 0;
+      std::atomic<bool> _stopping = false;
+   };
+}
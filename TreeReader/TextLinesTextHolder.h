@@ -11,7 +11,7 @@ namespace TreeReader
 
    struct TextLinesTextHolder : TextHolder
    {
-      typedef std::vector<std::wstring> TextLines;
+      typedef std::vector<std::string> TextLines;
 
       TextLines Lines;
    };
@@ -0,0 +1,1476 @@
+#include "TextRegex.h"
+#include "TextSearcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+namespace TreeReader
+{
+   using namespace std;
+
+   namespace
+   {
+      /////////////////////////////////////////////////////////////////////////
+      //
+      // Parsed regular expression.
+
+      constexpr uint32_t MaxCodePoint = 0x10FFFF;
+      constexpr size_t MaxRepeat = 1000;
+      constexpr size_t Unbounded = size_t(-1);
+
+      // A range of bytes, for one byte of a UTF-8 character.
+      using ByteRange = pair<uint8_t, uint8_t>;
+
+      // A sequence of byte ranges, matching a range of UTF-8 characters.
+      using ByteSequence = vector<ByteRange>;
+
+      // A set of characters, as sorted and disjoint ranges of code points.
+      using CharSet = vector<pair<uint32_t, uint32_t>>;
+
+      struct Node
+      {
+         enum class Type : uint8_t
+         {
+            Empty, Chars, Concat, Alternate, Repeat, AtStart, AtEnd, WordBoundary, NotWordBoundary,
+         };
+
+         Type Kind = Type::Empty;
+
+         // For chars: the alternative UTF-8 sequences matching one of the characters.
+         vector<ByteSequence> Sequences;
+
+         // For concat, alternate and repeat.
+         vector<Node> Children;
+         size_t Min = 0;
+         size_t Max = 0;
+         bool Lazy = false;
+      };
+
+      size_t EncodeUtf8(uint32_t cp, uint8_t (&bytes)[4])
+      {
+         if (cp < 0x80)
+         {
+            bytes[0] = uint8_t(cp);
+            return 1;
+         }
+         if (cp < 0x800)
+         {
+            bytes[0] = uint8_t(0xC0 | (cp >> 6));
+            bytes[1] = uint8_t(0x80 | (cp & 0x3F));
+            return 2;
+         }
+         if (cp < 0x10000)
+         {
+            bytes[0] = uint8_t(0xE0 | (cp >> 12));
+            bytes[1] = uint8_t(0x80 | ((cp >> 6) & 0x3F));
+            bytes[2] = uint8_t(0x80 | (cp & 0x3F));
+            return 3;
+         }
+         bytes[0] = uint8_t(0xF0 | (cp >> 18));
+         bytes[1] = uint8_t(0x80 | ((cp >> 12) & 0x3F));
+         bytes[2] = uint8_t(0x80 | ((cp >> 6) & 0x3F));
+         bytes[3] = uint8_t(0x80 | (cp & 0x3F));
+         return 4;
+      }
+
+      // Convert a range of code points to UTF-8 byte sequences.
+      //
+      // The range is split until the characters of each part all have the same
+      // length and their bytes vary independently, so each part is a sequence
+      // of byte ranges.
+      void AddUtf8Sequences(uint32_t low, uint32_t high, vector<ByteSequence>& sequences)
+      {
+         for (const uint32_t limit : { 0x7Fu, 0x7FFu, 0xFFFFu })
+         {
+            if (low <= limit && high > limit)
+            {
+               AddUtf8Sequences(low, limit, sequences);
+               AddUtf8Sequences(limit + 1, high, sequences);
+               return;
+            }
+         }
+
+         if (high >= 0x80)
+         {
+            for (uint32_t i = 1; i < 4; ++i)
+            {
+               const uint32_t mask = (1u << (6 * i)) - 1;
+               if ((low & ~mask) == (high & ~mask))
+                  continue;
+               if ((low & mask) != 0)
+               {
+                  AddUtf8Sequences(low, low | mask, sequences);
+                  AddUtf8Sequences((low | mask) + 1, high, sequences);
+                  return;
+               }
+               if ((high & mask) != mask)
+               {
+                  AddUtf8Sequences(low, (high & ~mask) - 1, sequences);
+                  AddUtf8Sequences(high & ~mask, high, sequences);
+                  return;
+               }
+            }
+         }
+
+         uint8_t lowBytes[4], highBytes[4];
+         const size_t count = EncodeUtf8(low, lowBytes);
+         EncodeUtf8(high, highBytes);
+
+         ByteSequence sequence;
+         for (size_t i = 0; i < count; ++i)
+            sequence.emplace_back(lowBytes[i], highBytes[i]);
+         sequences.emplace_back(move(sequence));
+      }
+
+      CharSet NormalizeCharSet(CharSet set)
+      {
+         sort(set.begin(), set.end());
+
+         CharSet merged;
+         for (const auto& range : set)
+         {
+            if (!merged.empty() && range.first <= merged.back().second + 1)
+               merged.back().second = max(merged.back().second, range.second);
+            else
+               merged.emplace_back(range);
+         }
+         return merged;
+      }
+
+      CharSet NegateCharSet(const CharSet& set)
+      {
+         CharSet negated;
+         uint32_t next = 0;
+         for (const auto& range : NormalizeCharSet(set))
+         {
+            if (range.first > next)
+               negated.emplace_back(next, range.first - 1);
+            next = range.second + 1;
+         }
+         if (next <= MaxCodePoint)
+            negated.emplace_back(next, MaxCodePoint);
+         return negated;
+      }
+
+      Node MakeChars(const CharSet& set)
+      {
+         Node node;
+         node.Kind = Node::Type::Chars;
+         for (const auto& range : NormalizeCharSet(set))
+            AddUtf8Sequences(range.first, range.second, node.Sequences);
+         return node;
+      }
+
+      // Parses the text form of a regular expression.
+      //
+      // Throws the error message when the text form is invalid.
+
+      struct Parser
+      {
+         Parser(const wstring& textForm)
+         {
+            // Note: wide text can use UTF-16 surrogate pairs.
+            for (size_t i = 0; i < textForm.size(); ++i)
+            {
+               uint32_t cp = uint32_t(textForm[i]);
+               if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < textForm.size() && textForm[i + 1] >= 0xDC00 && textForm[i + 1] < 0xE000)
+                  cp = 0x10000 + ((cp - 0xD800) << 10) + (uint32_t(textForm[++i]) - 0xDC00);
+               _text.push_back(min(cp, MaxCodePoint));
+            }
+         }
+
+         Node Parse()
+         {
+            Node node = ParseAlternate();
+            if (_pos < _text.size())
+               throw wstring(L"Unmatched closing parenthesis.");
+            return node;
+         }
+
+      private:
+         bool IsAtEnd() const { return _pos >= _text.size(); }
+         uint32_t Peek() const { return IsAtEnd() ? 0 : _text[_pos]; }
+         bool Accept(uint32_t c)
+         {
+            if (IsAtEnd() || _text[_pos] != c)
+               return false;
+            ++_pos;
+            return true;
+         }
+
+         Node ParseAlternate()
+         {
+            Node node = ParseConcat();
+            if (Peek() != '|')
+               return node;
+
+            Node alternate;
+            alternate.Kind = Node::Type::Alternate;
+            alternate.Children.emplace_back(move(node));
+            while (Accept('|'))
+               alternate.Children.emplace_back(ParseConcat());
+            return alternate;
+         }
+
+         Node ParseConcat()
+         {
+            Node concat;
+            concat.Kind = Node::Type::Concat;
+            while (!IsAtEnd() && Peek() != '|' && Peek() != ')')
+               concat.Children.emplace_back(ParseRepeat());
+            return concat;
+         }
+
+         Node ParseRepeat()
+         {
+            Node node = ParseAtom();
+            while (!IsAtEnd())
+            {
+               size_t min = 0, max = Unbounded;
+               if (Accept('*'))
+               {
+               }
+               else if (Accept('+'))
+               {
+                  min = 1;
+               }
+               else if (Accept('?'))
+               {
+                  max = 1;
+               }
+               else if (Peek() == '{' && ParseCount(min, max))
+               {
+               }
+               else
+               {
+                  break;
+               }
+
+               Node repeat;
+               repeat.Kind = Node::Type::Repeat;
+               repeat.Min = min;
+               repeat.Max = max;
+               repeat.Lazy = Accept('?');
+               repeat.Children.emplace_back(move(node));
+               node = move(repeat);
+            }
+            return node;
+         }
+
+         // Parse a count in braces. If it is not a valid count, the brace is a normal character.
+         bool ParseCount(size_t& min, size_t& max)
+         {
+            const size_t start = _pos++;
+            if (!ParseNumber(min))
+            {
+               _pos = start;
+               return false;
+            }
+
+            max = min;
+            if (Accept(','))
+            {
+               max = Unbounded;
+               if (Peek() != '}' && !ParseNumber(max))
+               {
+                  _pos = start;
+                  return false;
+               }
+            }
+
+            if (!Accept('}'))
+            {
+               _pos = start;
+               return false;
+            }
+
+            if (max < min)
+               throw wstring(L"Invalid repeat count.");
+            if (min > MaxRepeat || (max != Unbounded && max > MaxRepeat))
+               throw wstring(L"Repeat count is too large.");
+            return true;
+         }
+
+         bool ParseNumber(size_t& number)
+         {
+            if (Peek() < '0' || Peek() > '9')
+               return false;
+            number = 0;
+            while (Peek() >= '0' && Peek() <= '9')
+               number = min<size_t>(number * 10 + (_text[_pos++] - '0'), MaxRepeat + 1);
+            return true;
+         }
+
+         Node ParseAtom()
+         {
+            const uint32_t c = _text[_pos++];
+            switch (c)
+            {
+               case '(':
+               {
+                  if (Accept('?'))
+                  {
+                     if (!Accept(':'))
+                        throw wstring(L"Look-aheads are not supported.");
+                  }
+                  Node node = ParseAlternate();
+                  if (!Accept(')'))
+                     throw wstring(L"Missing closing parenthesis.");
+                  return node;
+               }
+               case '[':
+                  return MakeChars(ParseClass());
+               case '.':
+                  return MakeChars(NegateCharSet({ { '\n', '\n' }, { '\r', '\r' } }));
+               case '^':
+               {
+                  Node node;
+                  node.Kind = Node::Type::AtStart;
+                  return node;
+               }
+               case '$':
+               {
+                  Node node;
+                  node.Kind = Node::Type::AtEnd;
+                  return node;
+               }
+               case '\\':
+               {
+                  if (Peek() == 'b' || Peek() == 'B')
+                  {
+                     Node node;
+                     node.Kind = (_text[_pos++] == 'b') ? Node::Type::WordBoundary : Node::Type::NotWordBoundary;
+                     return node;
+                  }
+                  return MakeChars(ParseEscape());
+               }
+               case '*':
+               case '+':
+               case '?':
+                  throw wstring(L"Nothing to repeat.");
+               case ')':
+                  throw wstring(L"Unmatched closing parenthesis.");
+               default:
+                  return MakeChars({ { c, c } });
+            }
+         }
+
+         CharSet ParseClass()
+         {
+            const bool negated = Accept('^');
+
+            CharSet set;
+            while (!Accept(']'))
+            {
+               if (IsAtEnd())
+                  throw wstring(L"Missing closing bracket.");
+
+               CharSet item = ParseClassItem();
+               if (item.size() == 1 && item[0].first == item[0].second && Peek() == '-' && _pos + 1 < _text.size() && _text[_pos + 1] != ']')
+               {
+                  ++_pos;
+                  const CharSet last = ParseClassItem();
+                  if (last.size() != 1 || last[0].first != last[0].second || last[0].first < item[0].first)
+                     throw wstring(L"Invalid range in brackets.");
+                  item[0].second = last[0].first;
+               }
+               set.insert(set.end(), item.begin(), item.end());
+            }
+
+            return negated ? NegateCharSet(set) : set;
+         }
+
+         CharSet ParseClassItem()
+         {
+            const uint32_t c = _text[_pos++];
+            if (c == '\\')
+               return ParseEscape();
+            return { { c, c } };
+         }
+
+         // Note: word boundaries are parsed with the atoms, so \b is a backspace here.
+         CharSet ParseEscape()
+         {
+            if (IsAtEnd())
+               throw wstring(L"Trailing backslash.");
+
+            const CharSet digits = { { '0', '9' } };
+            const CharSet words = { { '0', '9' }, { 'A', 'Z' }, { '_', '_' }, { 'a', 'z' } };
+            const CharSet spaces = { { '\t', '\r' }, { ' ', ' ' } };
+
+            const uint32_t c = _text[_pos++];
+            switch (c)
+            {
+               case 'd': return digits;
+               case 'D': return NegateCharSet(digits);
+               case 'w': return words;
+               case 'W': return NegateCharSet(words);
+               case 's': return spaces;
+               case 'S': return NegateCharSet(spaces);
+               case 't': return { { '\t', '\t' } };
+               case 'n': return { { '\n', '\n' } };
+               case 'r': return { { '\r', '\r' } };
+               case 'f': return { { '\f', '\f' } };
+               case 'v': return { { '\v', '\v' } };
+               case '0': return { { 0, 0 } };
+               case 'x':
+               case 'u':
+               {
+                  const uint32_t cp = ParseHex(c == 'x' ? 2 : 4);
+                  return { { cp, cp } };
+               }
+               case 'b':
+                  return { { '\b', '\b' } };
+               default:
+                  if (c >= '1' && c <= '9')
+                     throw wstring(L"Back-references are not supported.");
+                  return { { c, c } };
+            }
+         }
+
+         uint32_t ParseHex(size_t count)
+         {
+            uint32_t value = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+               const uint32_t c = Peek();
+               if (c >= '0' && c <= '9')
+                  value = value * 16 + (c - '0');
+               else if (c >= 'a' && c <= 'f')
+                  value = value * 16 + (c - 'a' + 10);
+               else if (c >= 'A' && c <= 'F')
+                  value = value * 16 + (c - 'A' + 10);
+               else
+                  throw wstring(L"Invalid hexadecimal escape.");
+               ++_pos;
+            }
+            return value;
+         }
+
+         vector<uint32_t> _text;
+         size_t _pos = 0;
+      };
+
+      // The text that every match must contain, to be searched before matching.
+      struct RequiredText
+      {
+         bool IsWhole = false;
+         string Whole;
+         string Best;
+      };
+
+      RequiredText FindRequiredText(const Node& node)
+      {
+         RequiredText required;
+         switch (node.Kind)
+         {
+            case Node::Type::Empty:
+            case Node::Type::AtStart:
+            case Node::Type::AtEnd:
+            case Node::Type::WordBoundary:
+            case Node::Type::NotWordBoundary:
+               required.IsWhole = true;
+               break;
+
+            case Node::Type::Chars:
+               if (node.Sequences.size() == 1 && all_of(node.Sequences[0].begin(), node.Sequences[0].end(), [](const ByteRange& range) { return range.first == range.second; }))
+               {
+                  required.IsWhole = true;
+                  for (const auto& range : node.Sequences[0])
+                     required.Whole += char(range.first);
+                  required.Best = required.Whole;
+               }
+               break;
+
+            case Node::Type::Concat:
+            {
+               // Note: consecutive whole texts form a longer required text.
+               required.IsWhole = true;
+               string run;
+               for (const Node& child : node.Children)
+               {
+                  const RequiredText childText = FindRequiredText(child);
+                  if (childText.Best.size() > required.Best.size())
+                     required.Best = childText.Best;
+
+                  if (childText.IsWhole)
+                  {
+                     run += childText.Whole;
+                  }
+                  else
+                  {
+                     required.IsWhole = false;
+                     run.clear();
+                  }
+
+                  if (run.size() > required.Best.size())
+                     required.Best = run;
+               }
+               if (required.IsWhole)
+                  required.Whole = run;
+               break;
+            }
+
+            case Node::Type::Repeat:
+               if (node.Min > 0)
+               {
+                  const RequiredText childText = FindRequiredText(node.Children[0]);
+                  required.Best = childText.Best;
+                  if (node.Min == 1 && node.Max == 1)
+                     required = childText;
+               }
+               break;
+
+            case Node::Type::Alternate:
+               break;
+         }
+         return required;
+      }
+
+      /////////////////////////////////////////////////////////////////////////
+      //
+      // Automaton without determinism.
+
+      struct NfaState
+      {
+         enum class Type : uint8_t
+         {
+            Bytes, Split, Match, Fail, AtStart, AtEnd, WordBoundary, NotWordBoundary,
+         };
+
+         Type Kind = Type::Match;
+         uint8_t Low = 0;
+         uint8_t High = 0;
+
+         // Note: for a split, the next state is preferred over the other one.
+         uint32_t Next = 0;
+         uint32_t OtherNext = 0;
+      };
+
+      struct Nfa
+      {
+         vector<NfaState> States;
+         uint32_t Start = 0;
+         bool HasWordBoundaries = false;
+
+         // The bytes that always go to the same states share a class.
+         uint8_t ByteClasses[256] = {};
+         size_t ClassCount = 1;
+      };
+
+      // Note: like ECMAScript, only ASCII letters, digits and underscore form words.
+      bool IsWordByte(uint8_t byte)
+      {
+         return (byte >= '0' && byte <= '9') || (byte >= 'A' && byte <= 'Z') || byte == '_' || (byte >= 'a' && byte <= 'z');
+      }
+
+      // Verify if the byte continues a UTF-8 character, so that the position before it is inside that character.
+      bool IsContinuationByte(uint8_t byte)
+      {
+         return (byte & 0xC0) == 0x80;
+      }
+
+      // What is known around the position where the states without a byte are followed.
+      //
+      // Word boundaries need the byte after the position, so they are only followed
+      // once that byte is known. Until then, their states are kept waiting.
+
+      struct Context
+      {
+         bool AtStart = false;
+         bool AtEnd = false;
+         bool IsNextKnown = false;
+         bool IsPreviousWord = false;
+         bool IsNextWord = false;
+      };
+
+      // The context at a position of a text, where everything is known.
+      Context GetContext(string_view text, size_t pos)
+      {
+         Context context;
+         context.AtStart = (pos == 0);
+         context.AtEnd = (pos == text.size());
+         context.IsNextKnown = true;
+         context.IsPreviousWord = pos > 0 && IsWordByte(uint8_t(text[pos - 1]));
+         context.IsNextWord = pos < text.size() && IsWordByte(uint8_t(text[pos]));
+         return context;
+      }
+
+      // Verify if the state of an assertion can be followed in the given context.
+      bool IsFollowed(const NfaState& state, const Context& context)
+      {
+         switch (state.Kind)
+         {
+            case NfaState::Type::AtStart:
+               return context.AtStart;
+            case NfaState::Type::AtEnd:
+               return context.AtEnd;
+            case NfaState::Type::WordBoundary:
+               return context.IsNextKnown && context.IsPreviousWord != context.IsNextWord;
+            case NfaState::Type::NotWordBoundary:
+               return context.IsNextKnown && context.IsPreviousWord == context.IsNextWord;
+            default:
+               return false;
+         }
+      }
+
+      // Verify if a node can match without reading a character.
+      bool CanBeEmpty(const Node& node)
+      {
+         switch (node.Kind)
+         {
+            case Node::Type::Chars:
+               return false;
+            case Node::Type::Concat:
+               return all_of(node.Children.begin(), node.Children.end(), CanBeEmpty);
+            case Node::Type::Alternate:
+               return any_of(node.Children.begin(), node.Children.end(), CanBeEmpty);
+            case Node::Type::Repeat:
+               return node.Min == 0 || CanBeEmpty(node.Children[0]);
+            default:
+               return true;
+         }
+      }
+
+      // Builds the automaton from the last state to the first, each node
+      // being given the state that follows it.
+      //
+      // Like ECMAScript, an optional repeat fails when it reads no character,
+      // so that the repeated node is tried further or the repeat stops. For
+      // this, the repeated node is built as a second copy that only leads to
+      // the repeat again after reading a character, and fails otherwise.
+      //
+      // The reversed automaton matches the reversed texts, and is used to find
+      // where matches start.
+
+      struct NfaBuilder
+      {
+         NfaBuilder(Nfa& nfa, bool reversed) : _nfa(nfa), _reversed(reversed) { }
+
+         void Build(const Node& node)
+         {
+            _nfa.States.clear();
+            const uint32_t match = Add(NfaState());
+            NfaState fail;
+            fail.Kind = NfaState::Type::Fail;
+            _fail = Add(fail);
+            _nfa.Start = Build(node, match);
+
+            bool boundaries[257] = {};
+            boundaries[0] = true;
+            for (const NfaState& state : _nfa.States)
+            {
+               if (state.Kind == NfaState::Type::Bytes)
+               {
+                  boundaries[state.Low] = true;
+                  boundaries[state.High + 1] = true;
+               }
+               else if (state.Kind == NfaState::Type::WordBoundary || state.Kind == NfaState::Type::NotWordBoundary)
+               {
+                  _nfa.HasWordBoundaries = true;
+               }
+            }
+
+            // Note: matches only start between characters, so the bytes that continue a character are apart.
+            boundaries[0x80] = true;
+            boundaries[0xC0] = true;
+
+            // Note: word boundaries depend on the bytes being part of words.
+            if (_nfa.HasWordBoundaries)
+               for (size_t b = 1; b < 256; ++b)
+                  if (IsWordByte(uint8_t(b)) != IsWordByte(uint8_t(b - 1)))
+                     boundaries[b] = true;
+
+            size_t charClass = 0;
+            for (size_t b = 0; b < 256; ++b)
+            {
+               if (b > 0 && boundaries[b])
+                  ++charClass;
+               _nfa.ByteClasses[b] = uint8_t(charClass);
+            }
+            _nfa.ClassCount = charClass + 1;
+         }
+
+      private:
+         uint32_t Add(const NfaState& state)
+         {
+            if (_nfa.States.size() > 1000000)
+               throw wstring(L"The regular expression is too large.");
+            _nfa.States.emplace_back(state);
+            return uint32_t(_nfa.States.size() - 1);
+         }
+
+         uint32_t AddSplit(uint32_t next, uint32_t otherNext)
+         {
+            NfaState state;
+            state.Kind = NfaState::Type::Split;
+            state.Next = next;
+            state.OtherNext = otherNext;
+            return Add(state);
+         }
+
+         uint32_t Build(const Node& node, uint32_t next)
+         {
+            switch (node.Kind)
+            {
+               default:
+               case Node::Type::Empty:
+                  return next;
+
+               case Node::Type::AtStart:
+               case Node::Type::AtEnd:
+               {
+                  // Note: in reverse, the start of the text is where the reversed text ends.
+                  NfaState state;
+                  state.Kind = ((node.Kind == Node::Type::AtStart) != _reversed) ? NfaState::Type::AtStart : NfaState::Type::AtEnd;
+                  state.Next = next;
+                  return Add(state);
+               }
+
+               case Node::Type::WordBoundary:
+               case Node::Type::NotWordBoundary:
+               {
+                  // Note: word boundaries are the same in reverse.
+                  NfaState state;
+                  state.Kind = (node.Kind == Node::Type::WordBoundary) ? NfaState::Type::WordBoundary : NfaState::Type::NotWordBoundary;
+                  state.Next = next;
+                  return Add(state);
+               }
+
+               case Node::Type::Chars:
+               {
+                  if (node.Sequences.empty())
+                  {
+                     // Note: a class matching no character leads to a state that never matches.
+                     NfaState state;
+                     state.Kind = NfaState::Type::Bytes;
+                     state.Low = 1;
+                     state.High = 0;
+                     state.Next = next;
+                     return Add(state);
+                  }
+
+                  uint32_t entry = InvalidState;
+                  for (const ByteSequence& sequence : node.Sequences)
+                  {
+                     uint32_t sequenceEntry = next;
+                     for (size_t i = 0; i < sequence.size(); ++i)
+                     {
+                        const ByteRange& range = _reversed ? sequence[i] : sequence[sequence.size() - 1 - i];
+                        NfaState state;
+                        state.Kind = NfaState::Type::Bytes;
+                        state.Low = range.first;
+                        state.High = range.second;
+                        state.Next = sequenceEntry;
+                        sequenceEntry = Add(state);
+                     }
+                     entry = (entry == InvalidState) ? sequenceEntry : AddSplit(sequenceEntry, entry);
+                  }
+                  return entry;
+               }
+
+               case Node::Type::Concat:
+                  if (_reversed)
+                  {
+                     for (const Node& child : node.Children)
+                        next = Build(child, next);
+                  }
+                  else
+                  {
+                     for (auto child = node.Children.rbegin(); child != node.Children.rend(); ++child)
+                        next = Build(*child, next);
+                  }
+                  return next;
+
+               case Node::Type::Alternate:
+               {
+                  // Note: the first alternatives are preferred.
+                  uint32_t entry = InvalidState;
+                  for (auto child = node.Children.rbegin(); child != node.Children.rend(); ++child)
+                  {
+                     const uint32_t childEntry = Build(*child, next);
+                     entry = (entry == InvalidState) ? childEntry : AddSplit(childEntry, entry);
+                  }
+                  return entry;
+               }
+
+               case Node::Type::Repeat:
+               {
+                  const Node& child = node.Children[0];
+
+                  next = BuildOptionalRepeat(node, next, next);
+                  for (size_t i = 0; i < node.Min; ++i)
+                     next = Build(child, next);
+
+                  return next;
+               }
+            }
+         }
+
+         // Build the node so that it leads to the first state after reading a character,
+         // and to the second state otherwise.
+         uint32_t BuildTracked(const Node& node, uint32_t next, uint32_t emptyNext)
+         {
+            if (next == emptyNext || !CanBeEmpty(node))
+               return Build(node, next);
+
+            switch (node.Kind)
+            {
+               default:
+               case Node::Type::Empty:
+                  return emptyNext;
+
+               case Node::Type::AtStart:
+               case Node::Type::AtEnd:
+               case Node::Type::WordBoundary:
+               case Node::Type::NotWordBoundary:
+                  return Build(node, emptyNext);
+
+               case Node::Type::Concat:
+               {
+                  // Note: once a child has read a character, the following children are built as usual.
+                  const auto buildChild = [&](const Node& child, bool isFirst)
+                  {
+                     emptyNext = BuildTracked(child, next, emptyNext);
+                     if (!isFirst)
+                        next = Build(child, next);
+                  };
+
+                  if (_reversed)
+                  {
+                     for (size_t i = 0; i < node.Children.size(); ++i)
+                        buildChild(node.Children[i], i + 1 == node.Children.size());
+                  }
+                  else
+                  {
+                     for (size_t i = node.Children.size(); i > 0; --i)
+                        buildChild(node.Children[i - 1], i == 1);
+                  }
+                  return emptyNext;
+               }
+
+               case Node::Type::Alternate:
+               {
+                  uint32_t entry = InvalidState;
+                  for (auto child = node.Children.rbegin(); child != node.Children.rend(); ++child)
+                  {
+                     const uint32_t childEntry = BuildTracked(*child, next, emptyNext);
+                     entry = (entry == InvalidState) ? childEntry : AddSplit(childEntry, entry);
+                  }
+                  return entry;
+               }
+
+               case Node::Type::Repeat:
+               {
+                  const Node& child = node.Children[0];
+
+                  emptyNext = BuildOptionalRepeat(node, next, emptyNext);
+                  next = BuildOptionalRepeat(node, next, next);
+                  for (size_t i = 0; i < node.Min; ++i)
+                  {
+                     const bool isFirst = (i + 1 == node.Min);
+                     emptyNext = BuildTracked(child, next, emptyNext);
+                     if (!isFirst)
+                        next = Build(child, next);
+                  }
+                  return emptyNext;
+               }
+            }
+         }
+
+         // Build the optional or unbounded repeats, which come after the required ones.
+         // Repeating again is preferred over going on, unless the repeat is lazy.
+         // Going on leads to the first state after reading a character, and to the second state otherwise.
+         uint32_t BuildOptionalRepeat(const Node& node, uint32_t next, uint32_t emptyNext)
+         {
+            const Node& child = node.Children[0];
+
+            if (node.Max == Unbounded)
+            {
+               const uint32_t loop = AddSplit(InvalidState, InvalidState);
+               const uint32_t again = BuildTracked(child, loop, _fail);
+               _nfa.States[loop].Next = node.Lazy ? next : again;
+               _nfa.States[loop].OtherNext = node.Lazy ? again : next;
+               if (emptyNext == next)
+                  return loop;
+               return node.Lazy ? AddSplit(emptyNext, again) : AddSplit(again, emptyNext);
+            }
+
+            // Note: not repeating again goes on after the whole repeat, not to the following optional repeats.
+            const uint32_t after = next;
+            const uint32_t emptyAfter = emptyNext;
+            for (size_t i = node.Min; i < node.Max; ++i)
+            {
+               const uint32_t again = BuildTracked(child, next, _fail);
+               next = node.Lazy ? AddSplit(after, again) : AddSplit(again, after);
+               if (emptyAfter != after)
+                  emptyNext = node.Lazy ? AddSplit(emptyAfter, again) : AddSplit(again, emptyAfter);
+               else
+                  emptyNext = next;
+            }
+            return emptyNext;
+         }
+
+         static constexpr uint32_t InvalidState = uint32_t(-1);
+
+         Nfa& _nfa;
+         const bool _reversed;
+         uint32_t _fail = InvalidState;
+      };
+   }
+
+   /////////////////////////////////////////////////////////////////////////
+   //
+   // Compiled regular expression, shared between copies.
+
+   struct TextRegex::Program
+   {
+      Nfa Forward;
+      Nfa Reversed;
+      TextSearcher Required;
+      bool HasRequired = false;
+   };
+
+   /////////////////////////////////////////////////////////////////////////
+   //
+   // Automaton with its deterministic states built as needed.
+   //
+   // Each deterministic state is a set of states of the automaton without
+   // determinism, with the context of the previous byte. The states waiting
+   // for the next byte, like word boundaries, are followed when reading it,
+   // so a state tells if there is a match before the next byte, given whether
+   // that byte is part of a word or continues a character. When too many states
+   // have been built, they are all forgotten and rebuilt as needed, to limit the
+   // memory used.
+   //
+   // When searching, a match can start between any two characters: going forward,
+   // before a byte that begins a character, and going backward, after such a byte.
+   // When anchored, the matches all
+   // start where the automaton started and its states are kept in order of
+   // priority, as the matcher below does: the states of lower priority than
+   // a match are dropped, so the last match found is the preferred one.
+
+   struct TextRegex::Automaton
+   {
+      static constexpr uint32_t Unknown = uint32_t(-1);
+      static constexpr size_t MaxStates = 4096;
+
+      Automaton(const Nfa& nfa, bool reversed, bool anchored) : _nfa(nfa), _reversed(reversed), _anchored(anchored) { }
+
+      // The state before reading any character, given what is before.
+      uint32_t GetStart(bool atStart, bool isPreviousWord)
+      {
+         isPreviousWord = _nfa.HasWordBoundaries && isPreviousWord;
+         uint32_t& start = _starts[(atStart ? 1 : 0) | (isPreviousWord ? 2 : 0)];
+         if (start == Unknown)
+         {
+            Context context;
+            context.AtStart = atStart;
+
+            vector<uint32_t> nfaStates;
+            StartSet();
+            AddClosure(_nfa.Start, context, nfaStates);
+            start = AddState(move(nfaStates), atStart, isPreviousWord);
+         }
+         return start;
+      }
+
+      // The state after reading the byte.
+      uint32_t GetNext(uint32_t state, uint8_t byte)
+      {
+         const size_t transition = state * _nfa.ClassCount + _nfa.ByteClasses[byte];
+         if (_transitions[transition] != Unknown)
+            return _transitions[transition];
+
+         vector<uint32_t> beforeByte = Expand(_states[state], GetNextKind(byte), false);
+         if (_anchored)
+            DropAfterMatch(beforeByte);
+
+         vector<uint32_t> nfaStates;
+         StartSet();
+         for (const uint32_t nfaState : beforeByte)
+         {
+            const NfaState& s = _nfa.States[nfaState];
+            if (s.Kind == NfaState::Type::Bytes && s.Low <= byte && byte <= s.High)
+               AddClosure(s.Next, Context(), nfaStates);
+         }
+
+         // Note: when searching backward, a match can start after any byte that begins a character.
+         if (!_anchored && _reversed && !IsContinuationByte(byte))
+            AddClosure(_nfa.Start, Context(), nfaStates);
+
+         // Note: the previous byte is only part of the state when it can change the matches.
+         const bool isWord = _nfa.HasWordBoundaries && IsWordByte(byte);
+
+         if (_states.size() >= MaxStates)
+         {
+            Clear();
+            return AddState(move(nfaStates), false, isWord);
+         }
+
+         const uint32_t next = AddState(move(nfaStates), false, isWord);
+         _transitions[state * _nfa.ClassCount + _nfa.ByteClasses[byte]] = next;
+         return next;
+      }
+
+      // Verify if there is a match before the given byte, or before the end.
+      bool IsMatch(uint32_t state, uint8_t byte) const { return _states[state].IsMatchBefore[GetNextKind(byte)]; }
+      bool IsMatchAtEnd(uint32_t state) const { return _states[state].IsMatchAtEnd; }
+
+      // Verify if no match can be found anymore.
+      // Note: when searching, a match can always start further.
+      bool IsDead(uint32_t state) const { return _anchored && _states[state].NfaStates.empty(); }
+
+   private:
+      // What the next byte can be, as far as the matches are concerned.
+      enum NextKind : uint8_t { NextOther, NextWord, NextContinues, NextKindCount };
+
+      NextKind GetNextKind(uint8_t byte) const
+      {
+         if (IsContinuationByte(byte))
+            return NextContinues;
+         return (_nfa.HasWordBoundaries && IsWordByte(byte)) ? NextWord : NextOther;
+      }
+
+      struct State
+      {
+         vector<uint32_t> NfaStates;
+         bool AtStart = false;
+         bool IsPreviousWord = false;
+         bool IsMatchBefore[NextKindCount] = {};
+         bool IsMatchAtEnd = false;
+      };
+
+      // Start a new set of states.
+      void StartSet()
+      {
+         if (_visited.size() != _nfa.States.size())
+            _visited.assign(_nfa.States.size(), 0);
+         if (++_generation == 0)
+         {
+            fill(_visited.begin(), _visited.end(), 0);
+            _generation = 1;
+         }
+      }
+
+      // Add the states reached without reading a character to the current set.
+      // Note: the states of assertions are kept, as they may be followed once more is known.
+      void AddClosure(uint32_t nfaState, const Context& context, vector<uint32_t>& nfaStates)
+      {
+         vector<uint32_t> toVisit{ nfaState };
+         while (!toVisit.empty())
+         {
+            const uint32_t index = toVisit.back();
+            toVisit.pop_back();
+
+            if (_visited[index] == _generation)
+               continue;
+            _visited[index] = _generation;
+            nfaStates.push_back(index);
+
+            const NfaState& state = _nfa.States[index];
+            if (state.Kind == NfaState::Type::Split)
+            {
+               toVisit.push_back(state.OtherNext);
+               toVisit.push_back(state.Next);
+            }
+            else if (IsFollowed(state, context))
+            {
+               toVisit.push_back(state.Next);
+            }
+         }
+      }
+
+      // The states of a deterministic state once the next byte, or the end, is known.
+      vector<uint32_t> Expand(const State& state, NextKind next, bool atEnd)
+      {
+         Context context;
+         context.AtStart = state.AtStart;
+         context.AtEnd = atEnd;
+         context.IsNextKnown = true;
+         context.IsPreviousWord = state.IsPreviousWord;
+         context.IsNextWord = (next == NextWord);
+
+         vector<uint32_t> nfaStates;
+         StartSet();
+         for (const uint32_t index : state.NfaStates)
+            AddClosure(index, context, nfaStates);
+
+         // Note: when searching forward, a match can start before any byte that begins a character, and at the end.
+         if (!_anchored && !_reversed && next != NextContinues)
+            AddClosure(_nfa.Start, context, nfaStates);
+
+         return nfaStates;
+      }
+
+      bool HasMatch(const vector<uint32_t>& nfaStates) const
+      {
+         return any_of(nfaStates.begin(), nfaStates.end(), [this](uint32_t index) { return _nfa.States[index].Kind == NfaState::Type::Match; });
+      }
+
+      // Drop the states of lower priority than a match.
+      void DropAfterMatch(vector<uint32_t>& nfaStates) const
+      {
+         const auto match = find_if(nfaStates.begin(), nfaStates.end(), [this](uint32_t index) { return _nfa.States[index].Kind == NfaState::Type::Match; });
+         if (match != nfaStates.end())
+            nfaStates.erase(match + 1, nfaStates.end());
+      }
+
+      uint32_t AddState(vector<uint32_t> nfaStates, bool atStart, bool isPreviousWord)
+      {
+         // Note: only the states that read a character, match or wait for more context matter to tell states apart.
+         nfaStates.erase(remove_if(nfaStates.begin(), nfaStates.end(), [this](uint32_t index)
+         {
+            const NfaState::Type kind = _nfa.States[index].Kind;
+            return kind == NfaState::Type::Split || kind == NfaState::Type::Fail || kind == NfaState::Type::AtStart;
+         }), nfaStates.end());
+         if (!_anchored)
+            sort(nfaStates.begin(), nfaStates.end());
+
+         const auto key = make_pair(nfaStates, uint8_t((atStart ? 1 : 0) | (isPreviousWord ? 2 : 0)));
+         if (const auto pos = _stateIndexes.find(key); pos != _stateIndexes.end())
+            return pos->second;
+
+         State state;
+         state.NfaStates = move(nfaStates);
+         state.AtStart = atStart;
+         state.IsPreviousWord = isPreviousWord;
+         for (uint8_t next = 0; next < NextKindCount; ++next)
+            state.IsMatchBefore[next] = HasMatch(Expand(state, NextKind(next), false));
+         state.IsMatchAtEnd = HasMatch(Expand(state, NextOther, true));
+
+         _states.emplace_back(move(state));
+         _transitions.resize(_states.size() * _nfa.ClassCount, Unknown);
+
+         const uint32_t index = uint32_t(_states.size() - 1);
+         _stateIndexes.emplace(key, index);
+         return index;
+      }
+
+      void Clear()
+      {
+         _states.clear();
+         _transitions.clear();
+         _stateIndexes.clear();
+         fill(begin(_starts), end(_starts), Unknown);
+      }
+
+      const Nfa& _nfa;
+      const bool _reversed;
+      const bool _anchored;
+
+      vector<State> _states;
+      vector<uint32_t> _transitions;
+      map<pair<vector<uint32_t>, uint8_t>, uint32_t> _stateIndexes;
+      uint32_t _starts[4] = { Unknown, Unknown, Unknown, Unknown };
+
+      vector<uint32_t> _visited;
+      uint32_t _generation = 0;
+   };
+
+   /////////////////////////////////////////////////////////////////////////
+   //
+   // Finds the matches by following all the states of the automaton without
+   // determinism at once, each with the position where its match started.
+   //
+   // The states are kept in order of priority: earlier starts first, then
+   // the first alternatives and the preferred repeats, so the matches are
+   // those of ECMAScript. A state reached again is dropped, as it was reached
+   // with a higher priority, so each byte is read at most once per state.
+   //
+   // The matches after the current one are looked for in the same pass:
+   // states that start after the end of a possible match are kept, since
+   // they remain valid whether that match is kept or replaced by a longer
+   // one of higher priority, which also drops them.
+
+   struct TextRegex::Matcher
+   {
+      Matcher(const Nfa& nfa) : _nfa(nfa), _visited(nfa.States.size(), 0) { }
+
+      // Find the matches starting at the possible starts, from the given position.
+      void FindAll(string_view text, const vector<bool>& isStart, size_t from, vector<string_view>& matches)
+      {
+         const auto startOf = [&text](string_view match) { return size_t(match.data() - text.data()); };
+
+         _current.clear();
+         for (size_t pos = from; ; ++pos)
+         {
+            // Note: when no match is in progress, skip to where the next one can start.
+            if (_current.empty())
+            {
+               while (pos < text.size() && !isStart[pos])
+                  ++pos;
+               if (!isStart[pos])
+                  return;
+            }
+
+            // Note: the new start is not merged with the states of earlier starts,
+            //       since it is still valid when they end with a match here.
+            if (isStart[pos])
+            {
+               NextGeneration();
+               AddThreads(_current, _nfa.Start, pos, GetContext(text, pos));
+            }
+
+            NextGeneration();
+            _next.clear();
+            const Context nextContext = (pos < text.size()) ? GetContext(text, pos + 1) : Context();
+            for (size_t i = 0; i < _current.size(); ++i)
+            {
+               const Thread thread = _current[i];
+               const NfaState& state = _nfa.States[thread.State];
+               if (state.Kind == NfaState::Type::Match)
+               {
+                  // The match replaces the ones found by states of lower priority.
+                  while (!matches.empty() && startOf(matches.back()) >= thread.Start)
+                     matches.pop_back();
+                  matches.emplace_back(text.substr(thread.Start, pos - thread.Start));
+
+                  // The states of lower priority are dropped, except those starting here
+                  // after a non-empty match, since they are placed last.
+                  if (thread.Start == pos)
+                     break;
+                  while (i + 1 < _current.size() && _current[i + 1].Start < pos)
+                     ++i;
+               }
+               else if (pos < text.size() && state.Low <= uint8_t(text[pos]) && uint8_t(text[pos]) <= state.High)
+               {
+                  AddThreads(_next, state.Next, thread.Start, nextContext);
+               }
+            }
+
+            if (pos == text.size())
+               return;
+
+            swap(_current, _next);
+         }
+      }
+
+   private:
+      struct Thread
+      {
+         uint32_t State = 0;
+         size_t Start = 0;
+      };
+
+      void NextGeneration()
+      {
+         if (++_generation == 0)
+         {
+            fill(_visited.begin(), _visited.end(), 0);
+            _generation = 1;
+         }
+      }
+
+      // Add the states reading a byte or matching, reached without reading a byte, in order of priority.
+      void AddThreads(vector<Thread>& threads, uint32_t nfaState, size_t start, const Context& context)
+      {
+         _toVisit.clear();
+         _toVisit.push_back(nfaState);
+         while (!_toVisit.empty())
+         {
+            const uint32_t index = _toVisit.back();
+            _toVisit.pop_back();
+
+            if (_visited[index] == _generation)
+               continue;
+            _visited[index] = _generation;
+
+            const NfaState& state = _nfa.States[index];
+            switch (state.Kind)
+            {
+               case NfaState::Type::Split:
+                  _toVisit.push_back(state.OtherNext);
+                  _toVisit.push_back(state.Next);
+                  break;
+               case NfaState::Type::Bytes:
+               case NfaState::Type::Match:
+                  threads.push_back({ index, start });
+                  break;
+               default:
+                  if (IsFollowed(state, context))
+                     _toVisit.push_back(state.Next);
+                  break;
+            }
+         }
+      }
+
+      const Nfa& _nfa;
+
+      vector<Thread> _current;
+      vector<Thread> _next;
+      vector<uint32_t> _toVisit;
+      vector<uint32_t> _visited;
+      uint32_t _generation = 0;
+   };
+
+   /////////////////////////////////////////////////////////////////////////
+   //
+   // Regular expression.
+
+   TextRegex::TextRegex() = default;
+   TextRegex::TextRegex(TextRegex&& other) noexcept = default;
+   TextRegex& TextRegex::operator=(TextRegex&& other) noexcept = default;
+   TextRegex::~TextRegex() = default;
+
+   TextRegex::TextRegex(const wstring& textForm)
+   {
+      try
+      {
+         const Node node = Parser(textForm).Parse();
+
+         auto program = make_shared<Program>();
+         NfaBuilder(program->Forward, false).Build(node);
+         NfaBuilder(program->Reversed, true).Build(node);
+
+         const RequiredText required = FindRequiredText(node);
+         program->HasRequired = !required.Best.empty();
+         program->Required = TextSearcher(required.Best);
+
+         _program = move(program);
+      }
+      catch (const wstring& error)
+      {
+         _error = error;
+      }
+   }
+
+   TextRegex::TextRegex(const TextRegex& other)
+   : _program(other._program), _error(other._error)
+   {
+   }
+
+   TextRegex& TextRegex::operator=(const TextRegex& other)
+   {
+      if (this != &other)
+      {
+         _program = other._program;
+         _error = other._error;
+         _searching.reset();
+         _anchored.reset();
+         _reversed.reset();
+         _matcher.reset();
+      }
+      return *this;
+   }
+
+   TextRegex::Automaton& TextRegex::GetAutomaton(unique_ptr<Automaton>& automaton, bool reversed, bool anchored) const
+   {
+      if (!automaton)
+         automaton = make_unique<Automaton>(reversed ? _program->Reversed : _program->Forward, reversed, anchored);
+      return *automaton;
+   }
+
+   const string& TextRegex::GetRequiredText() const
+   {
+      static const string empty;
+      return _program ? _program->Required.GetSearched() : empty;
+   }
+
+   bool TextRegex::IsFoundIn(string_view text) const
+   {
+      if (!_program)
+         return false;
+
+      if (_program->HasRequired && !_program->Required.IsFoundIn(text))
+         return false;
+
+      Automaton& automaton = GetAutomaton(_searching, false, false);
+      uint32_t state = automaton.GetStart(true, false);
+      for (const char c : text)
+      {
+         if (automaton.IsMatch(state, uint8_t(c)))
+            return true;
+         if (automaton.IsDead(state))
+            return false;
+         state = automaton.GetNext(state, uint8_t(c));
+      }
+
+      return automaton.IsMatchAtEnd(state);
+   }
+
+   vector<string_view> TextRegex::FindAll(string_view text) const
+   {
+      vector<string_view> matches;
+      if (!_program)
+         return matches;
+
+      if (_program->HasRequired && !_program->Required.IsFoundIn(text))
+         return matches;
+
+      // Find where matches can start by matching the reversed regular expression
+      // from the end of the text. The start of the text is the end of the reversed text.
+      // Note: matches only start between characters.
+      vector<bool> isStart(text.size() + 1, false);
+      {
+         Automaton& reversed = GetAutomaton(_reversed, true, false);
+         uint32_t state = reversed.GetStart(true, false);
+         for (size_t pos = text.size(); pos > 0; --pos)
+         {
+            const bool isBetweenCharacters = (pos == text.size() || !IsContinuationByte(uint8_t(text[pos])));
+            isStart[pos] = isBetweenCharacters && reversed.IsMatch(state, uint8_t(text[pos - 1]));
+            state = reversed.GetNext(state, uint8_t(text[pos - 1]));
+         }
+         isStart[0] = reversed.IsMatchAtEnd(state);
+      }
+
+      // From each start, find where the preferred match ends, then look for the next start after it.
+      //
+      // Note: the preferred match is only known once the matches of higher priority
+      //       are impossible, which can be far after its end. When too many bytes
+      //       are read again this way, the matcher finds the remaining matches,
+      //       reading each byte once.
+      Automaton& anchored = GetAutomaton(_anchored, false, true);
+      size_t bytesLeft = 4 * text.size() + 64;
+      for (size_t start = 0; start <= text.size(); )
+      {
+         if (!isStart[start])
+         {
+            ++start;
+            continue;
+         }
+
+         size_t end = string_view::npos;
+         uint32_t state = anchored.GetStart(start == 0, start > 0 && IsWordByte(uint8_t(text[start - 1])));
+         size_t pos = start;
+         for (; ; ++pos)
+         {
+            if (pos == text.size())
+            {
+               if (anchored.IsMatchAtEnd(state))
+                  end = pos;
+               break;
+            }
+
+            if (anchored.IsMatch(state, uint8_t(text[pos])))
+               end = pos;
+            if (anchored.IsDead(state))
+               break;
+            state = anchored.GetNext(state, uint8_t(text[pos]));
+         }
+
+         if (pos - start >= bytesLeft)
+         {
+            if (!_matcher)
+               _matcher = make_unique<Matcher>(_program->Forward);
+            _matcher->FindAll(text, isStart, start, matches);
+            break;
+         }
+         bytesLeft -= pos - start;
+
+         if (end == string_view::npos)
+         {
+            ++start;
+            continue;
+         }
+
+         matches.emplace_back(text.substr(start, end - start));
+
+         // Note: after an empty match, the next match must start further.
+         start = (end > start) ? end : start + 1;
+      }
+
+      return matches;
+   }
+}
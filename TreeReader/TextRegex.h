@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TreeReader
+{
+   // A regular expression matched against UTF-8 texts in linear time.
+   //
+   // The regular expression is converted to an automaton over the UTF-8 bytes,
+   // whose states are built as they are needed while matching. Each character
+   // of a text is thus read a bounded number of times, whatever the regular
+   // expression is: there is no backtracking.
+   //
+   // The supported syntax is the one of ECMAScript regular expressions, except
+   // for back-references and look-aheads, which cannot be done without
+   // backtracking. Word boundaries only need the bytes around the position, so
+   // they are supported. Classes and the dot match whole UTF-8 characters, and
+   // the matches and the assertions are only found between characters.
+   // The matches found are the ones ECMAScript finds: the first alternatives
+   // are preferred, repeats are greedy unless they are lazy, and an optional
+   // repeat that reads no character is not taken.
+   //
+   // A text that must be found in every match, like "abc" in "abc.*d", is
+   // searched first, to quickly reject the texts that cannot match.
+   //
+   // Matching modifies the automaton, so a regular expression must not be used
+   // by multiple threads at once. Copies can be used by different threads.
+
+   struct TextRegex
+   {
+      // Create a regular expression that never matches.
+      TextRegex();
+
+      // Create a regular expression from its text form.
+      // If the text form is invalid, the error is kept and it never matches.
+      TextRegex(const std::wstring& textForm);
+
+      TextRegex(const TextRegex& other);
+      TextRegex(TextRegex&& other) noexcept;
+      TextRegex& operator=(const TextRegex& other);
+      TextRegex& operator=(TextRegex&& other) noexcept;
+      ~TextRegex();
+
+      // Verify if the text form was valid, and the error if it was not.
+      bool IsValid() const { return _error.empty(); }
+      const std::wstring& GetError() const { return _error; }
+
+      // Verify if the regular expression matches anywhere in the text.
+      bool IsFoundIn(std::string_view text) const;
+
+      // Find all the matches in the text, from left to right, without overlap.
+      // Note: after an empty match, the next match starts at the next character.
+      std::vector<std::string_view> FindAll(std::string_view text) const;
+
+      // The text that every match contains, or an empty text if there is none.
+      const std::string& GetRequiredText() const;
+
+   private:
+      struct Program;
+      struct Automaton;
+      struct Matcher;
+
+      Automaton& GetAutomaton(std::unique_ptr<Automaton>& automaton, bool reversed, bool anchored) const;
+
+      std::shared_ptr<const Program> _program;
+      std::wstring _error;
+
+      // Note: the automatons are not shared between copies, since they are modified while matching.
+      mutable std::unique_ptr<Automaton> _searching;
+      mutable std::unique_ptr<Automaton> _anchored;
+      mutable std::unique_ptr<Automaton> _reversed;
+      mutable std::unique_ptr<Matcher> _matcher;
+   };
+}
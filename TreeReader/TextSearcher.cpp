@@ -0,0 +1,219 @@
+#include "TextSearcher.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+   #define TREE_READER_SSE2
+   #include <immintrin.h>
+#endif
+
+namespace TreeReader
+{
+   using namespace std;
+
+   namespace
+   {
+      // How common a character is in usual texts, from zero for rare ones.
+      int GetCommonness(char c)
+      {
+         if (c == ' ' || c == '\t')
+            return 2;
+         if (c != 0 && strchr("etaoinsrhl", c))
+            return 1;
+         return 0;
+      }
+   }
+
+   TextSearcher::TextSearcher(const string& searched)
+   : _searched(searched)
+   {
+      if (_searched.empty())
+      {
+         _method = Method::Empty;
+      }
+      else if (_searched.size() == 1)
+      {
+         _method = Method::OneChar;
+      }
+      else
+      {
+         // Note: the second character is the last of the least common ones,
+         //       so that the two characters are spread apart.
+         _method = Method::TwoChars;
+         _firstIndex = 0;
+         for (size_t i = 1; i < _searched.size(); ++i)
+            if (GetCommonness(_searched[i]) < GetCommonness(_searched[_firstIndex]))
+               _firstIndex = i;
+
+         _secondIndex = (_firstIndex == 0) ? 1 : 0;
+         for (size_t i = 0; i < _searched.size(); ++i)
+            if (i != _firstIndex && GetCommonness(_searched[i]) <= GetCommonness(_searched[_secondIndex]))
+               _secondIndex = i;
+      }
+   }
+
+   size_t TextSearcher::Find(string_view text) const
+   {
+      switch (_method)
+      {
+         case Method::Empty:
+            return 0;
+
+         case Method::OneChar:
+         {
+            const void* found = memchr(text.data(), _searched[0], text.size());
+            return found ? static_cast<const char*>(found) - text.data() : string_view::npos;
+         }
+
+         default:
+         case Method::TwoChars:
+            break;
+      }
+
+      const size_t searchedSize = _searched.size();
+      if (text.size() < searchedSize)
+         return string_view::npos;
+
+      #if defined(TREE_READER_SSE2)
+
+      // Note: a block is compared with the two chosen characters at all 16 starting
+      //       positions, so the searched text must fit after the last position.
+      const size_t startCount = text.size() - searchedSize + 1;
+      if (startCount >= 16)
+      {
+         const char* const data = text.data();
+         const __m128i first = _mm_set1_epi8(_searched[_firstIndex]);
+         const __m128i second = _mm_set1_epi8(_searched[_secondIndex]);
+
+         const auto findInBlock = [&](size_t pos, uint32_t mask) -> size_t
+         {
+            const __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + _firstIndex));
+            const __m128i secondBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + _secondIndex));
+            mask &= uint32_t(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBlock, first), _mm_cmpeq_epi8(secondBlock, second))));
+            while (mask)
+            {
+               const size_t start = pos + countr_zero(mask);
+               if (memcmp(data + start, _searched.data(), searchedSize) == 0)
+                  return start;
+               mask &= mask - 1;
+            }
+            return string_view::npos;
+         };
+
+         size_t pos = 0;
+         for (; startCount - pos >= 16; pos += 16)
+            if (const size_t found = findInBlock(pos, 0xFFFF); found != string_view::npos)
+               return found;
+
+         // Note: the last partial block is handled by overlapping the previous one,
+         //       ignoring the positions that were already checked.
+         if (pos < startCount)
+            return findInBlock(startCount - 16, (0xFFFFu << (16 - (startCount - pos))) & 0xFFFF);
+
+         return string_view::npos;
+      }
+
+      #endif
+
+      return text.find(_searched);
+   }
+
+   MultiTextSearcher::MultiTextSearcher(const vector<string>& searched)
+   {
+      // Give a class to each character used by the searched texts.
+      for (const string& text : searched)
+         for (const char c : text)
+            if (_charClasses[uint8_t(c)] == 0)
+               _charClasses[uint8_t(c)] = uint8_t(_classCount++);
+
+      // Note: zero marks a missing transition while building the tree of searched texts,
+      //       since no transition goes back to the initial state in that tree.
+      vector<bool> isMatch;
+      const auto addState = [this, &isMatch]()
+      {
+         _transitions.resize(_transitions.size() + _classCount, 0);
+         isMatch.push_back(false);
+         return uint32_t(isMatch.size() - 1);
+      };
+
+      addState();
+      for (const string& text : searched)
+      {
+         uint32_t state = 0;
+         for (const char c : text)
+         {
+            const size_t transition = state * _classCount + _charClasses[uint8_t(c)];
+            if (_transitions[transition] == 0)
+            {
+               const uint32_t added = addState();
+               _transitions[transition] = added;
+            }
+            state = _transitions[transition];
+         }
+         isMatch[state] = true;
+      }
+
+      // Visit the states by increasing depth, so that the fallback state of each state,
+      // the longest suffix that is also a prefix of a searched text, is complete when
+      // it is needed. Missing transitions become the transitions of the fallback state.
+      vector<uint32_t> fallbacks(isMatch.size(), 0);
+      deque<uint32_t> toVisit;
+      for (size_t charClass = 0; charClass < _classCount; ++charClass)
+         if (const uint32_t next = _transitions[charClass])
+            toVisit.push_back(next);
+
+      while (!toVisit.empty())
+      {
+         const uint32_t state = toVisit.front();
+         toVisit.pop_front();
+
+         const uint32_t fallback = fallbacks[state];
+         if (isMatch[fallback])
+            isMatch[state] = true;
+
+         for (size_t charClass = 0; charClass < _classCount; ++charClass)
+         {
+            uint32_t& next = _transitions[state * _classCount + charClass];
+            const uint32_t fallbackNext = _transitions[fallback * _classCount + charClass];
+            if (next == 0)
+            {
+               next = fallbackNext;
+            }
+            else
+            {
+               fallbacks[next] = fallbackNext;
+               toVisit.push_back(next);
+            }
+         }
+      }
+
+      // Convert the states to the position of their row, to save a multiplication per character.
+      for (uint32_t& next : _transitions)
+         next = uint32_t(next * _classCount) | (isMatch[next] ? MatchBit : 0);
+
+      _stateCount = isMatch.size();
+      _matchesAll = isMatch[0];
+   }
+
+   bool MultiTextSearcher::IsAnyFoundIn(string_view text) const
+   {
+      if (_stateCount == 0)
+         return false;
+
+      if (_matchesAll)
+         return true;
+
+      uint32_t row = 0;
+      for (const char c : text)
+      {
+         row = _transitions[row + _charClasses[uint8_t(c)]];
+         if (row & MatchBit)
+            return true;
+      }
+
+      return false;
+   }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace TreeReader
+{
+   // Searches for a given UTF-8 text in many other texts.
+   //
+   // The way to search is chosen once, when the searcher is created, based
+   // on the searched text. Long enough texts are searched with the SSE2
+   // instructions, 16 positions at a time: only the positions where two
+   // chosen characters match are compared fully. The characters chosen are
+   // the least common ones of the searched text, like letters over spaces.
+   //
+   // The texts searched into do not need to be null-terminated.
+
+   struct TextSearcher
+   {
+      TextSearcher() = default;
+      TextSearcher(const std::string& searched);
+
+      // The text being searched for.
+      const std::string& GetSearched() const { return _searched; }
+
+      // Find the position of the searched text, or npos if it is not found.
+      size_t Find(std::string_view text) const;
+
+      // Verify if the searched text is found in the text.
+      bool IsFoundIn(std::string_view text) const { return Find(text) != std::string_view::npos; }
+
+   private:
+      enum class Method : unsigned char
+      {
+         Empty, OneChar, TwoChars,
+      };
+
+      std::string _searched;
+      Method _method = Method::Empty;
+      size_t _firstIndex = 0;
+      size_t _secondIndex = 0;
+   };
+
+   // Searches for any of many UTF-8 texts in many other texts.
+   //
+   // All the searched texts are combined in a single automaton, so each text
+   // searched into is read once, one character at a time, however many texts
+   // are searched for. (The automaton is the one of Aho and Corasick, with all
+   // transitions precomputed.)
+   //
+   // To keep the automaton small, the characters that do not appear in any
+   // searched text all share the same transitions.
+
+   struct MultiTextSearcher
+   {
+      MultiTextSearcher() = default;
+      MultiTextSearcher(const std::vector<std::string>& searched);
+
+      // Verify if any of the searched texts is found in the text.
+      bool IsAnyFoundIn(std::string_view text) const;
+
+      // The number of states of the automaton.
+      size_t CountStates() const { return _stateCount; }
+
+   private:
+      // Note: the transitions give the position of the row of the next state
+      //       in the transitions, with the match bit set if that state matches.
+      static constexpr std::uint32_t MatchBit = 0x80000000u;
+
+      std::uint8_t _charClasses[256] = {};
+      size_t _classCount = 1;
+      size_t _stateCount = 0;
+      bool _matchesAll = false;
+      std::vector<std::uint32_t> _transitions;
+   };
+}
@@ -1,59 +1,300 @@
 #include "TextTree.h"
+#include "TreeReaderHelpers.h"
 
 namespace TreeReader
 {
    using namespace std;
 
+   const shared_ptr<TextTree::Nodes>& TextTree::GetEmptyNodes()
+   {
+      static const shared_ptr<Nodes> emptyNodes = make_shared<Nodes>();
+      return emptyNodes;
+   }
+
+   TextTree::Nodes& TextTree::ModifyNodes()
+   {
+      // Note: the empty nodes are always shared, so they are never modified.
+      if (_nodes.use_count() > 1)
+         _nodes = make_shared<Nodes>(*_nodes);
+      return *_nodes;
+   }
+
    void TextTree::Reset()
    {
-      Roots.clear();
-      _nodes.clear();
+      _nodes = GetEmptyNodes();
+   }
+
+   NodeIndex TextTree::AddChild(NodeIndex underNode, string_view text)
+   {
+      Nodes& nodes = ModifyNodes();
+      const NodeIndex newNode = NodeIndex(nodes.Texts.size());
+
+      nodes.Texts.emplace_back(text.data());
+      nodes.TextLengths.emplace_back(uint32_t(text.size()));
+      nodes.Parents.emplace_back(underNode);
+      nodes.FirstChildren.emplace_back(InvalidNode);
+      nodes.LastChildren.emplace_back(InvalidNode);
+      nodes.NextSiblings.emplace_back(InvalidNode);
+      nodes.IndexInParents.emplace_back(0);
+
+      nodes.LinkLastChild(underNode, newNode);
+
+      return newNode;
    }
 
-   TextTree::Node* TextTree::AddChild(Node* underNode, const wchar_t* text)
+   void TextTree::Nodes::LinkLastChild(NodeIndex parent, NodeIndex child)
    {
-      _nodes.emplace_back(text, underNode);
-      Node* newNode = &_nodes.back();
-      if (!underNode)
+      NodeIndex& first = (parent == InvalidNode) ? FirstRoot : FirstChildren[parent];
+      NodeIndex& last = (parent == InvalidNode) ? LastRoot : LastChildren[parent];
+
+      if (last == InvalidNode)
       {
-         newNode->IndexInParent = Roots.size();
-         Roots.emplace_back(newNode);
+         first = child;
+         IndexInParents[child] = 0;
       }
       else
       {
-         newNode->IndexInParent = underNode->Children.size();
-         underNode->Children.emplace_back(newNode);
+         NextSiblings[last] = child;
+         IndexInParents[child] = IndexInParents[last] + 1;
       }
-      return newNode;
+
+      last = child;
+   }
+
+   void TextTree::AddNodes(const vector<string_view>& texts, const vector<NodeIndex>& parents, size_t threadCount)
+   {
+      Nodes& nodes = ModifyNodes();
+
+      // The nodes are processed in chunks, each in its own thread.
+      //
+      // Each chunk links the children of its own nodes. The children of nodes
+      // from previous chunks are linked among themselves separately. Since those
+      // are ancestors of the first node of the chunk, there are few of them.
+      // They are then linked to their previous siblings in order and their
+      // index in their parent is adjusted.
+
+      const size_t nodeCount = texts.size();
+      const NodeIndex firstNode = NodeIndex(nodes.Texts.size());
+      const size_t totalCount = firstNode + nodeCount;
+
+      nodes.Texts.resize(totalCount);
+      nodes.TextLengths.resize(totalCount);
+      nodes.Parents.resize(totalCount, InvalidNode);
+      nodes.FirstChildren.resize(totalCount, InvalidNode);
+      nodes.LastChildren.resize(totalCount, InvalidNode);
+      nodes.NextSiblings.resize(totalCount, InvalidNode);
+      nodes.IndexInParents.resize(totalCount, 0);
+
+      const size_t minChunkSize = 64 * 1024;
+      const size_t chunkCount = CountParallelChunks(nodeCount, minChunkSize, threadCount);
+
+      // The children of a previous node or of the roots found in a chunk.
+      struct OtherChildren
+      {
+         NodeIndex Parent = InvalidNode;
+         NodeIndex First = InvalidNode;
+         NodeIndex Last = InvalidNode;
+         size_t Count = 0;
+         size_t FirstIndex = 0;
+      };
+
+      vector<vector<OtherChildren>> otherChildren(chunkCount);
+
+      const auto chunkBegin = [&](size_t chunk) { return NodeIndex(nodeCount * chunk / chunkCount); };
+
+      RunInParallel(chunkCount, [&](size_t chunk)
+      {
+         const NodeIndex begin = chunkBegin(chunk);
+         const NodeIndex end = chunkBegin(chunk + 1);
+         auto& others = otherChildren[chunk];
+         for (NodeIndex i = begin; i < end; ++i)
+         {
+            const NodeIndex parent = parents[i];
+            const NodeIndex node = firstNode + i;
+            const NodeIndex parentNode = (parent == InvalidNode) ? InvalidNode : firstNode + parent;
+
+            nodes.Texts[node] = texts[i].data();
+            nodes.TextLengths[node] = uint32_t(texts[i].size());
+            nodes.Parents[node] = parentNode;
+
+            if (parent != InvalidNode && parent >= begin)
+            {
+               nodes.LinkLastChild(parentNode, node);
+            }
+            else
+            {
+               // Note: since children come in order, the children of the same
+               //       previous node or the roots follow each other.
+               if (others.empty() || others.back().Parent != parentNode)
+                  others.emplace_back(OtherChildren{ parentNode, node, node });
+               else
+                  nodes.NextSiblings[others.back().Last] = node;
+
+               others.back().Last = node;
+               others.back().Count += 1;
+            }
+         }
+      });
+
+      // Link the children of previous nodes to their previous siblings, in order.
+      for (auto& others : otherChildren)
+      {
+         for (auto& other : others)
+         {
+            NodeIndex& first = (other.Parent == InvalidNode) ? nodes.FirstRoot : nodes.FirstChildren[other.Parent];
+            NodeIndex& last = (other.Parent == InvalidNode) ? nodes.LastRoot : nodes.LastChildren[other.Parent];
+
+            if (last == InvalidNode)
+            {
+               first = other.First;
+               other.FirstIndex = 0;
+            }
+            else
+            {
+               nodes.NextSiblings[last] = other.First;
+               other.FirstIndex = nodes.IndexInParents[last] + 1;
+            }
+
+            // Note: the index of the last child is needed right away by the following chunks.
+            last = other.Last;
+            nodes.IndexInParents[last] = NodeIndex(other.FirstIndex + other.Count - 1);
+         }
+      }
+
+      RunInParallel(chunkCount, [&](size_t chunk)
+      {
+         for (const auto& other : otherChildren[chunk])
+         {
+            NodeIndex node = other.First;
+            for (size_t i = 0; i < other.Count; ++i)
+            {
+               nodes.IndexInParents[node] = NodeIndex(other.FirstIndex + i);
+               node = nodes.NextSiblings[node];
+            }
+         }
+      });
    }
 
-   size_t TextTree::CountSiblings(const Node* node) const
+   void TextTree::Freeze()
    {
-      if (!node)
+      if (IsFrozen())
+         return;
+
+      Nodes& nodes = ModifyNodes();
+      const size_t nodeCount = nodes.Texts.size();
+
+      // Follow the links to find the order of the nodes.
+      // Only record that order if the nodes are not already in order.
+      vector<NodeIndex> newIndexes;
+      NodeIndex inOrderCount = 0;
+      NodeIndex pos = nodes.FirstRoot;
+      while (pos != InvalidNode)
+      {
+         if (newIndexes.empty() && pos != inOrderCount)
+         {
+            newIndexes.resize(nodeCount, InvalidNode);
+            for (NodeIndex i = 0; i < inOrderCount; ++i)
+               newIndexes[i] = i;
+         }
+
+         if (!newIndexes.empty())
+            newIndexes[pos] = inOrderCount;
+         inOrderCount += 1;
+
+         if (nodes.FirstChildren[pos] != InvalidNode)
+         {
+            pos = nodes.FirstChildren[pos];
+            continue;
+         }
+
+         while (pos != InvalidNode && nodes.NextSiblings[pos] == InvalidNode)
+            pos = nodes.Parents[pos];
+         if (pos != InvalidNode)
+            pos = nodes.NextSiblings[pos];
+      }
+
+      if (!newIndexes.empty())
+      {
+         const auto reorder = [&newIndexes, nodeCount](auto& values)
+         {
+            auto reordered = values;
+            for (NodeIndex i = 0; i < nodeCount; ++i)
+               reordered[newIndexes[i]] = values[i];
+            values.swap(reordered);
+         };
+
+         const auto renumber = [&newIndexes](NodeIndex node) { return node == InvalidNode ? InvalidNode : newIndexes[node]; };
+         const auto reorderLinks = [&reorder, &renumber](vector<NodeIndex>& links)
+         {
+            reorder(links);
+            for (auto& link : links)
+               link = renumber(link);
+         };
+
+         reorder(nodes.Texts);
+         reorder(nodes.TextLengths);
+         reorder(nodes.IndexInParents);
+         reorderLinks(nodes.Parents);
+         reorderLinks(nodes.FirstChildren);
+         reorderLinks(nodes.LastChildren);
+         reorderLinks(nodes.NextSiblings);
+
+         nodes.FirstRoot = renumber(nodes.FirstRoot);
+         nodes.LastRoot = renumber(nodes.LastRoot);
+      }
+
+      // The sub-tree of a node ends at its next sibling, or where the sub-tree of its parent ends.
+      // Note: parents come before their children, so the end of their sub-tree is already known.
+      nodes.SubTreeEnds.resize(nodeCount);
+      for (NodeIndex i = 0; i < nodeCount; ++i)
+      {
+         if (nodes.NextSiblings[i] != InvalidNode)
+            nodes.SubTreeEnds[i] = nodes.NextSiblings[i];
+         else if (nodes.Parents[i] != InvalidNode)
+            nodes.SubTreeEnds[i] = nodes.SubTreeEnds[nodes.Parents[i]];
+         else
+            nodes.SubTreeEnds[i] = NodeIndex(nodeCount);
+      }
+   }
+
+   NodeIndex TextTree::GetChild(NodeIndex node, size_t index) const
+   {
+      NodeIndex child = GetFirstChild(node);
+      for (; index > 0 && child != InvalidNode; --index)
+         child = GetNextSibling(child);
+      return child;
+   }
+
+   size_t TextTree::CountSiblings(NodeIndex node) const
+   {
+      if (node == InvalidNode)
          return 0;
 
-      return CountChildren(node->Parent);
+      return CountChildren(GetParent(node));
    }
 
-   size_t TextTree::CountChildren(const Node* node) const
+   size_t TextTree::CountChildren(NodeIndex node) const
    {
-      if (!node)
-         return Roots.size();
+      const Nodes& nodes = *_nodes;
+      const NodeIndex last = (node == InvalidNode) ? nodes.LastRoot : nodes.LastChildren[node];
+      if (last == InvalidNode)
+         return 0;
 
-      return node->Children.size();
+      return nodes.IndexInParents[last] + size_t(1);
    }
 
-   size_t TextTree::CountAncestors(const Node* node) const
+   size_t TextTree::CountAncestors(NodeIndex node) const
    {
-      if (!node)
+      const Nodes& nodes = *_nodes;
+      if (node == InvalidNode)
          return 0;
 
       size_t count = 0;
 
-      while (node->Parent)
+      while (nodes.Parents[node] != InvalidNode)
       {
          count += 1;
-         node = node->Parent;
+         node = nodes.Parents[node];
       }
 
       return count;
@@ -1,10 +1,11 @@
 #pragma once
 
 #include <string>
-#include <deque>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <cstdint>
 
 namespace TreeReader
 {
@@ -15,64 +16,148 @@ namespace TreeReader
       virtual ~TextHolder() = default;
    };
 
+   // The index of a node in a tree, used as a handle to access the node.
+   //
+   // 32-bit indices limit a tree to four billion nodes, but halve the memory
+   // used by the links between the nodes.
+
+   typedef std::uint32_t NodeIndex;
+
+   // The index used when there is no node, for example the parent of a root.
+   // When passed as the parent node, it designates the roots.
+
+   constexpr NodeIndex InvalidNode = NodeIndex(-1);
+
    // The tree of text.
    //
    // Contains nodes, forming a tree structure.
-   // Each node contains its text, children and index in its parent.
+   // Each node contains its text and its length, its parent, its first and last child,
+   // its next sibling and its index in its parent.
+   //
+   // The nodes are kept in parallel arrays, one for each of their data,
+   // and are accessed through their index. A parent always has a smaller
+   // index than its children.
+   //
+   // Once all nodes are added, the tree can be frozen: the nodes are then put
+   // in order, that is each node is followed by its descendants, and the end of
+   // the sub-tree of each node is recorded. Visiting the tree in order is then
+   // a simple scan of the nodes, and skipping the children of a node is a jump.
+   //
+   // Copying a tree is cheap: the copies share the same nodes. The nodes are
+   // only copied when a tree that shares them is modified, so each copy is
+   // an immutable snapshot of the tree, safe to share between threads.
+   //
+   // The text is kept in UTF-8. It is only converted to wide text when printed
+   // to a wide stream or displayed. The text of a node is not null-terminated:
+   // it is accessed as a string view using the length kept in the node.
    //
    // Use a TextHolder to make the text used by the tree nodes valid.
 
    struct TextTree
    {
-      // Each node contains its text and the index of the next sibling and the first child.
+      // Source text lines are kept constant so that the text pointers are kept valid.
+      std::shared_ptr<TextHolder> SourceTextLines;
 
-      struct Node
-      {
-         // Points into the source text lines.
-         const wchar_t* TextPtr = nullptr;
+      // Clear the tree.
+      void Reset();
 
-         Node* Parent = nullptr;
+      // Adding new nodes. To add the a root, pass InvalidNode.
+      NodeIndex AddChild(NodeIndex underNode, std::string_view text);
 
-         size_t IndexInParent = 0;
+      // Add many nodes at once, given the text of each and the index of its parent
+      // among the added nodes. Parents must come before their children.
+      // Roots have InvalidNode as their parent.
+      //
+      // The nodes are linked to their parent in parallel, using the given number
+      // of threads, or one per core if zero.
+      void AddNodes(const std::vector<std::string_view>& texts, const std::vector<NodeIndex>& parents, size_t threadCount = 0);
 
-         std::vector<Node *> Children;
+      // Put the nodes in order and record the end of the sub-tree of each node.
+      // The nodes are only moved if they were not already in order.
+      // Note: adding nodes afterward un-freezes the tree.
+      void Freeze();
 
-         Node() = default;
-         Node(const wchar_t* text, Node* parent) : TextPtr(text), Parent(parent) {}
-      };
+      // Verify if the tree is frozen.
+      bool IsFrozen() const { return _nodes->SubTreeEnds.size() == _nodes->Texts.size(); }
 
-      // Source text lines are kept constant so that the text pointers are kept valid.
-      std::shared_ptr<TextHolder> SourceTextLines;
+      // Get the index after the last descendant of the node.
+      // Note: only valid when the tree is frozen.
+      NodeIndex GetSubTreeEnd(NodeIndex node) const { return _nodes->SubTreeEnds[node]; }
 
-      // The roots of the tree of nodes.
-      std::vector<Node *> Roots;
+      // Verify if the tree has no node.
+      bool IsEmpty() const { return _nodes->FirstRoot == InvalidNode; }
 
-      // Clear the tree.
-      void Reset();
+      // Count the number of nodes in the tree.
+      size_t CountNodes() const { return _nodes->Texts.size(); }
+
+      // Verify if two trees share the same nodes, for example a tree and its copy.
+      bool SharesNodesWith(const TextTree& other) const { return _nodes == other._nodes; }
+
+      // Access the data of a node.
+      // The parent, child or sibling is InvalidNode when there is none.
+      std::string_view GetText(NodeIndex node) const { return std::string_view(_nodes->Texts[node], _nodes->TextLengths[node]); }
+      NodeIndex GetParent(NodeIndex node) const { return _nodes->Parents[node]; }
+      NodeIndex GetNextSibling(NodeIndex node) const { return _nodes->NextSiblings[node]; }
+      size_t GetIndexInParent(NodeIndex node) const { return _nodes->IndexInParents[node]; }
 
-      // Adding new nodes. To add the a root, pass nullptr.
-      Node* AddChild(Node* underNode, const wchar_t* text);
+      // Get the first child of a node.
+      // Pass InvalidNode to get the first root.
+      NodeIndex GetFirstChild(NodeIndex node) const { return node == InvalidNode ? _nodes->FirstRoot : _nodes->FirstChildren[node]; }
+
+      // Get the child at the given index, or InvalidNode if there are not that many children.
+      // Pass InvalidNode to get a root.
+      // Note: it walks the siblings, so it takes a time proportional to the index.
+      NodeIndex GetChild(NodeIndex node, size_t index) const;
 
       // Count the number of chilren of a node.
-      // Pass null to count the number of roots.
-      size_t CountChildren(const Node* node) const;
+      // Pass InvalidNode to count the number of roots.
+      size_t CountChildren(NodeIndex node) const;
 
       // Count the number of siblings, including the node itself.
-      // Returns zero if the node is null.
-      size_t CountSiblings(const Node* node) const;
+      // Returns zero if the node is InvalidNode.
+      size_t CountSiblings(NodeIndex node) const;
 
       // Count the number of ancestor to reach the root of the tree.
       // That is, root nodes have an ancestor count of zero.
-      size_t CountAncestors(const Node* node) const;
+      size_t CountAncestors(NodeIndex node) const;
 
    private:
-      // The nodes.
-      std::deque<Node> _nodes;
+      // The nodes, shared by the copies of the tree.
+      // Note: like the number of nodes, the length of the text is kept in 32 bits.
+      struct Nodes
+      {
+         std::vector<const char*> Texts;
+         std::vector<std::uint32_t> TextLengths;
+         std::vector<NodeIndex> Parents;
+         std::vector<NodeIndex> FirstChildren;
+         std::vector<NodeIndex> LastChildren;
+         std::vector<NodeIndex> NextSiblings;
+         std::vector<NodeIndex> IndexInParents;
+         std::vector<NodeIndex> SubTreeEnds;
+
+         NodeIndex FirstRoot = InvalidNode;
+         NodeIndex LastRoot = InvalidNode;
+
+         // Link a new node as the last child of its parent.
+         void LinkLastChild(NodeIndex parent, NodeIndex child);
+      };
+
+      // Get the nodes to modify them, copying them first if they are shared.
+      Nodes& ModifyNodes();
 
+      // All empty trees share the same nodes.
+      static const std::shared_ptr<Nodes>& GetEmptyNodes();
+
+      std::shared_ptr<Nodes> _nodes = GetEmptyNodes();
    };
 
    // Convert the text tree to a textual form with indentation.
+   //
+   // Printing to a narrow stream writes the UTF-8 text as-is.
 
    std::wostream& PrintTree(std::wostream& stream, const TextTree& tree, const std::wstring& indentation = L"  ");
    std::wostream& operator<<(std::wostream& stream, const TextTree& tree);
+
+   std::ostream& PrintTree(std::ostream& stream, const TextTree& tree, const std::string& indentation = "  ");
+   std::ostream& operator<<(std::ostream& stream, const TextTree& tree);
 }
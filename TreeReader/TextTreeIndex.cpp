@@ -0,0 +1,235 @@
+#include "TextTreeIndex.h"
+#include "TreeReaderHelpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <utility>
+
+namespace TreeReader
+{
+   using namespace std;
+
+   namespace
+   {
+      constexpr size_t PossibleTrigramCount = size_t(1) << 24;
+      constexpr size_t WordBits = 64;
+
+      // The most memory used by the chunks building an index together, for the data they keep per trigram.
+      constexpr size_t MaxChunksMemory = size_t(64) * 1024 * 1024;
+      constexpr size_t ChunkMemoryPerTrigram = sizeof(NodeIndex) + sizeof(uint32_t);
+
+      uint32_t MakeTrigram(const char* text)
+      {
+         return (uint32_t(uint8_t(text[0])) << 16) | (uint32_t(uint8_t(text[1])) << 8) | uint32_t(uint8_t(text[2]));
+      }
+
+      // Find the distinct trigrams of the text, sorted.
+      void FindTrigrams(string_view text, vector<uint32_t>& trigrams)
+      {
+         trigrams.clear();
+         for (size_t i = 0; i + TextTreeIndex::GramLength <= text.size(); ++i)
+            trigrams.emplace_back(MakeTrigram(text.data() + i));
+
+         sort(trigrams.begin(), trigrams.end());
+         trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+      }
+   }
+
+   TextTreeIndex::TextTreeIndex(const TextTree& tree, size_t threadCount, OperationProgress* progress)
+   : _tree(tree)
+   {
+      const size_t nodeCount = tree.CountNodes();
+      const size_t maxChunkCount = CountParallelChunks(nodeCount, 16 * 1024, threadCount);
+
+      if (progress)
+         progress->AddTotal(3 * nodeCount);
+
+      // Call the function with the text of each node of a chunk, in node order.
+      // Stops early when cancelled.
+      const auto forEachNode = [&tree, nodeCount, progress](size_t chunk, size_t chunkCount, auto&& func)
+      {
+         ProgressBatch batch(progress);
+         const size_t chunkSize = (nodeCount + chunkCount - 1) / chunkCount;
+         const size_t begin = min(nodeCount, chunk * chunkSize);
+         const size_t end = min(nodeCount, begin + chunkSize);
+         for (size_t node = begin; node < end && !batch.IsCancelled(); ++node)
+         {
+            func(NodeIndex(node), tree.GetText(NodeIndex(node)));
+            batch.Advance();
+         }
+      };
+
+      const auto isCancelled = [this, progress]()
+      {
+         if (!progress || !progress->IsCancelled())
+            return false;
+
+         *this = TextTreeIndex();
+         return true;
+      };
+
+      // Find which trigrams are in the tree, one bit per possible trigram.
+      // Note: the chunks share the bits, so their memory does not depend on the number of threads.
+      vector<atomic<uint64_t>> found(PossibleTrigramCount / WordBits);
+      RunInParallel(maxChunkCount, [&](size_t chunk)
+      {
+         forEachNode(chunk, maxChunkCount, [&found](NodeIndex, string_view text)
+         {
+            for (size_t i = 0; i + GramLength <= text.size(); ++i)
+            {
+               const uint32_t trigram = MakeTrigram(text.data() + i);
+               const uint64_t bit = uint64_t(1) << (trigram % WordBits);
+               atomic<uint64_t>& word = found[trigram / WordBits];
+               if (!(word.load(memory_order_relaxed) & bit))
+                  word.fetch_or(bit, memory_order_relaxed);
+            }
+         });
+      });
+
+      if (isCancelled())
+         return;
+
+      // Number the trigrams in order: the number of a trigram is the count of
+      // trigrams in the words before its own plus the trigrams before it in its word.
+      vector<uint64_t> bits(found.size());
+      vector<uint32_t> countsBefore(found.size());
+      for (size_t word = 0; word < found.size(); ++word)
+      {
+         bits[word] = found[word].load(memory_order_relaxed);
+         countsBefore[word] = uint32_t(_trigrams.size());
+         for (uint64_t remaining = bits[word]; remaining; remaining &= remaining - 1)
+            _trigrams.emplace_back(uint32_t(word * WordBits + countr_zero(remaining)));
+      }
+      found = vector<atomic<uint64_t>>();
+
+      const auto numberOf = [&bits, &countsBefore](uint32_t trigram)
+      {
+         const uint64_t before = bits[trigram / WordBits] & ((uint64_t(1) << (trigram % WordBits)) - 1);
+         return countsBefore[trigram / WordBits] + uint32_t(popcount(before));
+      };
+
+      // Each chunk counts the nodes containing each trigram, then writes them.
+      // Since each chunk keeps data per trigram, there are fewer chunks when
+      // there are many trigrams, to bound the memory used.
+      const size_t trigramCount = _trigrams.size();
+      const size_t chunkCount = clamp(MaxChunksMemory / (ChunkMemoryPerTrigram * max(size_t(1), trigramCount)), size_t(1), maxChunkCount);
+
+      // Call the function with the number of each distinct trigram of each node of a chunk.
+      // Note: nodes are visited in order, so a trigram found again in the same
+      //       node is detected by remembering the last node that contained it.
+      const auto forEachNodeTrigram = [&](size_t chunk, auto&& func)
+      {
+         vector<NodeIndex> lastNodes(trigramCount, InvalidNode);
+         forEachNode(chunk, chunkCount, [&](NodeIndex node, string_view text)
+         {
+            for (size_t i = 0; i + GramLength <= text.size(); ++i)
+            {
+               const uint32_t number = numberOf(MakeTrigram(text.data() + i));
+               if (lastNodes[number] != node)
+               {
+                  lastNodes[number] = node;
+                  func(node, number);
+               }
+            }
+         });
+      };
+
+      // Note: the counts fit in 32 bits since they are counts of nodes.
+      vector<vector<uint32_t>> positions(chunkCount);
+      RunInParallel(chunkCount, [&](size_t chunk)
+      {
+         vector<uint32_t>& counts = positions[chunk];
+         counts.resize(trigramCount, 0);
+         forEachNodeTrigram(chunk, [&counts](NodeIndex, uint32_t number) { counts[number] += 1; });
+      });
+
+      if (isCancelled())
+         return;
+
+      // Find where the list of each trigram starts and where each chunk writes into it,
+      // relative to the start of the list. The chunks are in node order, so writing them
+      // in turn keeps each list sorted.
+      _offsets.resize(trigramCount + 1);
+      size_t total = 0;
+      for (size_t number = 0; number < trigramCount; ++number)
+      {
+         _offsets[number] = total;
+         uint32_t count = 0;
+         for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+            count += exchange(positions[chunk][number], count);
+         total += count;
+      }
+      _offsets[trigramCount] = total;
+
+      _nodes.resize(total);
+      RunInParallel(chunkCount, [&](size_t chunk)
+      {
+         vector<uint32_t>& writePositions = positions[chunk];
+         forEachNodeTrigram(chunk, [this, &writePositions](NodeIndex node, uint32_t number)
+         {
+            _nodes[_offsets[number] + writePositions[number]++] = node;
+         });
+      });
+
+      isCancelled();
+   }
+
+   bool TextTreeIndex::FindNodes(uint32_t trigram, const NodeIndex*& begin, const NodeIndex*& end) const
+   {
+      const auto pos = lower_bound(_trigrams.begin(), _trigrams.end(), trigram);
+      if (pos == _trigrams.end() || *pos != trigram)
+         return false;
+
+      const size_t index = pos - _trigrams.begin();
+      begin = _nodes.data() + _offsets[index];
+      end = _nodes.data() + _offsets[index + 1];
+      return true;
+   }
+
+   bool TextTreeIndex::FindCandidates(string_view text, vector<NodeIndex>& candidates) const
+   {
+      if (text.size() < GramLength)
+         return false;
+
+      vector<uint32_t> trigrams;
+      FindTrigrams(text, trigrams);
+
+      // Note: if any trigram is in no node, then no node contains the text.
+      vector<pair<const NodeIndex*, const NodeIndex*>> lists;
+      for (const uint32_t trigram : trigrams)
+      {
+         const NodeIndex* begin = nullptr;
+         const NodeIndex* end = nullptr;
+         if (!FindNodes(trigram, begin, end))
+            return true;
+         lists.emplace_back(begin, end);
+      }
+
+      // Intersect the lists, starting with the shortest one, so the fewest nodes are looked for.
+      sort(lists.begin(), lists.end(), [](const auto& lhs, const auto& rhs) { return lhs.second - lhs.first < rhs.second - rhs.first; });
+
+      vector<NodeIndex> found(lists[0].first, lists[0].second);
+      for (size_t i = 1; i < lists.size() && !found.empty(); ++i)
+      {
+         const NodeIndex* pos = lists[i].first;
+         const NodeIndex* const end = lists[i].second;
+         found.erase(remove_if(found.begin(), found.end(), [&pos, end](NodeIndex node)
+         {
+            pos = lower_bound(pos, end, node);
+            return pos == end || *pos != node;
+         }), found.end());
+      }
+
+      candidates.insert(candidates.end(), found.begin(), found.end());
+      return true;
+   }
+
+   size_t TextTreeIndex::GetMemoryUsage() const
+   {
+      return sizeof(*this)
+           + _trigrams.capacity() * sizeof(uint32_t)
+           + _offsets.capacity() * sizeof(size_t)
+           + _nodes.capacity() * sizeof(NodeIndex);
+   }
+}
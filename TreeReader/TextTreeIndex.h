@@ -0,0 +1,63 @@
+#pragma once
+
+#include "TextTree.h"
+#include "OperationProgress.h"
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace TreeReader
+{
+   // An index of the text of the nodes of a tree, to quickly find which nodes
+   // may contain a given text.
+   //
+   // For each sequence of three bytes found in the tree, a trigram, the index
+   // keeps the sorted list of the nodes that contain it. A node can only contain
+   // a text if it contains all the trigrams of that text, so the lists of the
+   // trigrams of the text give the candidate nodes. The candidates must still be
+   // verified, since the trigrams may be found at unrelated places in the node.
+   //
+   // The index is built in parallel, using the given number of threads, or one
+   // per core if zero. It keeps a copy of the indexed tree, which shares its nodes.
+   // Besides the index itself, building it uses at most about 70 MB, whatever the
+   // number of threads: fewer threads are used when the tree has many trigrams.
+   //
+   // The optional progress counts the nodes read, each node being read three times.
+   // Cancelling it leaves the index empty, so it is not the index of the tree.
+   //
+   // Once built, the index is never modified, so it can be used by many threads.
+
+   struct TextTreeIndex
+   {
+      // The length of the indexed texts: texts shorter than this cannot be searched.
+      static constexpr size_t GramLength = 3;
+
+      TextTreeIndex() = default;
+      TextTreeIndex(const TextTree& tree, size_t threadCount = 0, OperationProgress* progress = nullptr);
+
+      // Verify if the index was built for the given tree, or for a copy that shares its nodes.
+      bool IsIndexOf(const TextTree& tree) const { return _tree.SharesNodesWith(tree); }
+
+      // Find the nodes that may contain the text, in order, added to the given candidates.
+      // Returns false if the text is too short to be searched with the index.
+      bool FindCandidates(std::string_view text, std::vector<NodeIndex>& candidates) const;
+
+      // Count the number of different trigrams found in the tree.
+      size_t CountTrigrams() const { return _trigrams.size(); }
+
+      // The number of bytes of memory used by the index.
+      size_t GetMemoryUsage() const;
+
+   private:
+      // Find the sorted list of nodes containing the trigram, if any.
+      bool FindNodes(std::uint32_t trigram, const NodeIndex*& begin, const NodeIndex*& end) const;
+
+      TextTree _tree;
+
+      // The sorted trigrams, where their list of nodes start, and all the lists.
+      std::vector<std::uint32_t> _trigrams;
+      std::vector<size_t> _offsets;
+      std::vector<NodeIndex> _nodes;
+   };
+}
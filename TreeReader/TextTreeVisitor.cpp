@@ -4,9 +4,6 @@ namespace TreeReader
 {
    using namespace std;
    using Result = TreeVisitor::Result;
-   using Node = TextTree::Node;
-   using Iter = vector<Node *>::const_iterator;
-   using IterPair = pair<Iter, Iter>;
    constexpr Result ContinueVisit{ false, false };
    constexpr Result StopVisit{ true, false };
 
@@ -20,7 +17,7 @@ namespace TreeReader
       return ContinueVisit;
    }
 
-   Result DelegateTreeVisitor::Visit(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result DelegateTreeVisitor::Visit(const TextTree& tree, NodeIndex node, size_t level)
    {
       if (!Visitor)
          return StopVisit;
@@ -28,12 +25,12 @@ namespace TreeReader
       return Visitor->Visit(tree, node, level);
    }
 
-   Result FunctionTreeVisitor::Visit(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result FunctionTreeVisitor::Visit(const TextTree& tree, NodeIndex node, size_t level)
    {
       return Func(tree, node, level);
    }
 
-   Result CanAbortTreeVisitor::Visit(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result CanAbortTreeVisitor::Visit(const TextTree& tree, NodeIndex node, size_t level)
    {
       if (Abort)
          return StopVisit;
@@ -41,75 +38,122 @@ namespace TreeReader
       return DelegateTreeVisitor::Visit(tree, node, level);
    }
 
-   void VisitInOrder(const TextTree& tree, const Node* node, bool siblings, TreeVisitor& visitor)
+   Result ProgressTreeVisitor::Visit(const TextTree& tree, NodeIndex node, size_t level)
    {
-      IterPair pos;
-      if (node)
+      if (Progress.IsCancelled())
+         return StopVisit;
+
+      const Result result = DelegateTreeVisitor::Visit(tree, node, level);
+      Progress.Advance();
+      return result;
+   }
+
+   namespace
+   {
+      // Visit the nodes of a frozen tree, which are in order, from the beginning to the end.
+      // Skipping children jumps to the end of the sub-tree.
+
+      void VisitFrozenInOrder(const TextTree& tree, NodeIndex begin, NodeIndex end, TreeVisitor& visitor)
       {
-         if (siblings)
+         // The ends of the sub-trees that are being visited, one per level.
+         vector<NodeIndex> subTreeEnds;
+
+         size_t level = 0;
+         NodeIndex pos = begin;
+         while (pos < end)
          {
-            if (node->Parent)
+            const Result result = visitor.Visit(tree, pos, level);
+            if (result.Stop)
+               return;
+
+            const NodeIndex subTreeEnd = tree.GetSubTreeEnd(pos);
+            if (!result.SkipChildren && subTreeEnd > pos + 1)
             {
-               pos = make_pair(node->Parent->Children.begin(), node->Parent->Children.end());
+               subTreeEnds.push_back(subTreeEnd);
+               pos++;
+               level++;
+               if (visitor.GoDeeper(level).Stop)
+                  return;
+               continue;
             }
-            else
+
+            pos = subTreeEnd;
+            while (!subTreeEnds.empty() && pos >= subTreeEnds.back())
             {
-               pos = make_pair(tree.Roots.begin(), tree.Roots.end());
+               subTreeEnds.pop_back();
+               level--;
+               if (visitor.GoHigher(level).Stop)
+                  return;
             }
-            pos.first += node->IndexInParent;
          }
+      }
+   }
+
+   void VisitInOrder(const TextTree& tree, NodeIndex node, bool siblings, TreeVisitor& visitor)
+   {
+      if (tree.IsFrozen())
+      {
+         if (node == InvalidNode)
+            VisitFrozenInOrder(tree, 0, NodeIndex(tree.CountNodes()), visitor);
+         else if (!siblings)
+            VisitFrozenInOrder(tree, node + 1, tree.GetSubTreeEnd(node), visitor);
          else
          {
-            pos = make_pair(node->Children.begin(), node->Children.end());
+            const NodeIndex parent = tree.GetParent(node);
+            const NodeIndex end = (parent == InvalidNode) ? NodeIndex(tree.CountNodes()) : tree.GetSubTreeEnd(parent);
+            VisitFrozenInOrder(tree, node, end, visitor);
          }
-      }
-      else
-      {
-         pos = make_pair(tree.Roots.begin(), tree.Roots.end());
+         return;
       }
 
-      vector<IterPair> goBack;
+      NodeIndex pos = (node != InvalidNode && siblings) ? node : tree.GetFirstChild(node);
 
+      // Note: the parent links are used to go back up, so no stack is needed.
       size_t level = 0;
-      while (true)
+      while (pos != InvalidNode)
       {
-         if (pos.first != pos.second)
+         const Result result = visitor.Visit(tree, pos, level);
+         if (result.Stop)
+            break;
+
+         const NodeIndex child = result.SkipChildren ? InvalidNode : tree.GetFirstChild(pos);
+         if (child != InvalidNode)
          {
-            const Node& node = **pos.first;
-            const Result result = visitor.Visit(tree, node, level);
-            if (result.Stop)
+            pos = child;
+            level++;
+            if (visitor.GoDeeper(level).Stop)
                break;
+            continue;
+         }
 
-            if (!result.SkipChildren && node.Children.size() > 0)
-            {
-               goBack.push_back(pos);
-               pos = make_pair(node.Children.begin(), node.Children.end());
-               level++;
-               if (visitor.GoDeeper(level).Stop)
-                  break;
-            }
-            else
+         // Go to the next sibling, going up until there is one,
+         // but never higher than the initial level.
+         while (true)
+         {
+            const NodeIndex sibling = tree.GetNextSibling(pos);
+            if (sibling != InvalidNode)
             {
-               ++pos.first;
+               pos = sibling;
+               break;
             }
-         }
-         else if (goBack.empty())
-         {
-            break;
-         }
-         else
-         {
-            pos = goBack.back();
-            goBack.pop_back();
-            ++pos.first;
+
+            if (level == 0)
+               return;
+
+            pos = tree.GetParent(pos);
             level--;
             if (visitor.GoHigher(level).Stop)
-               break;
+               return;
          }
       }
    }
 
-   void VisitInOrder(const TextTree& tree, const Node* node, bool siblings, const NodeVisitFunction& func)
+   void VisitRangeInOrder(const TextTree& tree, NodeIndex begin, NodeIndex end, TreeVisitor& visitor)
+   {
+      VisitFrozenInOrder(tree, begin, end, visitor);
+   }
+
+   void VisitInOrder(const TextTree& tree, NodeIndex node, bool siblings, const NodeVisitFunction& func)
    {
       FunctionTreeVisitor visitor(func);
       VisitInOrder(tree, node, siblings, visitor);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "TextTree.h"
+#include "OperationProgress.h"
 
 #include <functional>
 #include <memory>
@@ -27,7 +28,7 @@ namespace TreeReader
       virtual Result GoHigher(size_t higherLevel) = 0;
 
       // Called when visiting a node.
-      virtual Result Visit(const TextTree& tree, const TextTree::Node& node, size_t level) = 0;
+      virtual Result Visit(const TextTree& tree, NodeIndex node, size_t level) = 0;
    };
 
    // Simple visitor that doesn't need to know that it is going deeper or higher.
@@ -49,12 +50,12 @@ namespace TreeReader
       DelegateTreeVisitor() = default;
       DelegateTreeVisitor(const std::shared_ptr<TreeVisitor>& visitor) : Visitor(visitor) {}
 
-      Result Visit(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result Visit(const TextTree& tree, NodeIndex node, size_t level) override;
    };
 
    // A visitor that delegates to a function when visiting each node.
 
-   typedef std::function<TreeVisitor::Result(const TextTree & tree, const TextTree::Node & node, size_t level)> NodeVisitFunction;
+   typedef std::function<TreeVisitor::Result(const TextTree & tree, NodeIndex node, size_t level)> NodeVisitFunction;
 
    struct FunctionTreeVisitor : SimpleTreeVisitor
    {
@@ -63,7 +64,7 @@ namespace TreeReader
       FunctionTreeVisitor() = default;
       FunctionTreeVisitor(NodeVisitFunction f) : Func(f) {}
 
-      Result Visit(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result Visit(const TextTree& tree, NodeIndex node, size_t level) override;
    };
 
    // A delegate visitor that can be aborted from another thread.
@@ -75,7 +76,20 @@ namespace TreeReader
       CanAbortTreeVisitor() = default;
       CanAbortTreeVisitor(const std::shared_ptr<TreeVisitor> & visitor) : DelegateTreeVisitor(visitor) {}
 
-      Result Visit(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result Visit(const TextTree& tree, NodeIndex node, size_t level) override;
+   };
+
+   // A delegate visitor that adds each visited node to the progress of an operation
+   // and stops when the operation is cancelled.
+
+   struct ProgressTreeVisitor : DelegateTreeVisitor
+   {
+      ProgressBatch Progress;
+
+      ProgressTreeVisitor(OperationProgress* progress) : Progress(progress) {}
+      ProgressTreeVisitor(OperationProgress* progress, const std::shared_ptr<TreeVisitor>& visitor) : DelegateTreeVisitor(visitor), Progress(progress) {}
+
+      Result Visit(const TextTree& tree, NodeIndex node, size_t level) override;
    };
 
    // Visits each node of a tree in order.
@@ -84,27 +98,37 @@ namespace TreeReader
    //
    // Allows starting from an arbitrary node and not visiting the siblings of that initial node.
    // (Not visiting siblings also skip the initial node too.)
+   // Pass InvalidNode to visit the whole tree.
+   //
+   // When the tree is frozen, the nodes are visited by scanning them in order.
 
-   void VisitInOrder(const TextTree& tree, const TextTree::Node* node, bool siblings, TreeVisitor& visitor);
-   void VisitInOrder(const TextTree& tree, const TextTree::Node* node, bool siblings, const NodeVisitFunction& func);
+   void VisitInOrder(const TextTree& tree, NodeIndex node, bool siblings, TreeVisitor& visitor);
+   void VisitInOrder(const TextTree& tree, NodeIndex node, bool siblings, const NodeVisitFunction& func);
 
-   inline void VisitInOrder(const TextTree& tree, const TextTree::Node* node, TreeVisitor& visitor)
+   inline void VisitInOrder(const TextTree& tree, NodeIndex node, TreeVisitor& visitor)
    {
       VisitInOrder(tree, node, true, visitor);
    }
 
-   inline void VisitInOrder(const TextTree& tree, const TextTree::Node* node, const NodeVisitFunction& func)
+   inline void VisitInOrder(const TextTree& tree, NodeIndex node, const NodeVisitFunction& func)
    {
       VisitInOrder(tree, node, true, func);
    }
 
    inline void VisitInOrder(const TextTree& tree, TreeVisitor& visitor)
    {
-      VisitInOrder(tree, nullptr, true, visitor);
+      VisitInOrder(tree, InvalidNode, true, visitor);
    }
 
    inline void VisitInOrder(const TextTree& tree, const NodeVisitFunction& func)
    {
-      VisitInOrder(tree, nullptr, true, func);
+      VisitInOrder(tree, InvalidNode, true, func);
    }
+
+   // Visits the nodes of a frozen tree in order, from the beginning to the end index.
+   //
+   // The range must cover whole sibling sub-trees, for example a range of roots
+   // and their descendants. The nodes at the beginning of the range are at level zero.
+
+   void VisitRangeInOrder(const TextTree& tree, NodeIndex begin, NodeIndex end, TreeVisitor& visitor);
 }
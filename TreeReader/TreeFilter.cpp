@@ -1,14 +1,18 @@
 #include "TreeFilter.h"
+#include "TreeFilterCompiler.h"
 #include "TreeFilterHelpers.h"
 #include "TextTreeVisitor.h"
+#include "TreeReaderHelpers.h"
+#include "TaskScheduler.h"
 
+#include <atomic>
 #include <sstream>
+#include <cstring>
 
 namespace TreeReader
 {
    using namespace std;
    using Result = TreeFilter::Result;
-   using Node = TextTree::Node;
 
    constexpr Result Keep { false, false, true };
    constexpr Result Drop { false, false, false };
@@ -37,42 +41,80 @@ namespace TreeReader
          Filter = Filter->Clone();
    }
 
-   Result DelegateTreeFilter::IsKept(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result DelegateTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       if (!Filter)
          return Keep;
 
-      return Filter->IsKept(tree, node, level);
+      return Filter->IsKept(tree, node, level, context);
    }
 
-   Result AcceptTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result AcceptTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       return Keep;
    }
 
-   Result StopTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result StopTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       return Keep ? StopAndKeep : StopAndDrop;
    }
 
-   Result UntilTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result UntilTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
-      return DelegateTreeFilter::IsKept(tree, node, level).Keep ? StopAndDrop : Drop;
+      return DelegateTreeFilter::IsKept(tree, node, level, context).Keep ? StopAndDrop : Drop;
    }
 
-   Result ContainsTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result ContainsTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
-      return (wcsstr(node.TextPtr, Contained.c_str()) != nullptr) ? Keep : Drop;
+      // Note: the text is converted to UTF-8 once per filtering, in case it gets modified between them.
+      const TextSearcher& searcher = context.GetState<TextSearcher>(*this, [this]() { return TextSearcher(ConvertToUtf8(Contained)); });
+      return searcher.IsFoundIn(tree.GetText(node)) ? Keep : Drop;
    }
 
-   Result TextAddressTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   ContainsAnyTreeFilter::ContainsAnyTreeFilter(const vector<wstring>& texts)
    {
-      return (ExactAddress == node.TextPtr) ? Keep : Drop;
+      // Note: the separator is added even after empty texts, so that they are kept.
+      for (size_t i = 0; i < texts.size(); ++i)
+      {
+         if (i > 0)
+            Contained += Separator;
+         Contained += texts[i];
+      }
    }
 
-   Result RegexTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   vector<string> ContainsAnyTreeFilter::GetContainedUtf8() const
    {
-      return regex_search(node.TextPtr, Regex) ? Keep : Drop;
+      vector<string> texts;
+      for (size_t pos = 0; pos <= Contained.size(); )
+      {
+         const size_t end = min(Contained.find(Separator, pos), Contained.size());
+         texts.emplace_back(ConvertToUtf8(Contained.substr(pos, end - pos)));
+         pos = end + 1;
+      }
+      return texts;
+   }
+
+   Result ContainsAnyTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
+   {
+      const MultiTextSearcher& searcher = context.GetState<MultiTextSearcher>(*this, [this]() { return MultiTextSearcher(GetContainedUtf8()); });
+      return searcher.IsAnyFoundIn(tree.GetText(node)) ? Keep : Drop;
+   }
+
+   Result TextAddressTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
+   {
+      return (ExactAddress == tree.GetText(node).data()) ? Keep : Drop;
+   }
+
+   RegexTreeFilter::RegexTreeFilter(const wstring& reg)
+   : RegexTextForm(reg), Regex(reg)
+   {
+   }
+
+   Result RegexTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
+   {
+      // Note: matching modifies the regex, so each filtering uses its own copy.
+      const TextRegex& regex = context.GetState<TextRegex>(*this, [this]() { return Regex; });
+      return regex.IsFoundIn(tree.GetText(node)) ? Keep : Drop;
    }
 
    CombineTreeFilter::CombineTreeFilter(const CombineTreeFilter& other)
@@ -83,49 +125,64 @@ namespace TreeReader
             filter = filter->Clone();
    }
 
-   Result NotTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   bool CombineTreeFilter::IsNodePredicate() const
+   {
+      for (const auto& filter : Filters)
+         if (filter && !filter->IsNodePredicate())
+            return false;
+      return true;
+   }
+
+   Result NotTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
-      Result result = DelegateTreeFilter::IsKept(tree, node, level);
+      Result result = DelegateTreeFilter::IsKept(tree, node, level, context);
       result.Keep = !result.Keep;
       return result;
    }
 
-   Result OrTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   bool NotTreeFilter::IsNodePredicate() const
+   {
+      return !Filter || Filter->IsNodePredicate();
+   }
+
+   Result OrTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       Result result = Drop;
       for (const auto& filter : Filters)
          if (filter)
-            if (result = result | filter->IsKept(tree, node, level); result.Keep)
+            if (result = result | filter->IsKept(tree, node, level, context); result.Keep)
                break;
       return result;
    }
 
-   Result AndTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result AndTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       Result result = Keep;
       for (const auto& filter : Filters)
          if (filter)
-            if (result = result & filter->IsKept(tree, node, level); !result.Keep)
+            if (result = result & filter->IsKept(tree, node, level, context); !result.Keep)
                break;
       return result;
    }
 
-   Result UnderTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result UnderTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
+      size_t& keepAllNodesUnderLevel = context.GetState<size_t>(*this, []() { return size_t(-1); });
+
       // If we have found a match previously for the under filter,
       // then keep the nodes while we're still in levels deeper
       // than where we found the match.
-      if (level > _keepAllNodesUnderLevel)
+      if (level > keepAllNodesUnderLevel)
          return Keep;
 
       // If we've reached back up to the level where we found the match previously,
       // then stop keeping nodes. We do this by making the apply under level very large.
-      if (level <= _keepAllNodesUnderLevel)
-         _keepAllNodesUnderLevel = -1;
+      if (level <= keepAllNodesUnderLevel)
+         keepAllNodesUnderLevel = -1;
 
       // If the node doesn't match the under filter, don't apply the other filter.
       // Just return the result of the other filter.
-      Result result = DelegateTreeFilter::IsKept(tree, node, level);
+      Result result = DelegateTreeFilter::IsKept(tree, node, level, context);
       if (!result.Keep)
          return result;
 
@@ -134,7 +191,7 @@ namespace TreeReader
       //
       // Record the level at which we must come back up to to stop accepting nodes
       // without checking the filter.
-      _keepAllNodesUnderLevel = level;
+      keepAllNodesUnderLevel = level;
 
       // If the filter must not keep the matching node, then set Keep to false here.
       // apply it here.
@@ -144,28 +201,30 @@ namespace TreeReader
       return result;
    }
 
-   Result CountSiblingsTreeFilter::IsKept(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result CountSiblingsTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
+      State& state = context.GetState<State>(*this);
+
       // If we've reached back up higher than the level where we found the match previously,
       // then stop keeping nodes. We do this by making the apply under level very large
       // and the count to zero.
-      if (level < _keepNodesAtLevel)
+      if (level < state.KeepNodesAtLevel)
       {
-         _keepNodesAtLevel = -1;
-         _countdown = 0;
+         state.KeepNodesAtLevel = -1;
+         state.Countdown = 0;
       }
 
       // If we previously found a match and there are still a number of nodes to be accepted,
       // reduce that number and keep the node.
-      if (_countdown > 0 && level == _keepNodesAtLevel)
+      if (state.Countdown > 0 && level == state.KeepNodesAtLevel)
       {
-         --_countdown;
+         --state.Countdown;
          return Keep;
       }
 
       // If the node doesn't match the other filter, don't apply the other filter.
       // Just return the result of the other filter.
-      Result result = DelegateTreeFilter::IsKept(tree, node, level);
+      Result result = DelegateTreeFilter::IsKept(tree, node, level, context);
       if (!result.Keep)
          return result;
 
@@ -174,8 +233,8 @@ namespace TreeReader
       //
       // Record the level at which we must come back up to to stop accepting nodes
       // without checking the filter.
-      _keepNodesAtLevel = level;
-      _countdown = Count;
+      state.KeepNodesAtLevel = level;
+      state.Countdown = Count;
 
       // If the filter must not keep the matching node, then set Keep to false here.
       // apply it here.
@@ -185,28 +244,30 @@ namespace TreeReader
       return result;
    }
 
-   Result CountChildrenTreeFilter::IsKept(const TextTree& tree, const TextTree::Node& node, size_t level)
+   Result CountChildrenTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
+      State& state = context.GetState<State>(*this);
+
       // If we've reached back up to the level where we found the match previously,
       // then stop keeping nodes. We do this by making the apply under level very large
       // and the count to zero.
-      if (level <= _keepNodesUnderLevel)
+      if (level <= state.KeepNodesUnderLevel)
       {
-         _keepNodesUnderLevel = -1;
-         _countdown = 0;
+         state.KeepNodesUnderLevel = -1;
+         state.Countdown = 0;
       }
 
       // If we previously found a match and there are still a number of nodes to be accepted,
       // reduce that number and keep the node.
-      if (_countdown > 0 && level > _keepNodesUnderLevel)
+      if (state.Countdown > 0 && level > state.KeepNodesUnderLevel)
       {
-         --_countdown;
+         --state.Countdown;
          return Keep;
       }
 
       // If the node doesn't match the other filter, don't apply the other filter.
       // Just return the result of the other filter.
-      Result result = DelegateTreeFilter::IsKept(tree, node, level);
+      Result result = DelegateTreeFilter::IsKept(tree, node, level, context);
       if (!result.Keep)
          return result;
 
@@ -215,8 +276,8 @@ namespace TreeReader
       //
       // Record the level at which we must come back up to to stop accepting nodes
       // without checking the filter.
-      _keepNodesUnderLevel = level;
-      _countdown = Count;
+      state.KeepNodesUnderLevel = level;
+      state.Countdown = Count;
 
       // If the filter must not keep the matching node, then set Keep to false here.
       // apply it here.
@@ -226,15 +287,15 @@ namespace TreeReader
       return result;
    }
 
-   Result RemoveChildrenTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result RemoveChildrenTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
-      if (!DelegateTreeFilter::IsKept(tree, node, level).Keep)
+      if (!DelegateTreeFilter::IsKept(tree, node, level, context).Keep)
          return Keep;
 
       return IncludeSelf ? DropAndSkip : KeepAndSkip;
    }
 
-   Result LevelRangeTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result LevelRangeTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       if (level < MinLevel)
          return Drop;
@@ -245,23 +306,85 @@ namespace TreeReader
       return DropAndSkip;
    }
 
-   Result IfSubTreeTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   Result IfSubTreeTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
-      FilterTreeVisitor visitor(tree, _filtered, Filter);
-      VisitInOrder(tree, &node, false, visitor);
-      return (_filtered.Roots.size() > 0) ? Keep : Drop;
+      if (Filter && Filter->IsNodePredicate())
+      {
+         Matches& matches = context.GetState<Matches>(*this);
+         if (node < matches.Begin || node >= matches.End)
+            FindMatchesUnder(tree, node, matches, context);
+         return matches.HasMatchUnder[node - matches.Begin] ? Keep : Drop;
+      }
+
+      // Note: the sub-filter is only used here, so it can keep its state in the same context.
+      TextTree filtered;
+      FilterTreeVisitor visitor(tree, filtered, Filter, context);
+      ProgressBatch progress(context.Progress);
+      VisitInOrder(tree, node, false, [&visitor, &progress](const TextTree& tree, NodeIndex child, size_t level)
+      {
+         if (progress.Poll())
+            return TreeVisitor::Result{ true, false };
+         return visitor.Visit(tree, child, level);
+      });
+      return filtered.IsEmpty() ? Drop : Keep;
    }
 
-   Result IfSiblingTreeFilter::IsKept(const TextTree& tree, const Node& node, size_t level)
+   void IfSubTreeTreeFilter::FindMatchesUnder(const TextTree& tree, NodeIndex node, Matches& matches, TreeFilterContext& context) const
    {
-      const auto& children = node.Parent ? node.Parent->Children : tree.Roots;
-      auto pos = children.begin();
-      pos += node.IndexInParent;
+      // Note: when the tree is frozen, the sub-tree of a root is a range of nodes,
+      //       so only the sub-tree of the root of the node needs to be searched.
+      NodeIndex begin = 0;
+      NodeIndex end = NodeIndex(tree.CountNodes());
+      if (tree.IsFrozen())
+      {
+         begin = node;
+         while (tree.GetParent(begin) != InvalidNode)
+            begin = tree.GetParent(begin);
+         end = tree.GetSubTreeEnd(begin);
+      }
+
+      // Note: only the nodes of the range are kept, so that the memory used
+      //       does not depend on the size of the whole tree.
+      vector<bool>& hasMatchUnder = matches.HasMatchUnder;
+      hasMatchUnder.assign(end - begin, false);
 
-      for (; pos != children.end(); ++pos)
+      // Note: children always come after their parent, so going backward visits
+      //       all the descendants of a node before the node itself.
+      ProgressBatch progress(context.Progress);
+      for (NodeIndex child = end; child-- > begin; )
       {
-         const Node& node = **pos;
-         const auto result = DelegateTreeFilter::IsKept(tree, node, level);
+         if (progress.Poll())
+            break;
+
+         const NodeIndex parent = tree.GetParent(child);
+         if (parent == InvalidNode || hasMatchUnder[parent - begin])
+            continue;
+
+         // Note: the level does not matter to a node predicate.
+         if (hasMatchUnder[child - begin] || Filter->IsKept(tree, child, 0, context).Keep)
+            hasMatchUnder[parent - begin] = true;
+      }
+
+      matches.Begin = begin;
+      matches.End = end;
+   }
+
+   bool IfSubTreeTreeFilter::IsNodePredicate() const
+   {
+      return !Filter || Filter->IsNodePredicate();
+   }
+
+   Result IfSiblingTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
+   {
+      if (Filter && Filter->IsNodePredicate())
+      {
+         Matches& matches = context.GetState<Matches>(*this);
+         return FindMatchInSiblings(tree, node, matches, context) ? Keep : Drop;
+      }
+
+      for (NodeIndex sibling = node; sibling != InvalidNode; sibling = tree.GetNextSibling(sibling))
+      {
+         const auto result = DelegateTreeFilter::IsKept(tree, sibling, level, context);
          if (result.Keep)
             return Keep;
          if (result.Stop)
@@ -271,16 +394,105 @@ namespace TreeReader
       return Drop;
    }
 
-   Result NamedTreeFilter::IsKept(const TextTree& tree, const TextTree::Node& node, size_t level)
+   bool IfSiblingTreeFilter::FindMatchInSiblings(const TextTree& tree, NodeIndex node, Matches& matches, TreeFilterContext& context) const
+   {
+      // Note: when the tree is frozen, the siblings of a node other than a root are all
+      //       in the sub-tree of its root, so only the matches of that sub-tree are kept,
+      //       so that the memory used does not depend on the size of the whole tree.
+      if (node < matches.Begin || node >= matches.End)
+      {
+         if (tree.IsFrozen())
+         {
+            if (tree.GetParent(node) == InvalidNode)
+               return FindMatchInRoots(tree, node, matches, context);
+
+            NodeIndex root = node;
+            while (tree.GetParent(root) != InvalidNode)
+               root = tree.GetParent(root);
+            matches.Begin = root + 1;
+            matches.End = tree.GetSubTreeEnd(root);
+         }
+         else
+         {
+            matches.Begin = 0;
+            matches.End = NodeIndex(tree.CountNodes());
+         }
+         matches.InSiblings.assign(matches.End - matches.Begin, SiblingsMatch::Unknown);
+      }
+
+      vector<SiblingsMatch>& inSiblings = matches.InSiblings;
+      const NodeIndex begin = matches.Begin;
+      if (inSiblings[node - begin] != SiblingsMatch::Unknown)
+         return inSiblings[node - begin] == SiblingsMatch::Match;
+
+      // Gather the siblings up to the first one already checked.
+      vector<NodeIndex> siblings;
+      NodeIndex sibling = node;
+      for (; sibling != InvalidNode && inSiblings[sibling - begin] == SiblingsMatch::Unknown; sibling = tree.GetNextSibling(sibling))
+         siblings.emplace_back(sibling);
+
+      // Then go backward, each sibling matching if it or any following sibling matches.
+      // Note: the level does not matter to a node predicate.
+      bool match = (sibling != InvalidNode && inSiblings[sibling - begin] == SiblingsMatch::Match);
+      for (auto pos = siblings.rbegin(); pos != siblings.rend(); ++pos)
+      {
+         match = match || Filter->IsKept(tree, *pos, 0, context).Keep;
+         inSiblings[*pos - begin] = match ? SiblingsMatch::Match : SiblingsMatch::NoMatch;
+      }
+
+      return match;
+   }
+
+   bool IfSiblingTreeFilter::FindMatchInRoots(const TextTree& tree, NodeIndex root, Matches& matches, TreeFilterContext& context) const
+   {
+      // Note: the roots of a frozen tree are in order, so the known roots are a range.
+      if (matches.FirstRoot != InvalidNode && matches.FirstRoot <= root && root <= matches.LastRoot)
+         return matches.RootsMatch;
+
+      // Go forward up to the first root that matches, since all the roots before it match.
+      // Note: this checks roots filtered in other threads too, but as the roots are visited
+      //       in order, each root is checked at most once in this context.
+      // Note: the level does not matter to a node predicate.
+      matches.FirstRoot = root;
+      matches.RootsMatch = false;
+      for (NodeIndex sibling = root; sibling != InvalidNode; sibling = tree.GetNextSibling(sibling))
+      {
+         matches.LastRoot = sibling;
+         if (Filter->IsKept(tree, sibling, 0, context).Keep)
+         {
+            matches.RootsMatch = true;
+            break;
+         }
+      }
+
+      return matches.RootsMatch;
+   }
+
+   bool IfSiblingTreeFilter::IsNodePredicate() const
+   {
+      return !Filter || Filter->IsNodePredicate();
+   }
+
+   Result NamedTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
    {
       if (!Filter)
          return Keep;
 
-      return Filter->IsKept(tree, node, level);
+      return Filter->IsKept(tree, node, level, context);
+   }
+
+   bool NamedTreeFilter::IsNodePredicate() const
+   {
+      return !Filter || Filter->IsNodePredicate();
    }
 
    FilterTreeVisitor::FilterTreeVisitor(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter)
-   : FilteredTree(filteredTree), Filter(filter)
+   : FilterTreeVisitor(sourceTree, filteredTree, filter, _ownContext)
+   {
+   }
+
+   FilterTreeVisitor::FilterTreeVisitor(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter, TreeFilterContext& context)
+   : FilteredTree(filteredTree), Filter(filter), Context(context)
    {
       filteredTree.Reset();
       filteredTree.SourceTextLines = sourceTree.SourceTextLines;
@@ -290,56 +502,220 @@ namespace TreeReader
       // zero and did not keep it.
       //
       // So the current filtered branch for level zero is null.
-      _filteredBranchNodes.push_back(nullptr);
+      _filteredBranchNodes.push_back(InvalidNode);
       _fillChildren.push_back(false);
    }
 
-   TreeVisitor::Result FilterTreeVisitor::Visit(const TextTree& tree, const Node& sourceNode, const size_t sourceLevel)
+   TreeVisitor::Result FilterTreeVisitor::Visit(const TextTree& tree, NodeIndex sourceNode, const size_t sourceLevel)
    {
       if (!Filter)
          return Result();
 
-      _filteredBranchNodes.resize(sourceLevel + 1, nullptr);
+      _filteredBranchNodes.resize(sourceLevel + 1, InvalidNode);
       _fillChildren.resize(sourceLevel + 1, false);
 
-      // Either the index of the newly created filtered node if kept, or -1 if not kept.
-      Node* filteredNode = nullptr;
+      // Either the index of the newly created filtered node if kept, or InvalidNode if not kept.
+      NodeIndex filteredNode = InvalidNode;
 
-      const TreeFilter::Result result = Filter->IsKept(tree, sourceNode, sourceLevel);
+      const TreeFilter::Result result = Filter->IsKept(tree, sourceNode, sourceLevel, Context);
       if (result.Keep)
       {
          // Connect to the nearest node in the branch.
-         Node* addUnder = nullptr;
+         NodeIndex addUnder = InvalidNode;
          for (size_t level = sourceLevel; level < _filteredBranchNodes.size(); --level)
          {
-            if (_filteredBranchNodes[level])
+            if (_filteredBranchNodes[level] != InvalidNode)
             {
                // If the node is at the same level, do not add as a child.
-               addUnder = (level < sourceLevel && _fillChildren[level]) ? _filteredBranchNodes[level] : _filteredBranchNodes[level]->Parent;
+               addUnder = (level < sourceLevel && _fillChildren[level]) ? _filteredBranchNodes[level] : FilteredTree.GetParent(_filteredBranchNodes[level]);
                break;
             }
          }
 
-         filteredNode = FilteredTree.AddChild(addUnder, sourceNode.TextPtr);
+         filteredNode = FilteredTree.AddChild(addUnder, tree.GetText(sourceNode));
       }
 
       // If kept, this node is the new active node for this level.
       // If not kept, do not over-write a sibling node that may exists at this level.
-      _filteredBranchNodes.resize(sourceLevel + 1, nullptr);
-      if (filteredNode)
+      _filteredBranchNodes.resize(sourceLevel + 1, InvalidNode);
+      if (filteredNode != InvalidNode)
          _filteredBranchNodes[sourceLevel] = filteredNode;
 
       // If the node is kept, start to add sub-node as children.
       // If not kept, make any existing singling node begin to add node as sibling instead
       // of children.
       _fillChildren.resize(sourceLevel + 1, false);
-      _fillChildren[sourceLevel] = (filteredNode != nullptr);
+      _fillChildren[sourceLevel] = (filteredNode != InvalidNode);
 
       // Note: we really do want to slice the result down to the TreeVisitor::Result type.
       return TreeVisitor::Result(result);
    }
 
-   void FilterTree(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter)
+   namespace
+   {
+      // The smallest number of nodes worth filtering in its own thread,
+      // and how many groups of roots to make for each thread.
+      constexpr size_t MinParallelNodes = 16 * 1024;
+      constexpr size_t GroupsPerThread = 8;
+
+      // Split the roots of a frozen tree or of a view in groups of about the same number of nodes,
+      // more groups than threads, so the threads that are done early take the remaining groups.
+      // Returns the beginning of each group, followed by the end of the tree, given its number of nodes.
+      template <class Tree>
+      vector<NodeIndex> SplitRootsInGroups(const Tree& tree, size_t nodeCount, size_t chunkCount)
+      {
+         const size_t groupSize = max(size_t(1), nodeCount / (chunkCount * GroupsPerThread));
+
+         vector<NodeIndex> groupBegins;
+         for (NodeIndex root = tree.GetFirstChild(InvalidNode); root != InvalidNode; root = tree.GetNextSibling(root))
+            if (groupBegins.empty() || root - groupBegins.back() >= groupSize)
+               groupBegins.emplace_back(root);
+         groupBegins.emplace_back(NodeIndex(nodeCount));
+         return groupBegins;
+      }
+
+      // Filter the tree with the compiled filter, splitting its roots among many threads when possible.
+      // Adds the filtered nodes to the optional progress and stops early if it is cancelled.
+      void FilterCompiledTree(const TextTree& sourceTree, TextTree& filteredTree, const shared_ptr<CompiledTreeFilter>& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount, OperationProgress* progress)
+      {
+         const size_t nodeCount = sourceTree.CountNodes();
+         if (progress)
+            progress->AddTotal(nodeCount);
+         const size_t chunkCount = CountParallelChunks(nodeCount, MinParallelNodes, threadCount);
+
+         vector<NodeIndex> groupBegins;
+         if (chunkCount > 1 && sourceTree.IsFrozen() && filter->CanFilterRootsSeparately())
+            groupBegins = SplitRootsInGroups(sourceTree, nodeCount, chunkCount);
+
+         if (groupBegins.size() <= 2)
+         {
+            auto visitor = make_shared<FilterTreeVisitor>(sourceTree, filteredTree, filter);
+            visitor->Context.Index = index;
+            visitor->Context.Progress = progress;
+            ProgressTreeVisitor progressVisitor(progress, visitor);
+            VisitInOrder(sourceTree, progressVisitor);
+            filteredTree.Freeze();
+            return;
+         }
+
+         const size_t groupCount = groupBegins.size() - 1;
+         vector<TextTree> filteredGroups(groupCount);
+         atomic<size_t> nextGroup = 0;
+         // Note: what is found once for the whole tree is shared by the contexts of the threads.
+         TreeFilterContext sharedContext;
+         sharedContext.Index = index;
+         sharedContext.Progress = progress;
+         RunInParallel(min(chunkCount, groupCount), [&](size_t)
+         {
+            // Note: the filters forget what they remember when they reach a root,
+            //       so each thread can keep the same context for all its groups.
+            TreeFilterContext context = sharedContext.CreateSharingContext();
+            ProgressTreeVisitor progressVisitor(progress);
+            for (size_t group = nextGroup++; group < groupCount && !progressVisitor.Progress.IsCancelled(); group = nextGroup++)
+            {
+               progressVisitor.Visitor = make_shared<FilterTreeVisitor>(sourceTree, filteredGroups[group], filter, context);
+               VisitRangeInOrder(sourceTree, groupBegins[group], groupBegins[group + 1], progressVisitor);
+            }
+         });
+
+         // Put the filtered groups back together, in order.
+         // Note: the nodes of each group were added in order, parents before their children.
+         vector<string_view> texts;
+         vector<NodeIndex> parents;
+         for (const TextTree& group : filteredGroups)
+         {
+            const NodeIndex offset = NodeIndex(texts.size());
+            for (NodeIndex node = 0; node < group.CountNodes(); ++node)
+            {
+               const NodeIndex parent = group.GetParent(node);
+               texts.emplace_back(group.GetText(node));
+               parents.emplace_back(parent == InvalidNode ? InvalidNode : parent + offset);
+            }
+         }
+
+         filteredTree.Reset();
+         filteredTree.SourceTextLines = sourceTree.SourceTextLines;
+         filteredTree.AddNodes(texts, parents, threadCount);
+         filteredTree.Freeze();
+      }
+
+      // Filter the kept nodes of the view with the compiled filter into another view,
+      // splitting the roots of the view among many threads when possible.
+      // Adds the filtered nodes to the optional progress and stops early if it is cancelled.
+      void FilterCompiledView(const FilteredView& sourceView, FilteredView& filteredView, const shared_ptr<CompiledTreeFilter>& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount, OperationProgress* progress)
+      {
+         const TextTree& sourceTree = sourceView.SourceTree;
+         const size_t nodeCount = sourceTree.CountNodes();
+         const size_t viewNodeCount = sourceView.CountNodes();
+
+         // Note: the filters that look around the node must see the tree of the view,
+         //       so that tree is created and filtered. It has the kept nodes in the same
+         //       order, so its filtered nodes are then mapped back to the source tree.
+         if (!filter->CanFilterViews() && viewNodeCount != nodeCount)
+         {
+            FilteredView wholeViewTree(sourceView.CreateTree());
+            wholeViewTree.KeepAll();
+            FilteredView filteredViewTree;
+            FilterCompiledView(wholeViewTree, filteredViewTree, filter, {}, threadCount, progress);
+
+            filteredView.Reset(sourceTree);
+            NodeIndex viewTreeNode = 0;
+            VisitInOrder(sourceView, [&filteredView, &filteredViewTree, &viewTreeNode](const TextTree&, NodeIndex node, size_t)
+            {
+               if (filteredViewTree.IsKept(viewTreeNode++))
+                  filteredView.Keep(node);
+               return TreeVisitor::Result();
+            });
+            return;
+         }
+
+         if (progress)
+            progress->AddTotal(viewNodeCount);
+         const size_t chunkCount = CountParallelChunks(viewNodeCount, MinParallelNodes, threadCount);
+
+         vector<NodeIndex> groupBegins;
+         if (chunkCount > 1 && filter->CanFilterRootsSeparately())
+            groupBegins = SplitRootsInGroups(sourceView, nodeCount, chunkCount);
+         if (groupBegins.size() <= 2)
+            groupBegins = { 0, NodeIndex(nodeCount) };
+
+         // Note: each group lists the nodes it keeps, which are only kept in the view once
+         //       all groups are done, since two groups can have nodes in the same word of bits.
+         const size_t groupCount = groupBegins.size() - 1;
+         vector<vector<NodeIndex>> keptGroups(groupCount);
+         atomic<size_t> nextGroup = 0;
+         // Note: what is found once for the whole tree is shared by the contexts of the threads.
+         TreeFilterContext sharedContext;
+         sharedContext.Index = index;
+         sharedContext.Progress = progress;
+         RunInParallel(min(chunkCount, groupCount), [&](size_t)
+         {
+            // Note: the filters forget what they remember when they reach a root,
+            //       so each thread can keep the same context for all its groups.
+            TreeFilterContext context = sharedContext.CreateSharingContext();
+            ProgressTreeVisitor progressVisitor(progress);
+            for (size_t group = nextGroup++; group < groupCount && !progressVisitor.Progress.IsCancelled(); group = nextGroup++)
+            {
+               vector<NodeIndex>& kept = keptGroups[group];
+               progressVisitor.Visitor = make_shared<FunctionTreeVisitor>([&filter, &context, &kept](const TextTree& tree, NodeIndex node, size_t level)
+               {
+                  const TreeFilter::Result result = filter->IsKept(tree, node, level, context);
+                  if (result.Keep)
+                     kept.emplace_back(node);
+                  return TreeVisitor::Result(result);
+               });
+               VisitRangeInOrder(sourceView, groupBegins[group], groupBegins[group + 1], progressVisitor);
+            }
+         });
+
+         filteredView.Reset(sourceTree);
+         for (const vector<NodeIndex>& kept : keptGroups)
+            for (const NodeIndex node : kept)
+               filteredView.Keep(node);
+      }
+   }
+
+   void FilterTree(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount, OperationProgress* progress)
    {
       if (!filter)
       {
@@ -347,25 +723,60 @@ namespace TreeReader
          return;
       }
 
-      FilterTreeVisitor visitor(sourceTree, filteredTree, filter);
-      VisitInOrder(sourceTree, visitor);
+      // Note: the filter is run in its compiled form.
+      FilterCompiledTree(sourceTree, filteredTree, CompileFilter(filter), index, threadCount, progress);
+   }
+
+   void FilterTree(const TextTree& sourceTree, FilteredView& filteredView, const TreeFilterPtr& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount, OperationProgress* progress)
+   {
+      // Note: the view freezes its copy of the source tree, so that copy is the one visited.
+      FilteredView wholeTree(sourceTree);
+      wholeTree.KeepAll();
+      FilterTree(wholeTree, filteredView, filter, index, threadCount, progress);
    }
 
-   AsyncFilterTreeResult FilterTreeAsync(const shared_ptr<TextTree>& sourceTree, const TreeFilterPtr& filter)
+   void FilterTree(const FilteredView& sourceView, FilteredView& filteredView, const TreeFilterPtr& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount, OperationProgress* progress)
+   {
+      if (!filter)
+      {
+         filteredView = sourceView;
+         return;
+      }
+
+      // Note: the filter is run in its compiled form.
+      FilterCompiledView(sourceView, filteredView, CompileFilter(filter), index, threadCount, progress);
+   }
+
+   AsyncFilterTreeResult FilterTreeAsync(const shared_ptr<TextTree>& sourceTree, const TreeFilterPtr& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount)
    {
       if (!filter)
          return {};
 
-      auto abort = make_shared<CanAbortTreeVisitor>();
-      auto fut = async(launch::async, [sourceTree, filter, abort]()
+      auto progress = make_shared<OperationProgress>();
+      auto fut = TaskScheduler::GetShared().Submit([sourceTree, filter = CompileFilter(filter), index, threadCount, progress]()
       {
          TextTree filtered;
-         abort->Visitor = make_shared<FilterTreeVisitor>(*sourceTree, filtered, filter);
-         VisitInOrder(*sourceTree, *abort);
+         FilterCompiledTree(*sourceTree, filtered, filter, index, threadCount, progress.get());
          return filtered;
-      });
+      }, TaskScheduler::Priority::Interactive);
+
+      return make_pair(move(fut), progress);
+   }
+
+   AsyncFilterViewResult FilterTreeAsync(const shared_ptr<const FilteredView>& sourceView, const TreeFilterPtr& filter, const shared_ptr<const TextTreeIndex>& index, size_t threadCount)
+   {
+      if (!filter)
+         return {};
+
+      auto progress = make_shared<OperationProgress>();
+      auto fut = TaskScheduler::GetShared().Submit([sourceView, filter = CompileFilter(filter), index, threadCount, progress]()
+      {
+         FilteredView filtered;
+         FilterCompiledView(*sourceView, filtered, filter, index, threadCount, progress.get());
+         return filtered;
+      }, TaskScheduler::Priority::Interactive);
 
-      return make_pair(move(fut), abort);
+      return make_pair(move(fut), progress);
    }
 
    #define IMPLEMENT_SIMPLE_NAME(cl, name, desc)      \
@@ -402,6 +813,7 @@ namespace TreeReader
    IMPLEMENT_SIMPLE_NAME(StopTreeFilter,           L"Stop",                            L"Stops filtering")
    IMPLEMENT_SIMPLE_NAME(UntilTreeFilter,          L"Until",                           L"Stops filtering when the sub-filter accepts a node")
    IMPLEMENT_STREAM_NAME(ContainsTreeFilter,       L"Match", Contained,                L"Keeps the node if it matches the given text")
+   IMPLEMENT_STREAM_NAME(ContainsAnyTreeFilter,    L"Match any", Contained,            L"Keeps the node if it matches any of the given texts, separated by |")
    IMPLEMENT_STREAM_NAME(TextAddressTreeFilter,    L"Exact node", ExactAddress,        L"Keeps one exact, previously selected node")
    IMPLEMENT_STREAM_NAME(RegexTreeFilter,          L"Match regex", RegexTextForm,      L"Keeps the node if it matches the given regular expression")
    IMPLEMENT_SIMPLE_NAME(NotTreeFilter,            L"Not",                             L"Inverses the result of the sub-filter")
@@ -429,6 +841,7 @@ namespace TreeReader
    IMPLEMENT_CLONE(StopTreeFilter)
    IMPLEMENT_CLONE(UntilTreeFilter)
    IMPLEMENT_CLONE(ContainsTreeFilter)
+   IMPLEMENT_CLONE(ContainsAnyTreeFilter)
    IMPLEMENT_CLONE(TextAddressTreeFilter)
    IMPLEMENT_CLONE(RegexTreeFilter)
    IMPLEMENT_CLONE(NotTreeFilter)
@@ -2,18 +2,102 @@
 
 #include "TextTree.h"
 #include "TextTreeVisitor.h"
+#include "FilteredView.h"
+#include "TextSearcher.h"
+#include "TextRegex.h"
+#include "TextTreeIndex.h"
 
 #include <string>
 #include <memory>
 #include <vector>
-#include <regex>
 #include <future>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
 
 namespace TreeReader
 {
    struct TreeFilter;
    typedef std::shared_ptr<TreeFilter> TreeFilterPtr;
 
+   // What the filters remember while filtering a tree.
+   //
+   // The filters themselves are never modified while filtering. The filters that
+   // remember what they have seen, like under or count filters, keep their state
+   // in the context instead. Each filtering of a tree uses its own context, so
+   // the same filter can be used to filter many trees at once, in many threads.
+   //
+   // When a tree is filtered by many threads, each one has its own context, but
+   // they share what is found once for the whole tree and never modified after,
+   // like the nodes that may contain a text, according to the index of the tree.
+
+   struct TreeFilterContext
+   {
+      // The optional index of the filtered tree.
+      std::shared_ptr<const TextTreeIndex> Index;
+
+      // The optional progress of the filtering, checked by filters that search
+      // many nodes for a single node, to stop early when it is cancelled.
+      OperationProgress* Progress = nullptr;
+
+      // Get the state of the filter, created by the given function the first time.
+      template <class T, class Create>
+      T& GetState(const TreeFilter& filter, Create&& create)
+      {
+         // Note: the same filter is usually asked for its state many times in a row.
+         if (&filter != _lastFilter)
+         {
+            auto pos = _states.find(&filter);
+            if (pos == _states.end())
+               pos = _states.emplace(&filter, std::make_shared<T>(create())).first;
+            _lastFilter = &filter;
+            _lastState = pos->second.get();
+         }
+         return *static_cast<T*>(_lastState);
+      }
+
+      template <class T>
+      T& GetState(const TreeFilter& filter)
+      {
+         return GetState<T>(filter, []() { return T(); });
+      }
+
+      // Get the state of the filter shared with the contexts filtering the same tree
+      // in other threads, created by the given function the first time.
+      // Note: the function must not get another shared state.
+      template <class T, class Create>
+      const T& GetSharedState(const TreeFilter& filter, Create&& create)
+      {
+         std::lock_guard lock(_shared->Mutex);
+         auto pos = _shared->States.find(&filter);
+         if (pos == _shared->States.end())
+            pos = _shared->States.emplace(&filter, std::make_shared<const T>(create())).first;
+         return *static_cast<const T*>(pos->second.get());
+      }
+
+      // Create a context to filter the same tree in another thread, sharing the shared states.
+      TreeFilterContext CreateSharingContext() const
+      {
+         TreeFilterContext context;
+         context.Index = Index;
+         context.Progress = Progress;
+         context._shared = _shared;
+         return context;
+      }
+
+   private:
+      struct SharedStates
+      {
+         std::mutex Mutex;
+         std::unordered_map<const TreeFilter*, std::shared_ptr<const void>> States;
+      };
+
+      std::unordered_map<const TreeFilter*, std::shared_ptr<void>> _states;
+      const TreeFilter* _lastFilter = nullptr;
+      void* _lastState = nullptr;
+      std::shared_ptr<SharedStates> _shared = std::make_shared<SharedStates>();
+   };
+
    // Filter used to reduce a text tree to another simpler text tree.
 
    struct TreeFilter
@@ -40,7 +124,14 @@ namespace TreeReader
       virtual ~TreeFilter() {};
 
       // Filter a node to decide to keep drop the node.
-      virtual Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) = 0;
+      // Anything remembered while filtering the tree is kept in the context.
+      virtual Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const = 0;
+
+      // Verify if the result of the filter only depends on the node itself,
+      // not on its level nor on the nodes visited before. Such a filter never
+      // stops the filtering nor skips children, so it can be evaluated on any
+      // node in any order.
+      virtual bool IsNodePredicate() const { return false; }
 
       // Gets the name of the node, including its data.
       virtual std::wstring GetName() const;
@@ -67,14 +158,15 @@ namespace TreeReader
       DelegateTreeFilter(const TreeFilterPtr& filter) : Filter(filter) { }
       DelegateTreeFilter(const DelegateTreeFilter& other);
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
    };
 
    // Filter that accepts all nodes.
 
    struct AcceptTreeFilter : TreeFilter
    {
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override { return true; }
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -91,7 +183,7 @@ namespace TreeReader
       StopTreeFilter() = default;
       StopTreeFilter(bool keep) : Keep(keep) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -106,7 +198,7 @@ namespace TreeReader
       UntilTreeFilter() = default;
       UntilTreeFilter(const TreeFilterPtr& filter) : DelegateTreeFilter(filter) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -121,7 +213,35 @@ namespace TreeReader
       ContainsTreeFilter() = default;
       ContainsTreeFilter(const std::wstring& text) : Contained(text) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override { return true; }
+      std::wstring GetName() const override;
+      std::wstring GetShortName() const override;
+      std::wstring GetDescription() const override;
+      TreeFilterPtr Clone() const override;
+   };
+
+   // Filter that keeps nodes containing any of many texts.
+   //
+   // The texts are separated by a vertical bar, like the alternatives in a
+   // regular expression. All the texts are searched at once, so a node text
+   // is read only once, however many texts are searched for.
+
+   struct ContainsAnyTreeFilter : TreeFilter
+   {
+      static constexpr wchar_t Separator = L'|';
+
+      std::wstring Contained;
+
+      ContainsAnyTreeFilter() = default;
+      ContainsAnyTreeFilter(const std::wstring& texts) : Contained(texts) { }
+      ContainsAnyTreeFilter(const std::vector<std::wstring>& texts);
+
+      // The texts contained, in UTF-8.
+      std::vector<std::string> GetContainedUtf8() const;
+
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override { return true; }
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
@@ -133,12 +253,13 @@ namespace TreeReader
 
    struct TextAddressTreeFilter : TreeFilter
    {
-      const wchar_t* ExactAddress = nullptr;
+      const char* ExactAddress = nullptr;
 
       TextAddressTreeFilter() = default;
-      TextAddressTreeFilter(const wchar_t* addr) : ExactAddress(addr) { }
+      TextAddressTreeFilter(const char* addr) : ExactAddress(addr) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override { return true; }
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
@@ -146,16 +267,20 @@ namespace TreeReader
    };
 
    // Filter that keeps nodes matching a regular expression.
+   //
+   // The regular expression matches the UTF-8 tree text in linear time.
+   // An invalid regular expression keeps no node.
 
    struct RegexTreeFilter : TreeFilter
    {
       std::wstring RegexTextForm;
-      std::wregex Regex;
+      TextRegex Regex;
 
       RegexTreeFilter() = default;
-      RegexTreeFilter(const std::wstring& reg) : RegexTextForm(reg), Regex(std::wregex(reg)) { }
+      RegexTreeFilter(const std::wstring& reg);
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override { return true; }
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
@@ -173,6 +298,8 @@ namespace TreeReader
       CombineTreeFilter(const TreeFilterPtr& lhs, const TreeFilterPtr& rhs) { Filters.push_back(lhs); Filters.push_back(rhs); }
       CombineTreeFilter(const std::vector<TreeFilterPtr>& filters) : Filters(filters) {}
       CombineTreeFilter(const CombineTreeFilter& other);
+
+      bool IsNodePredicate() const override;
    };
 
    // Filter that inverts the keep decision of another filter.
@@ -182,7 +309,8 @@ namespace TreeReader
       NotTreeFilter() = default;
       NotTreeFilter(const TreeFilterPtr& filter) : DelegateTreeFilter(filter) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -196,7 +324,7 @@ namespace TreeReader
       OrTreeFilter(const TreeFilterPtr& lhs, const TreeFilterPtr& rhs) : CombineTreeFilter(lhs, rhs) { }
       OrTreeFilter(const std::vector<TreeFilterPtr>& filters) : CombineTreeFilter(filters) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -210,7 +338,7 @@ namespace TreeReader
       AndTreeFilter(const TreeFilterPtr& lhs, const TreeFilterPtr& rhs) : CombineTreeFilter(lhs, rhs) { }
       AndTreeFilter(const std::vector<TreeFilterPtr>& filters) : CombineTreeFilter(filters) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -228,13 +356,10 @@ namespace TreeReader
       UnderTreeFilter(const TreeFilterPtr& filter, bool includeSelf = true)
          : DelegateTreeFilter(filter), IncludeSelf(includeSelf) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
-
-   private:
-      size_t _keepAllNodesUnderLevel = -1;
    };
 
    // Filter that accepts a given number of siblings of a node that was accepted by another filter.
@@ -250,15 +375,19 @@ namespace TreeReader
       CountSiblingsTreeFilter(const TreeFilterPtr& filter, size_t count, bool includeSelf = true)
          : DelegateTreeFilter(filter), Count(count), IncludeSelf(includeSelf) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
 
    private:
-      size_t _keepNodesAtLevel = -1;
-      size_t _countdown = 0;
+      // The state kept in the context while filtering.
+      struct State
+      {
+         size_t KeepNodesAtLevel = size_t(-1);
+         size_t Countdown = 0;
+      };
    };
 
    // Filter that accepts a given number of children of a node that was accepted by another filter.
@@ -274,15 +403,19 @@ namespace TreeReader
       CountChildrenTreeFilter(const TreeFilterPtr& filter, size_t count, bool includeSelf = true)
          : DelegateTreeFilter(filter), Count(count), IncludeSelf(includeSelf) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
 
    private:
-      size_t _keepNodesUnderLevel = -1;
-      size_t _countdown = 0;
+      // The state kept in the context while filtering.
+      struct State
+      {
+         size_t KeepNodesUnderLevel = size_t(-1);
+         size_t Countdown = 0;
+      };
    };
 
    // Filter that removes all children of a node that was accepted by another filter.
@@ -297,7 +430,7 @@ namespace TreeReader
       RemoveChildrenTreeFilter(const TreeFilterPtr& filter, bool removeSelf)
          : DelegateTreeFilter(filter), IncludeSelf(removeSelf) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -313,7 +446,7 @@ namespace TreeReader
       LevelRangeTreeFilter() = default;
       LevelRangeTreeFilter(size_t minLevel, size_t maxLevel) : MinLevel(minLevel), MaxLevel(maxLevel) {}
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
       std::wstring GetName() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
@@ -321,32 +454,82 @@ namespace TreeReader
    };
 
    // Filter that accepts a node if at least one child is accepted by another filter.
-
+   //
+   // When the sub-filter only depends on the node itself, which descendants match
+   // is found for all nodes at once, in a single pass over the tree, the first time
+   // the filter is used while filtering that tree. When the tree is frozen, the pass
+   // is only over the sub-tree of the root being filtered, one root at a time.
    struct IfSubTreeTreeFilter : DelegateTreeFilter
    {
       IfSubTreeTreeFilter() = default;
       IfSubTreeTreeFilter(const TreeFilterPtr& filter) : DelegateTreeFilter(filter) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
 
    private:
-      TextTree _filtered;
+      // The nodes that have a descendant that matches the sub-filter, known for the
+      // nodes in the range from begin to end, starting at begin. Kept in the context
+      // while filtering.
+      struct Matches
+      {
+         std::vector<bool> HasMatchUnder;
+         NodeIndex Begin = 0;
+         NodeIndex End = 0;
+      };
+
+      // Find which nodes have a descendant that matches the sub-filter, for the given node.
+      void FindMatchesUnder(const TextTree& tree, NodeIndex node, Matches& matches, TreeFilterContext& context) const;
    };
 
    // Filter that accepts a node if at least one sibling is accepted by another filter.
-
+   //
+   // When the sub-filter only depends on the node itself, the result of all the
+   // following siblings is found at once and remembered, so that each sibling is
+   // only checked once.
    struct IfSiblingTreeFilter : DelegateTreeFilter
    {
       IfSiblingTreeFilter() = default;
       IfSiblingTreeFilter(const TreeFilterPtr& filter) : DelegateTreeFilter(filter) { }
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
+
+   private:
+      // For each node, unknown, no match or match in the node or its following siblings.
+      enum class SiblingsMatch : std::uint8_t { Unknown, NoMatch, Match };
+
+      // What is known of the siblings, kept in the context while filtering.
+      //
+      // The matches are known for the nodes in the range from begin to end, starting
+      // at begin. When the tree is frozen, that range is the sub-tree of the root being
+      // filtered, without the root itself. The roots are instead known to match or not
+      // from the first to the last root, in order, the last root being the one that
+      // matches or the last root of the tree.
+      struct Matches
+      {
+         std::vector<SiblingsMatch> InSiblings;
+         NodeIndex Begin = 0;
+         NodeIndex End = 0;
+
+         NodeIndex FirstRoot = InvalidNode;
+         NodeIndex LastRoot = InvalidNode;
+         bool RootsMatch = false;
+      };
+
+      // Find if the node or any of its following siblings matches the sub-filter,
+      // for the node and all its following siblings at once.
+      bool FindMatchInSiblings(const TextTree& tree, NodeIndex node, Matches& matches, TreeFilterContext& context) const;
+
+      // Find if the root or any of its following roots matches the sub-filter,
+      // stopping at the first that matches.
+      bool FindMatchInRoots(const TextTree& tree, NodeIndex root, Matches& matches, TreeFilterContext& context) const;
    };
 
    // Filter that reference a named filter.
@@ -362,7 +545,8 @@ namespace TreeReader
 
       NamedTreeFilter() = default;
 
-      Result IsKept(const TextTree& tree, const TextTree::Node& node, size_t level) override;
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override;
       std::wstring GetShortName() const override;
       std::wstring GetDescription() const override;
       TreeFilterPtr Clone() const override;
@@ -380,7 +564,9 @@ namespace TreeReader
    inline std::shared_ptr<StopTreeFilter> Stop() { return std::make_shared<StopTreeFilter>(); }
    inline std::shared_ptr<UntilTreeFilter> Until(const TreeFilterPtr& filter) { return std::make_shared<UntilTreeFilter>(filter); }
    inline std::shared_ptr<ContainsTreeFilter> Contains(const std::wstring& text) { return std::make_shared<ContainsTreeFilter>(text); }
-   inline std::shared_ptr<TextAddressTreeFilter> ExactAddress(const wchar_t* text) { return std::make_shared<TextAddressTreeFilter>(text); }
+   inline std::shared_ptr<ContainsAnyTreeFilter> ContainsAny(const std::wstring& texts) { return std::make_shared<ContainsAnyTreeFilter>(texts); }
+   inline std::shared_ptr<ContainsAnyTreeFilter> ContainsAny(const std::vector<std::wstring>& texts) { return std::make_shared<ContainsAnyTreeFilter>(texts); }
+   inline std::shared_ptr<TextAddressTreeFilter> ExactAddress(const char* text) { return std::make_shared<TextAddressTreeFilter>(text); }
    inline std::shared_ptr<RegexTreeFilter> Regex(const wchar_t* reg) { return std::make_shared<RegexTreeFilter>(reg ? reg : L""); }
    inline std::shared_ptr<RegexTreeFilter> Regex(const std::wstring& reg) { return std::make_shared<RegexTreeFilter>(reg); }
    inline std::shared_ptr<NotTreeFilter> Not(const TreeFilterPtr& filter) { return std::make_shared<NotTreeFilter>(filter); }
@@ -405,24 +591,76 @@ namespace TreeReader
       TextTree& FilteredTree;
       TreeFilterPtr Filter;
 
+      // What the filter remembers while filtering the tree.
+      // Either the own context of the visitor or the one it was given.
+      TreeFilterContext& Context;
+
       FilterTreeVisitor(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter);
+      FilterTreeVisitor(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter, TreeFilterContext& context);
 
-      Result Visit(const TextTree& tree, const TextTree::Node& sourceNode, const size_t sourceLevel) override;
+      Result Visit(const TextTree& tree, NodeIndex sourceNode, const size_t sourceLevel) override;
 
    private:
       // This keeps the current branch of nodes we have created.
       // We will keep one entry per source level, even when some
       // levels were filtered out.
-      std::vector<TextTree::Node *> _filteredBranchNodes;
+      std::vector<NodeIndex> _filteredBranchNodes;
       std::vector<bool> _fillChildren;
+
+      TreeFilterContext _ownContext;
    };
 
    // Filters a source tree into a filtered tree using the given filter.
+   // The filtered tree is frozen.
+   //
+   // The optional index of the source tree lets text searches skip the nodes
+   // that cannot contain their text.
+   //
+   // When the source tree is frozen, its roots are split in groups that are
+   // filtered in parallel, using the given number of threads, or one per core
+   // if zero, then the filtered groups are put back together in order.
+   //
+   // Note: filters that stop the filtering or count siblings, and filters that
+   //       cannot be compiled unless they only look at the node, can depend on
+   //       the roots filtered before, so the tree is then filtered by a single
+   //       thread. So is a tree with a single root.
+   //
+   // The optional progress counts the nodes filtered. When it is cancelled,
+   // the filtering stops early and the filtered tree is incomplete.
+
+   void FilterTree(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter, const std::shared_ptr<const TextTreeIndex>& index = {}, size_t threadCount = 0, OperationProgress* progress = nullptr);
+
+   // Filters a source tree into a filtered view using the given filter.
+   // Only marks the kept nodes, no node is copied.
+
+   void FilterTree(const TextTree& sourceTree, FilteredView& filteredView, const TreeFilterPtr& filter, const std::shared_ptr<const TextTreeIndex>& index = {}, size_t threadCount = 0, OperationProgress* progress = nullptr);
+
+   // Filters the kept nodes of a filtered view into another view of the same source tree,
+   // keeping the same nodes as filtering the tree created from the view would.
+   //
+   // Since the nodes are still those of the source tree, its index can be used, and
+   // the roots of the view are filtered in parallel like those of a frozen tree.
+   //
+   // Note: filters that look at the nodes around a node, like if-sub or if-sib, must
+   //       not see the nodes that the view dropped, so the tree of the view is then
+   //       created and filtered.
+   //
+   // The optional progress counts the nodes filtered. When it is cancelled,
+   // the filtering stops early and the filtered view is incomplete.
+
+   void FilterTree(const FilteredView& sourceView, FilteredView& filteredView, const TreeFilterPtr& filter, const std::shared_ptr<const TextTreeIndex>& index = {}, size_t threadCount = 0, OperationProgress* progress = nullptr);
+
+   using AsyncFilterTreeResult = std::pair<std::future<TextTree>, std::shared_ptr<OperationProgress>>;
+
+   // Filters a source tree into a filtered tree as an interactive task of the shared task scheduler.
+   // The returned progress counts the nodes filtered. The filtering stops early when it is cancelled.
+
+   AsyncFilterTreeResult FilterTreeAsync(const std::shared_ptr<TextTree>& sourceTree, const TreeFilterPtr& filter, const std::shared_ptr<const TextTreeIndex>& index = {}, size_t threadCount = 0);
 
-   void FilterTree(const TextTree& sourceTree, TextTree& filteredTree, const TreeFilterPtr& filter);
+   using AsyncFilterViewResult = std::pair<std::future<FilteredView>, std::shared_ptr<OperationProgress>>;
 
-   using AsyncFilterTreeResult = std::pair<std::future<TextTree>, std::shared_ptr<CanAbortTreeVisitor>>;
+   // Filters the kept nodes of a filtered view into another view as an interactive task of the shared task scheduler.
 
-   AsyncFilterTreeResult FilterTreeAsync(const std::shared_ptr<TextTree>& sourceTree, const TreeFilterPtr& filter);
+   AsyncFilterViewResult FilterTreeAsync(const std::shared_ptr<const FilteredView>& sourceView, const TreeFilterPtr& filter, const std::shared_ptr<const TextTreeIndex>& index = {}, size_t threadCount = 0);
 }
 
@@ -34,6 +34,9 @@ namespace TreeReader
       stream << L"  save-filters ''file name'': save all named filters to the given file." << endl;
       stream << L"  load-filters ''file name'': load named filters from the given file." << endl;
       stream << L"  list-filters: list all the named filters." << endl;
+      stream << L"  index: index the text of loaded trees in the background, to speed-up text searches." << endl;
+      stream << L"  no-index: do not index the text of loaded trees." << endl;
+      stream << L"  index-info: print the size of the text index of the loaded tree." << endl;
 
       return stream.str();
    }
@@ -81,6 +84,16 @@ namespace TreeReader
       return sstream.str();
    }
 
+   wstring CommandLine::DescribeTreeIndex() const
+   {
+      wostringstream sstream;
+      if (const auto index = GetTreeIndex())
+         sstream << L"Text index: " << index->CountTrigrams() << L" trigrams, " << (index->GetMemoryUsage() + 1023) / 1024 << L" KB." << endl;
+      else
+         sstream << L"Text index: not built." << endl;
+      return sstream.str();
+   }
+
    wstring CommandLine::ParseCommands(const wstring& cmdText)
    {
       return ParseCommands(split(cmdText));
@@ -190,6 +203,18 @@ namespace TreeReader
          {
             result += ListNamedFilters();
          }
+         else if (cmd == L"index")
+         {
+            Options.IndexTree = true;
+         }
+         else if (cmd == L"no-index")
+         {
+            Options.IndexTree = false;
+         }
+         else if (cmd == L"index-info")
+         {
+            result += DescribeTreeIndex();
+         }
          else
          {
             AppendFilterText(cmd);
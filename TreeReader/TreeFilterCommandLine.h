@@ -28,6 +28,10 @@ namespace TreeReader
 
       std::wstring ListNamedFilters();
 
+      // Text index information.
+
+      std::wstring DescribeTreeIndex() const;
+
       // Command parsing.
 
       std::wstring ParseCommands(const std::wstring& cmdText);
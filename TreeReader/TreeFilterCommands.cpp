@@ -1,6 +1,8 @@
 #include "TreeFilterCommands.h"
 #include "TreeFilterMaker.h"
+#include "TreeFilterOptimizer.h"
 #include "TreeReaderHelpers.h"
+#include "TaskScheduler.h"
 #include "SimpleTreeWriter.h"
 
 #include <sstream>
@@ -30,32 +32,192 @@ namespace TreeReader
       Options.OutputLineIndent = indentText;
    }
 
-   wstring CommandsContext::LoadTree(const filesystem::path& filename)
+   wstring CommandsContext::LoadTree(const filesystem::path& filename, OperationProgress* progress)
    {
+      // Note: filtering, loading or indexing the previous tree is now useless.
+      AbortAsyncFilter();
+      AbortAsyncLoad();
+      AbortTreeIndexing();
+
+      _treeFileName = filename;
+      auto newTree = make_shared<TextTree>(ReadSimpleTextTree(filesystem::path(_treeFileName), Options.ReadOptions, progress));
+      if (progress && progress->IsCancelled())
+         return L"Tree loading was cancelled.\n";
+
+      return UseLoadedTree(newTree);
+   }
+
+   void CommandsContext::LoadTreeAsync(const filesystem::path& filename)
+   {
+      AbortAsyncFilter();
+      AbortAsyncLoad();
+      AbortTreeIndexing();
+
       _treeFileName = filename;
-      auto newTree = make_shared<TextTree>(ReadSimpleTextTree(filesystem::path(_treeFileName), Options.ReadOptions));
-      if (newTree && newTree->Roots.size() > 0)
+
+      auto progress = make_shared<OperationProgress>();
+      auto partial = make_shared<PartialTree>();
+      _asyncLoading.Tree = TaskScheduler::GetShared().Submit([path = filesystem::path(_treeFileName), options = Options.ReadOptions, progress, partial]()
       {
-         _trees.emplace_back(move(newTree));
-         ApplySearchInTree();
+         return ReadSimpleTextTreeInParts(path, options, [&partial](const TextTree& partialTree)
+         {
+            auto tree = make_shared<TextTree>(partialTree);
+            lock_guard lock(partial->Mutex);
+            partial->Tree = move(tree);
+         }, progress.get());
+      }, TaskScheduler::Priority::Interactive);
+      _asyncLoading.Progress = move(progress);
+      _asyncLoading.Partial = move(partial);
+   }
+
+   void CommandsContext::AbortAsyncLoad()
+   {
+      if (_asyncLoading.Progress)
+         _asyncLoading.Progress->Cancel();
+   }
+
+   bool CommandsContext::IsAsyncLoadReady()
+   {
+      if (!_asyncLoading.Tree.valid())
+         return false;
+
+      if (_asyncLoading.Tree.wait_for(1us) != future_status::ready)
+         return false;
+
+      // Note: the tree read by an aborted loading is empty, so it is dropped.
+      const bool aborted = _asyncLoading.Progress->IsCancelled();
+      auto newTree = make_shared<TextTree>(_asyncLoading.Tree.get());
+      _asyncLoading = AsyncLoading();
+      if (aborted)
+         return false;
+
+      // Note: the previous tree may have been filtered while loading.
+      AbortAsyncFilter();
+      UseLoadedTree(newTree);
+
+      return true;
+   }
+
+   shared_ptr<TextTree> CommandsContext::GetPartiallyLoadedTree() const
+   {
+      if (!_asyncLoading.Partial)
          return {};
-      }
-      else
-      {
+
+      lock_guard lock(_asyncLoading.Partial->Mutex);
+      return _asyncLoading.Partial->Tree;
+   }
+
+   shared_ptr<const OperationProgress> CommandsContext::GetAsyncLoadProgress() const
+   {
+      return _asyncLoading.Progress;
+   }
+
+   wstring CommandsContext::UseLoadedTree(const shared_ptr<TextTree>& newTree)
+   {
+      if (!newTree || newTree->IsEmpty())
          return L"Tree file was invalid or empty.\n";
+
+      // Note: the index is built from a copy of the tree, which shares its nodes.
+      //       A cancelled index is not kept, since it is empty.
+      AbortTreeIndexing();
+      _treeIndex = {};
+      _treeIndexProgress = nullptr;
+      if (Options.IndexTree)
+      {
+         auto progress = make_shared<OperationProgress>();
+         _treeIndex = TaskScheduler::GetShared().Submit([tree = *newTree, progress]()
+         {
+            auto index = make_shared<const TextTreeIndex>(tree, 0, progress.get());
+            return progress->IsCancelled() ? shared_ptr<const TextTreeIndex>() : index;
+         }, TaskScheduler::Priority::Background).share();
+         _treeIndexProgress = move(progress);
       }
+
+      _trees.emplace_back(newTree);
+      ApplySearchInTree();
+      return {};
+   }
+
+   CommandsContext::ViewedTree::ViewedTree(const shared_ptr<TextTree>& loadedTree)
+   : Tree(loadedTree)
+   {
+      auto view = make_shared<FilteredView>(*loadedTree);
+      view->KeepAll();
+      View = move(view);
    }
 
-   void CommandsContext::SaveFilteredTree(const filesystem::path& filename)
+   const shared_ptr<TextTree>& CommandsContext::ViewedTree::GetTree() const
+   {
+      if (!Tree && View)
+         Tree = make_shared<TextTree>(View->CreateTree());
+      return Tree;
+   }
+
+   void CommandsContext::SaveFilteredTree(const filesystem::path& filename, OperationProgress* progress)
    {
       _filteredFileName = filename;
       if (_filtered)
       {
-         WriteSimpleTextTree(filesystem::path(_filteredFileName), *_filtered, Options.OutputLineIndent);
-         _filteredWasSaved = true;
+         WriteSimpleTextTree(filesystem::path(_filteredFileName), *_filtered.GetTree(), Options.OutputLineIndent, progress);
+         _filteredWasSaved = !(progress && progress->IsCancelled());
       }
    }
 
+   void CommandsContext::SaveFilteredTreeAsync(const filesystem::path& filename)
+   {
+      AbortAsyncSave();
+
+      _filteredFileName = filename;
+      if (!_filtered)
+         return;
+
+      // Note: the saving keeps the filtered tree, so filtering again does not change what is saved.
+      //       Its text tree is created by the saving task when it was not yet needed.
+      auto progress = make_shared<OperationProgress>();
+      _asyncSaving.Done = TaskScheduler::GetShared().Submit([path = filesystem::path(_filteredFileName), filtered = _filtered, indentation = Options.OutputLineIndent, progress]()
+      {
+         const shared_ptr<TextTree> tree = filtered.Tree ? filtered.Tree : make_shared<TextTree>(filtered.View->CreateTree());
+         WriteSimpleTextTree(path, *tree, indentation, progress.get());
+      }, TaskScheduler::Priority::Interactive);
+      _asyncSaving.Progress = move(progress);
+      _asyncSaving.View = _filtered.View;
+   }
+
+   void CommandsContext::AbortAsyncSave()
+   {
+      if (_asyncSaving.Progress)
+         _asyncSaving.Progress->Cancel();
+   }
+
+   bool CommandsContext::IsAsyncSaveReady()
+   {
+      if (!_asyncSaving.Done.valid())
+         return false;
+
+      if (_asyncSaving.Done.wait_for(1us) != future_status::ready)
+         return false;
+
+      const bool aborted = _asyncSaving.Progress->IsCancelled();
+      const shared_ptr<const FilteredView> saved = _asyncSaving.View;
+      auto done = move(_asyncSaving.Done);
+      _asyncSaving = AsyncSaving();
+
+      // Note: errors while writing are reported to the caller.
+      done.get();
+      if (aborted)
+         return false;
+
+      if (saved == _filtered.View)
+         _filteredWasSaved = true;
+
+      return true;
+   }
+
+   shared_ptr<const OperationProgress> CommandsContext::GetAsyncSaveProgress() const
+   {
+      return _asyncSaving.Progress;
+   }
+
    /////////////////////////////////////////////////////////////////////////
    //
    // Current filter.
@@ -73,13 +235,16 @@ namespace TreeReader
 
       if (_filter)
       {
-         _filtered = make_shared<TextTree>();
-         FilterTree(*_trees.back(), *_filtered, _filter);
+         // Note: the current filter is the one being edited, so it is left as-is.
+         auto filtered = make_shared<FilteredView>();
+         FilterTree(*_trees.back().View, *filtered, OptimizeFilter(_filter), GetTreeIndex());
+         _filtered = ViewedTree(move(filtered));
          _filteredWasSaved = false;
       }
       else
       {
-         _filtered = make_shared<TextTree>(*_trees.back());
+         // Note: the filtered tree shares the view and the text tree of the input tree.
+         _filtered = _trees.back();
          // Note: pure copy of input tree are considered to have been saved.
          _filteredWasSaved = true;
       }
@@ -94,13 +259,13 @@ namespace TreeReader
 
       AbortAsyncFilter();
 
-      _asyncFiltering = move(FilterTreeAsync(_trees.back(), _filter));
+      _asyncFiltering = move(FilterTreeAsync(_trees.back().View, OptimizeFilter(_filter), GetTreeIndex()));
    }
 
    void CommandsContext::AbortAsyncFilter()
    {
       if (_asyncFiltering.second)
-         _asyncFiltering.second->Abort = true;
+         _asyncFiltering.second->Cancel();
    }
 
    bool CommandsContext::IsAsyncFilterReady()
@@ -114,39 +279,58 @@ namespace TreeReader
       if (_asyncFiltering.first.wait_for(1us) != future_status::ready)
          return false;
 
-      _filtered = make_shared<TextTree>(_asyncFiltering.first.get());
-      _asyncFiltering = AsyncFilterTreeResult();
+      // Note: the tree filtered by an aborted filtering is incomplete, so it is dropped.
+      const bool aborted = _asyncFiltering.second->IsCancelled();
+      FilteredView filtered = _asyncFiltering.first.get();
+      _asyncFiltering = AsyncFilterViewResult();
+      if (aborted)
+         return false;
+
+      _filtered = ViewedTree(make_shared<const FilteredView>(move(filtered)));
 
       ApplySearchInTree();
 
       return true;
    }
 
-   void CommandsContext::SearchInTree(const std::wstring& text)
+   shared_ptr<const OperationProgress> CommandsContext::GetAsyncFilterProgress() const
+   {
+      return _asyncFiltering.second;
+   }
+
+   void CommandsContext::SearchInTree(const std::wstring& text, OperationProgress* progress)
    {
       if (_searchedText == text)
          return;
 
       _searchedText = text;
 
-      ApplySearchInTree();
+      ApplySearchInTree(progress);
    }
 
-   void CommandsContext::ApplySearchInTree()
+   void CommandsContext::ApplySearchInTree(OperationProgress* progress)
    {
       if (_searchedText.empty())
       {
-         _searched = nullptr;
+         _searched = ViewedTree();
          return;
       }
 
-      shared_ptr<TextTree> applyTo = _filtered ? _filtered : _trees.size() > 0 ? _trees.back() : shared_ptr<TextTree>();
+      const ViewedTree applyTo = _filtered ? _filtered : _trees.size() > 0 ? _trees.back() : ViewedTree();
 
       if (!applyTo)
          return;
 
-      _searched = make_shared<TextTree>();
-      FilterTree(*applyTo, *_searched, Contains(_searchedText));
+      auto searched = make_shared<FilteredView>();
+      FilterTree(*applyTo.View, *searched, Contains(_searchedText), GetTreeIndex(), 0, progress);
+      _searched = ViewedTree(move(searched));
+
+      // Note: an incomplete search is not kept, so searching the same text again redoes it.
+      if (progress && progress->IsCancelled())
+      {
+         _searched = ViewedTree();
+         _searchedText.clear();
+      }
    }
 
    /////////////////////////////////////////////////////////////////////////
@@ -248,12 +432,27 @@ namespace TreeReader
       if (_trees.size() <= 0)
          return {};
 
-      return _trees.back();
+      return _trees.back().GetTree();
+   }
+
+   shared_ptr<const TextTreeIndex> CommandsContext::GetTreeIndex() const
+   {
+      // Note: the index is only used once it is built, filtering does not wait for it.
+      if (!_treeIndex.valid() || _treeIndex.wait_for(0s) != future_status::ready)
+         return {};
+
+      return _treeIndex.get();
+   }
+
+   void CommandsContext::AbortTreeIndexing()
+   {
+      if (_treeIndexProgress)
+         _treeIndexProgress->Cancel();
    }
 
    shared_ptr<TextTree> CommandsContext::GetFilteredTree() const
    {
-      return _searched ? _searched : _filtered;
+      return _searched ? _searched.GetTree() : _filtered.GetTree();
    }
 
    void CommandsContext::PushFilteredAsTree()
@@ -261,6 +460,7 @@ namespace TreeReader
       if (_filtered)
       {
          _trees.emplace_back(move(_filtered));
+         _filtered = ViewedTree();
       }
    }
    
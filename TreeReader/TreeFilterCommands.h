@@ -1,7 +1,9 @@
 #pragma once
 
 #include "TextTree.h"
+#include "FilteredView.h"
 #include "TreeFilter.h"
+#include "TextTreeIndex.h"
 #include "SimpleTreeReader.h"
 #include "NamedFilters.h"
 #include "UndoStack.h"
@@ -9,6 +11,8 @@
 #include <memory>
 #include <string>
 #include <filesystem>
+#include <future>
+#include <mutex>
 
 namespace TreeReader
 {
@@ -18,6 +22,10 @@ namespace TreeReader
 
       ReadSimpleTextTreeOptions ReadOptions;
 
+      // Build the text index of loaded trees in the background, to speed-up text searches.
+      // Note: it does not change the resulting tree, so it is not compared.
+      bool IndexTree = true;
+
       bool operator!=(const CommandsOptions& other) const
       {
          return OutputLineIndent != other.OutputLineIndent
@@ -42,10 +50,41 @@ namespace TreeReader
       void SetInputIndent(const std::wstring& indentText);
       void SetOutputIndent(const std::wstring& indentText);
 
-      std::wstring LoadTree(const std::filesystem::path& filename);
-      void SaveFilteredTree(const std::filesystem::path& filename);
+      // The optional progress counts the bytes read or the nodes written.
+      // Cancelling it leaves the current tree as-is or the filtered tree unsaved.
+      std::wstring LoadTree(const std::filesystem::path& filename, OperationProgress* progress = nullptr);
+      void SaveFilteredTree(const std::filesystem::path& filename, OperationProgress* progress = nullptr);
       bool IsFilteredTreeSaved() const { return _filteredWasSaved; }
 
+      // Tree loading in the background.
+      //
+      // The part of the tree loaded so far can be shown while the rest is loading.
+      // Once the loading is ready, the loaded tree becomes the current tree, unless
+      // the file was invalid or empty. An aborted loading is never ready.
+
+      void LoadTreeAsync(const std::filesystem::path& filename);
+      void AbortAsyncLoad();
+      bool IsAsyncLoadReady();
+
+      // The tree loaded so far, null when there is none yet.
+      std::shared_ptr<TextTree> GetPartiallyLoadedTree() const;
+
+      // The progress of the loading in the background, null when there is none.
+      std::shared_ptr<const OperationProgress> GetAsyncLoadProgress() const;
+
+      // Filtered tree saving in the background.
+      //
+      // The filtered tree is saved as it was when the saving started. Once the
+      // saving is ready, that tree is considered saved, unless it was aborted,
+      // in which case the file is incomplete. An aborted saving is never ready.
+
+      void SaveFilteredTreeAsync(const std::filesystem::path& filename);
+      void AbortAsyncSave();
+      bool IsAsyncSaveReady();
+
+      // The progress of the saving in the background, null when there is none.
+      std::shared_ptr<const OperationProgress> GetAsyncSaveProgress() const;
+
       // Current filter.
 
       void SetFilter(const TreeFilterPtr& filter);
@@ -57,7 +96,13 @@ namespace TreeReader
       void ApplyFilterToTreeAsync();
       void AbortAsyncFilter();
       bool IsAsyncFilterReady();
-      void SearchInTree(const std::wstring& text);
+
+      // The progress of the asynchronous filtering, null when there is none.
+      std::shared_ptr<const OperationProgress> GetAsyncFilterProgress() const;
+
+      // The optional progress counts the nodes searched.
+      // Cancelling it leaves no searched tree.
+      void SearchInTree(const std::wstring& text, OperationProgress* progress = nullptr);
 
       // Named filters management.
 
@@ -70,8 +115,17 @@ namespace TreeReader
       void LoadNamedFilters(const std::filesystem::path& filename);
 
       // Current text tree and filtered tree.
+      //
+      // The filtered trees are kept as views of the loaded tree, so filtering them
+      // again can use the index of the loaded tree. Their text tree is only created
+      // when it is asked for, to be shown or saved.
 
       std::shared_ptr<TextTree> GetCurrentTree() const;
+      std::shared_ptr<const TextTreeIndex> GetTreeIndex() const;
+
+      // Stop building the text index of the current tree in the background.
+      // Filtering and searching then work without it.
+      void AbortTreeIndexing();
       std::shared_ptr<TextTree> GetFilteredTree() const;
       void PushFilteredAsTree();
       void PopTree();
@@ -85,20 +139,64 @@ namespace TreeReader
       void DeadedFilters(std::any& data);
       void AwakenFilters(const std::any& data);
       void CommitFilterToUndo();
-      void ApplySearchInTree();
+      void ApplySearchInTree(OperationProgress* progress = nullptr);
+      std::wstring UseLoadedTree(const std::shared_ptr<TextTree>& newTree);
+
+      // The part of the tree loaded so far, shared with the loading task.
+      struct PartialTree
+      {
+         std::mutex Mutex;
+         std::shared_ptr<TextTree> Tree;
+      };
+
+      struct AsyncLoading
+      {
+         std::future<TextTree> Tree;
+         std::shared_ptr<OperationProgress> Progress;
+         std::shared_ptr<PartialTree> Partial;
+      };
+
+      // A tree kept as a view of a loaded tree, and the text tree of its nodes,
+      // created when first needed.
+      struct ViewedTree
+      {
+         std::shared_ptr<const FilteredView> View;
+         mutable std::shared_ptr<TextTree> Tree;
+
+         ViewedTree() = default;
+         ViewedTree(const std::shared_ptr<const FilteredView>& view) : View(view) {}
+         ViewedTree(const std::shared_ptr<TextTree>& loadedTree);
+
+         explicit operator bool() const { return bool(View); }
+         bool operator==(const ViewedTree& other) const { return View == other.View; }
+         bool operator!=(const ViewedTree& other) const { return View != other.View; }
+
+         const std::shared_ptr<TextTree>& GetTree() const;
+      };
+
+      struct AsyncSaving
+      {
+         std::future<void> Done;
+         std::shared_ptr<OperationProgress> Progress;
+         std::shared_ptr<const FilteredView> View;
+      };
 
       std::wstring _treeFileName;
-      std::vector<std::shared_ptr<TextTree>> _trees;
+      std::vector<ViewedTree> _trees;
+      AsyncLoading _asyncLoading;
+      std::shared_future<std::shared_ptr<const TextTreeIndex>> _treeIndex;
+      std::shared_ptr<OperationProgress> _treeIndexProgress;
 
       TreeFilterPtr _filter;
 
       std::wstring _filteredFileName;
-      std::shared_ptr<TextTree> _filtered;
+      ViewedTree _filtered;
       bool _filteredWasSaved = false;
-      AsyncFilterTreeResult _asyncFiltering;
+      AsyncSaving _asyncSaving;
+      AsyncFilterViewResult _asyncFiltering;
 
       std::wstring _searchedText;
-      std::shared_ptr<TextTree> _searched;
+      ViewedTree _searched;
 
       std::shared_ptr<NamedFilters> _knownFilters = std::make_shared<NamedFilters>();
 
@@ -0,0 +1,475 @@
+#include "TreeFilterCompiler.h"
+#include "TreeReaderHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace TreeReader
+{
+   using namespace std;
+   using Result = TreeFilter::Result;
+
+   constexpr Result Keep { false, false, true };
+   constexpr Result Drop { false, false, false };
+   constexpr Result StopAndKeep { true, false, true };
+   constexpr Result StopAndDrop { true, false, false };
+   constexpr Result DropAndSkip { false, true, false };
+   constexpr Result KeepAndSkip { false, true, true };
+
+   CompiledTreeFilter::CompiledTreeFilter(const TreeFilterPtr& filter)
+   : Source(filter)
+   {
+      Compile(filter);
+   }
+
+   void CompiledTreeFilter::Compile(const TreeFilterPtr& filter)
+   {
+      const uint32_t index = uint32_t(_instructions.size());
+      _instructions.emplace_back();
+
+      // Note: the instruction is accessed by index since compiling
+      //       the sub-filters can move the instructions.
+      const auto set = [this, index](Operation op, bool flag = false, size_t value = 0, size_t otherValue = 0)
+      {
+         _instructions[index].Op = op;
+         _instructions[index].Flag = flag;
+         _instructions[index].Value = value;
+         _instructions[index].OtherValue = otherValue;
+      };
+
+      const auto addState = [this, index]()
+      {
+         _instructions[index].Index = uint32_t(_states.size());
+         _states.emplace_back();
+      };
+
+      // Note: the candidates are only found if all the texts can be looked up in the index.
+      const auto addCandidates = [this, index](vector<string> texts)
+      {
+         _instructions[index].Candidates = uint32_t(_candidateTexts.size());
+         _candidateTexts.emplace_back(move(texts));
+      };
+
+      // Note: a delegate without a sub-filter keeps all nodes, like accept.
+      const auto compileSubFilter = [this](const TreeFilterPtr& subFilter)
+      {
+         Compile(subFilter ? subFilter : make_shared<AcceptTreeFilter>());
+      };
+
+      if (!filter || dynamic_cast<const AcceptTreeFilter*>(filter.get()))
+      {
+         set(Operation::Accept);
+      }
+      else if (auto stop = dynamic_cast<const StopTreeFilter*>(filter.get()))
+      {
+         set(Operation::Stop, stop->Keep);
+         _canFilterRootsSeparately = false;
+      }
+      else if (auto until = dynamic_cast<const UntilTreeFilter*>(filter.get()))
+      {
+         set(Operation::Until);
+         _canFilterRootsSeparately = false;
+         compileSubFilter(until->Filter);
+      }
+      else if (auto contains = dynamic_cast<const ContainsTreeFilter*>(filter.get()))
+      {
+         set(Operation::Contains);
+         _instructions[index].Index = uint32_t(_searchers.size());
+         _searchers.emplace_back(ConvertToUtf8(contains->Contained));
+         addCandidates({ _searchers.back().GetSearched() });
+      }
+      else if (auto containsAny = dynamic_cast<const ContainsAnyTreeFilter*>(filter.get()))
+      {
+         set(Operation::ContainsAny);
+         _instructions[index].Index = uint32_t(_multiSearchers.size());
+         _multiSearchers.emplace_back(containsAny->GetContainedUtf8());
+         addCandidates(containsAny->GetContainedUtf8());
+      }
+      else if (auto address = dynamic_cast<const TextAddressTreeFilter*>(filter.get()))
+      {
+         set(Operation::TextAddress);
+         _instructions[index].Index = uint32_t(_addresses.size());
+         _addresses.emplace_back(address->ExactAddress);
+      }
+      else if (auto regex = dynamic_cast<const RegexTreeFilter*>(filter.get()))
+      {
+         // Note: the copy shares the compiled regex with the source filter.
+         set(Operation::Regex);
+         _instructions[index].Index = uint32_t(_regexes.size());
+         _regexes.emplace_back(regex->Regex);
+         addCandidates({ regex->Regex.GetRequiredText() });
+      }
+      else if (auto notFilter = dynamic_cast<const NotTreeFilter*>(filter.get()))
+      {
+         set(Operation::Not);
+         compileSubFilter(notFilter->Filter);
+      }
+      else if (auto combined = dynamic_cast<const CombineTreeFilter*>(filter.get()); combined && (dynamic_cast<const OrTreeFilter*>(combined) || dynamic_cast<const AndTreeFilter*>(combined)))
+      {
+         // Note: missing sub-filters are ignored by the combining filters.
+         set(dynamic_cast<const OrTreeFilter*>(combined) ? Operation::Or : Operation::And);
+         _instructions[index].Index = uint32_t(_combinations.size());
+         _combinations.emplace_back();
+
+         // Note: the sub-filters of the combination are added after those of
+         //       any nested combination, so they are contiguous.
+         vector<SubFilter> subFilters;
+         for (const auto& subFilter : combined->Filters)
+         {
+            if (!subFilter)
+               continue;
+
+            // Note: node predicates have no state and never stop nor skip children,
+            //       so they can be evaluated in any order.
+            SubFilter sub;
+            sub.Index = uint32_t(_instructions.size());
+            sub.CanMove = subFilter->IsNodePredicate();
+            subFilters.emplace_back(sub);
+            Compile(subFilter);
+         }
+
+         Combination& combination = _combinations[_instructions[index].Index];
+         combination.First = uint32_t(_subFilters.size());
+         combination.Count = uint32_t(subFilters.size());
+         _subFilters.insert(_subFilters.end(), subFilters.begin(), subFilters.end());
+      }
+      else if (auto under = dynamic_cast<const UnderTreeFilter*>(filter.get()))
+      {
+         set(Operation::Under, under->IncludeSelf);
+         addState();
+         compileSubFilter(under->Filter);
+      }
+      else if (auto countSiblings = dynamic_cast<const CountSiblingsTreeFilter*>(filter.get()))
+      {
+         set(Operation::CountSiblings, countSiblings->IncludeSelf, countSiblings->Count);
+         addState();
+         _canFilterRootsSeparately = false;
+         compileSubFilter(countSiblings->Filter);
+      }
+      else if (auto countChildren = dynamic_cast<const CountChildrenTreeFilter*>(filter.get()))
+      {
+         set(Operation::CountChildren, countChildren->IncludeSelf, countChildren->Count);
+         addState();
+         compileSubFilter(countChildren->Filter);
+      }
+      else if (auto noChild = dynamic_cast<const RemoveChildrenTreeFilter*>(filter.get()))
+      {
+         set(Operation::NoChild, noChild->IncludeSelf);
+         compileSubFilter(noChild->Filter);
+      }
+      else if (auto range = dynamic_cast<const LevelRangeTreeFilter*>(filter.get()))
+      {
+         set(Operation::LevelRange, false, range->MinLevel, range->MaxLevel);
+      }
+      else if (auto named = dynamic_cast<const NamedTreeFilter*>(filter.get()))
+      {
+         // Note: the instruction is replaced by the named filter itself.
+         _instructions.pop_back();
+         Compile(named->Filter);
+         return;
+      }
+      else
+      {
+         set(Operation::CallFilter);
+         _instructions[index].Index = uint32_t(_filters.size());
+         _filters.emplace_back(filter);
+         _canFilterViews = false;
+
+         // Note: only the filters that just look at the node, like if-sub of a
+         //       node predicate, are known not to depend on the other roots.
+         if (!filter->IsNodePredicate())
+            _canFilterRootsSeparately = false;
+      }
+
+      _instructions[index].End = uint32_t(_instructions.size());
+   }
+
+   Result CompiledTreeFilter::IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const
+   {
+      RunState& run = context.GetState<RunState>(*this, [&]() { return StartRun(tree, context); });
+      return Run(0, tree, node, level, run, context);
+   }
+
+   CompiledTreeFilter::RunState CompiledTreeFilter::StartRun(const TextTree& tree, TreeFilterContext& context) const
+   {
+      RunState run;
+      run.States = _states;
+      run.Combinations = _combinations;
+      run.SubFilters = _subFilters;
+      run.Regexes = _regexes;
+      run.Candidates = &context.GetSharedState<CandidateNodes>(*this, [&]() { return FindCandidates(tree, context.Index.get()); });
+      return run;
+   }
+
+   CompiledTreeFilter::CandidateNodes CompiledTreeFilter::FindCandidates(const TextTree& tree, const TextTreeIndex* index) const
+   {
+      CandidateNodes found(_candidateTexts.size());
+
+      // Note: the index is ignored when it is the index of another tree.
+      if (!index || !index->IsIndexOf(tree))
+         return found;
+
+      vector<NodeIndex> nodes;
+      for (size_t i = 0; i < _candidateTexts.size(); ++i)
+      {
+         const vector<string>& texts = _candidateTexts[i];
+
+         nodes.clear();
+         if (!all_of(texts.begin(), texts.end(), [index, &nodes](const string& text) { return index->FindCandidates(text, nodes); }))
+            continue;
+
+         vector<uint64_t>& candidates = found[i];
+         candidates.assign((tree.CountNodes() + 63) / 64, 0);
+         for (const NodeIndex node : nodes)
+            candidates[node / 64] |= uint64_t(1) << (node % 64);
+      }
+
+      return found;
+   }
+
+   bool CompiledTreeFilter::IsCandidate(const Instruction& instruction, NodeIndex node, const RunState& run)
+   {
+      if (instruction.Candidates == NoCandidates)
+         return true;
+
+      const vector<uint64_t>& candidates = (*run.Candidates)[instruction.Candidates];
+      return candidates.empty() || ((candidates[node / 64] >> (node % 64)) & 1);
+   }
+
+   Result CompiledTreeFilter::Run(uint32_t index, const TextTree& tree, NodeIndex node, size_t level, RunState& run, TreeFilterContext& context) const
+   {
+      const Instruction& instruction = _instructions[index];
+      const uint32_t subIndex = index + 1;
+
+      switch (instruction.Op)
+      {
+         default:
+         case Operation::Accept:
+            return Keep;
+
+         case Operation::Stop:
+            return instruction.Flag ? StopAndKeep : StopAndDrop;
+
+         case Operation::Until:
+            return Run(subIndex, tree, node, level, run, context).Keep ? StopAndDrop : Drop;
+
+         case Operation::Contains:
+            if (!IsCandidate(instruction, node, run))
+               return Drop;
+            return _searchers[instruction.Index].IsFoundIn(tree.GetText(node)) ? Keep : Drop;
+
+         case Operation::ContainsAny:
+            if (!IsCandidate(instruction, node, run))
+               return Drop;
+            return _multiSearchers[instruction.Index].IsAnyFoundIn(tree.GetText(node)) ? Keep : Drop;
+
+         case Operation::TextAddress:
+            return (_addresses[instruction.Index] == tree.GetText(node).data()) ? Keep : Drop;
+
+         case Operation::Regex:
+            if (!IsCandidate(instruction, node, run))
+               return Drop;
+            return run.Regexes[instruction.Index].IsFoundIn(tree.GetText(node)) ? Keep : Drop;
+
+         case Operation::Not:
+         {
+            Result result = Run(subIndex, tree, node, level, run, context);
+            result.Keep = !result.Keep;
+            return result;
+         }
+
+         case Operation::Or:
+         case Operation::And:
+            return RunCombination(instruction, tree, node, level, run, context);
+
+         case Operation::Under:
+         {
+            // See UnderTreeFilter for an explanation of how the state is used.
+            State& state = run.States[instruction.Index];
+            if (level > state.Level)
+               return Keep;
+
+            state.Level = size_t(-1);
+
+            Result result = Run(subIndex, tree, node, level, run, context);
+            if (!result.Keep)
+               return result;
+
+            state.Level = level;
+            if (!instruction.Flag)
+               result.Keep = false;
+            return result;
+         }
+
+         case Operation::CountSiblings:
+         {
+            // See CountSiblingsTreeFilter for an explanation of how the state is used.
+            State& state = run.States[instruction.Index];
+            if (level < state.Level)
+            {
+               state.Level = size_t(-1);
+               state.Countdown = 0;
+            }
+
+            if (state.Countdown > 0 && level == state.Level)
+            {
+               --state.Countdown;
+               return Keep;
+            }
+
+            Result result = Run(subIndex, tree, node, level, run, context);
+            if (!result.Keep)
+               return result;
+
+            state.Level = level;
+            state.Countdown = instruction.Value;
+            if (!instruction.Flag)
+               result.Keep = false;
+            return result;
+         }
+
+         case Operation::CountChildren:
+         {
+            // See CountChildrenTreeFilter for an explanation of how the state is used.
+            State& state = run.States[instruction.Index];
+            if (level <= state.Level)
+            {
+               state.Level = size_t(-1);
+               state.Countdown = 0;
+            }
+
+            if (state.Countdown > 0 && level > state.Level)
+            {
+               --state.Countdown;
+               return Keep;
+            }
+
+            Result result = Run(subIndex, tree, node, level, run, context);
+            if (!result.Keep)
+               return result;
+
+            state.Level = level;
+            state.Countdown = instruction.Value;
+            if (!instruction.Flag)
+               result.Keep = false;
+            return result;
+         }
+
+         case Operation::NoChild:
+            if (!Run(subIndex, tree, node, level, run, context).Keep)
+               return Keep;
+            return instruction.Flag ? DropAndSkip : KeepAndSkip;
+
+         case Operation::LevelRange:
+            if (level < instruction.Value)
+               return Drop;
+            if (level <= instruction.OtherValue)
+               return Keep;
+            return DropAndSkip;
+
+         case Operation::CallFilter:
+            return _filters[instruction.Index]->IsKept(tree, node, level, context);
+      }
+   }
+
+   Result CompiledTreeFilter::RunCombination(const Instruction& instruction, const TextTree& tree, NodeIndex node, size_t level, RunState& run, TreeFilterContext& context) const
+   {
+      // An and is decided by the first sub-filter that does not keep the node,
+      // an or by the first one that keeps it.
+      const bool isAnd = (instruction.Op == Operation::And);
+
+      Combination& combination = run.Combinations[instruction.Index];
+      const bool timed = (combination.Evaluations % TimedEvaluationsPeriod) == 0;
+
+      Result result = isAnd ? Keep : Drop;
+      for (uint32_t pos = combination.First; pos < combination.First + combination.Count; ++pos)
+      {
+         SubFilter& sub = run.SubFilters[pos];
+         const auto start = timed ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+         const Result subResult = Run(sub.Index, tree, node, level, run, context);
+
+         sub.Evaluations += 1;
+         if (timed)
+         {
+            sub.TimedEvaluations += 1;
+            sub.TimedNanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+         }
+
+         result = isAnd ? (result & subResult) : (result | subResult);
+         if (result.Keep != isAnd)
+         {
+            sub.DecidedResults += 1;
+            break;
+         }
+      }
+
+      if (++combination.Evaluations % ReorderPeriod == 0)
+         Reorder(combination, run.SubFilters);
+
+      return result;
+   }
+
+   void CompiledTreeFilter::Reorder(const Combination& combination, vector<SubFilter>& subFilters)
+   {
+      // The best order runs first the sub-filters with the lowest cost for each decided result.
+      // Note: the counts start at one so that sub-filters that never decide are not infinitely costly.
+      const auto rank = [](const SubFilter& sub)
+      {
+         if (sub.TimedEvaluations == 0)
+            return numeric_limits<double>::max();
+
+         const double cost = double(sub.TimedNanoseconds) / double(sub.TimedEvaluations);
+         return cost * double(sub.Evaluations + 1) / double(sub.DecidedResults + 1);
+      };
+
+      // Only reorder within each run of sub-filters that can move.
+      const auto begin = subFilters.begin() + combination.First;
+      const auto end = begin + combination.Count;
+      for (auto pos = begin; pos != end; )
+      {
+         if (!pos->CanMove)
+         {
+            ++pos;
+            continue;
+         }
+
+         const auto runEnd = find_if(pos, end, [](const SubFilter& sub) { return !sub.CanMove; });
+         stable_sort(pos, runEnd, [&rank](const SubFilter& lhs, const SubFilter& rhs) { return rank(lhs) < rank(rhs); });
+         pos = runEnd;
+      }
+   }
+
+   bool CompiledTreeFilter::IsNodePredicate() const
+   {
+      return !Source || Source->IsNodePredicate();
+   }
+
+   wstring CompiledTreeFilter::GetName() const
+   {
+      return Source ? Source->GetName() : GetShortName();
+   }
+
+   wstring CompiledTreeFilter::GetShortName() const
+   {
+      return Source ? Source->GetShortName() : L"Accept";
+   }
+
+   wstring CompiledTreeFilter::GetDescription() const
+   {
+      return Source ? Source->GetDescription() : wstring();
+   }
+
+   TreeFilterPtr CompiledTreeFilter::Clone() const
+   {
+      return make_shared<CompiledTreeFilter>(Source ? Source->Clone() : TreeFilterPtr());
+   }
+
+   shared_ptr<CompiledTreeFilter> CompileFilter(const TreeFilterPtr& filter)
+   {
+      if (auto compiled = dynamic_pointer_cast<CompiledTreeFilter>(filter))
+         return compiled;
+
+      return make_shared<CompiledTreeFilter>(filter);
+   }
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "TreeFilter.h"
+#include "TextTreeIndex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TreeReader
+{
+   // A tree of filters compiled to a flat program.
+   //
+   // The filters are kept in a single array of instructions, each followed by
+   // the instructions of its sub-filters. Named filters are inlined and the
+   // filters that remember what they have seen, like under or count filters,
+   // get a state slot in the program. Running the program needs no virtual
+   // call nor any pointer indirection through the tree of filters.
+   //
+   // Filters that cannot be compiled, like if-sub or if-sib, are called as-is.
+   //
+   // The sub-filters of and / or are evaluated in the order that is the cheapest:
+   // the program measures the cost of each sub-filter and how often it decides
+   // the result, and runs first the cheap ones that often decide. Only the
+   // sub-filters that only look at the node itself are moved, and never past
+   // the other sub-filters, so the results do not change.
+   //
+   // When the context has the index of the filtered tree, the text searches first
+   // look up which nodes may contain their text, and only search those nodes.
+   //
+   // The program is never modified once compiled: what it remembers and measures
+   // while filtering is kept in the context, so each filtering measures and
+   // reorders the sub-filters on its own.
+   //
+   // The tree of filters stays the editing model. The compiled program is only
+   // used to filter a tree.
+
+   struct CompiledTreeFilter : TreeFilter
+   {
+      // The filter that was compiled.
+      TreeFilterPtr Source;
+
+      CompiledTreeFilter() = default;
+      CompiledTreeFilter(const TreeFilterPtr& filter);
+
+      Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override;
+      bool IsNodePredicate() const override;
+      std::wstring GetName() const override;
+      std::wstring GetShortName() const override;
+      std::wstring GetDescription() const override;
+      TreeFilterPtr Clone() const override;
+
+      // The number of instructions in the program.
+      size_t CountInstructions() const { return _instructions.size(); }
+
+      // Verify if each root of a tree, with its descendants, can be filtered separately.
+      //
+      // That is the case when the filters never stop the filtering nor count siblings,
+      // since the other filters forget what they remember when they reach a root.
+      bool CanFilterRootsSeparately() const { return _canFilterRootsSeparately; }
+
+      // Verify if the filters only look at the visited nodes and their level,
+      // so that they can filter the kept nodes of a filtered view as-is.
+      //
+      // That is not the case of the filters called as-is, like if-sub or if-sib,
+      // which look at the nodes around the node in the tree.
+      bool CanFilterViews() const { return _canFilterViews; }
+
+      // How often the sub-filters of and / or are timed and reordered, in number of evaluations.
+      static constexpr size_t TimedEvaluationsPeriod = 16;
+      static constexpr size_t ReorderPeriod = 1024;
+
+   private:
+      enum class Operation : std::uint8_t
+      {
+         Accept, Stop, Until, Contains, ContainsAny, TextAddress, Regex,
+         Not, Or, And, Under, CountSiblings, CountChildren, NoChild, LevelRange,
+         CallFilter,
+      };
+
+      // An instruction of the program.
+      //
+      // The sub-filters of an instruction follow it and end where the instruction ends.
+      // The index refers to the searcher, address, regex, filter, state or combination used,
+      // depending on the operation. The values are the count or the level range.
+      // Text searches can also have candidate nodes.
+      struct Instruction
+      {
+         Operation Op = Operation::Accept;
+         bool Flag = false;
+         std::uint32_t End = 0;
+         std::uint32_t Index = 0;
+         std::uint32_t Candidates = NoCandidates;
+         size_t Value = 0;
+         size_t OtherValue = 0;
+      };
+
+      // A sub-filter of and / or, with the measurements used to order them.
+      struct SubFilter
+      {
+         std::uint32_t Index = 0;
+         bool CanMove = false;
+         size_t Evaluations = 0;
+         size_t DecidedResults = 0;
+         size_t TimedEvaluations = 0;
+         std::uint64_t TimedNanoseconds = 0;
+      };
+
+      // The sub-filters of an and / or, in the order they are evaluated.
+      struct Combination
+      {
+         std::uint32_t First = 0;
+         std::uint32_t Count = 0;
+         size_t Evaluations = 0;
+      };
+
+      static constexpr std::uint32_t NoCandidates = std::uint32_t(-1);
+
+      // The state of the filters that remember what they have seen.
+      struct State
+      {
+         size_t Level = size_t(-1);
+         size_t Countdown = 0;
+      };
+
+      // The candidates are, for the texts searched by each instruction, the nodes
+      // that may contain them, one bit per node, or nothing if the tree is not indexed.
+      // They are found once and shared by all the threads filtering the tree.
+      using CandidateNodes = std::vector<std::vector<std::uint64_t>>;
+
+      // What the program remembers while filtering a tree, kept in the context.
+      //
+      // The regexes are copies, since matching modifies them.
+      struct RunState
+      {
+         std::vector<State> States;
+         std::vector<Combination> Combinations;
+         std::vector<SubFilter> SubFilters;
+         std::vector<TextRegex> Regexes;
+         const CandidateNodes* Candidates = nullptr;
+      };
+
+      // Compile the filter, and its sub-filters, at the end of the program.
+      void Compile(const TreeFilterPtr& filter);
+
+      // Start filtering the tree, with the initial state of the program.
+      RunState StartRun(const TextTree& tree, TreeFilterContext& context) const;
+
+      // Run the instruction at the given index.
+      Result Run(std::uint32_t index, const TextTree& tree, NodeIndex node, size_t level, RunState& run, TreeFilterContext& context) const;
+      Result RunCombination(const Instruction& instruction, const TextTree& tree, NodeIndex node, size_t level, RunState& run, TreeFilterContext& context) const;
+
+      // Reorder the sub-filters of an and / or, based on their measurements.
+      static void Reorder(const Combination& combination, std::vector<SubFilter>& subFilters);
+
+      // Find the candidate nodes of the text searches in the tree, if it is indexed.
+      CandidateNodes FindCandidates(const TextTree& tree, const TextTreeIndex* index) const;
+      static bool IsCandidate(const Instruction& instruction, NodeIndex node, const RunState& run);
+
+      std::vector<Instruction> _instructions;
+      std::vector<State> _states;
+      std::vector<Combination> _combinations;
+      std::vector<SubFilter> _subFilters;
+      std::vector<TextSearcher> _searchers;
+      std::vector<MultiTextSearcher> _multiSearchers;
+      std::vector<const char*> _addresses;
+      std::vector<TextRegex> _regexes;
+      std::vector<TreeFilterPtr> _filters;
+
+      // The texts searched by the instructions that can have candidates.
+      std::vector<std::vector<std::string>> _candidateTexts;
+
+      bool _canFilterRootsSeparately = true;
+      bool _canFilterViews = true;
+   };
+
+   // Compile the filter, unless it is already compiled.
+
+   std::shared_ptr<CompiledTreeFilter> CompileFilter(const TreeFilterPtr& filter);
+}
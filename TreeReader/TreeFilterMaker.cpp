@@ -39,6 +39,13 @@ namespace TreeReader
          return sstream.str();
       }
 
+      wstring ConvertFilterToText(const ContainsAnyTreeFilter& filter, size_t indent)
+      {
+         wostringstream sstream;
+         sstream << L"contains-any [ " << quoted(filter.Contained) << L" ]";
+         return sstream.str();
+      }
+
       wstring ConvertFilterToText(const RegexTreeFilter& filter, size_t indent)
       {
          wostringstream sstream;
@@ -155,6 +162,7 @@ namespace TreeReader
          CALL_CONVERTER(StopTreeFilter)
          CALL_CONVERTER(UntilTreeFilter)
          CALL_CONVERTER(ContainsTreeFilter)
+         CALL_CONVERTER(ContainsAnyTreeFilter)
          CALL_CONVERTER(RegexTreeFilter)
          CALL_CONVERTER(NotTreeFilter)
          CALL_CONVERTER(IfSubTreeTreeFilter)
@@ -235,6 +243,17 @@ namespace TreeReader
          return Contains(contained);
       }
 
+      template <>
+      TreeFilterPtr ConvertTextToFilter<ContainsAnyTreeFilter>(wistringstream& sstream)
+      {
+         wstring contained;
+         sstream >> skipws >> quoted(contained);
+
+         EatClosingBrace(sstream);
+
+         return ContainsAny(contained);
+      }
+
       template <>
       TreeFilterPtr ConvertTextToFilter<RegexTreeFilter>(wistringstream& sstream)
       {
@@ -414,6 +433,7 @@ namespace TreeReader
 
          CALL_CONVERTER(L"accept", AcceptTreeFilter)
          CALL_CONVERTER(L"contains", ContainsTreeFilter)
+         CALL_CONVERTER(L"contains-any", ContainsAnyTreeFilter)
          CALL_CONVERTER(L"regex", RegexTreeFilter)
          CALL_CONVERTER(L"not", NotTreeFilter)
          CALL_CONVERTER(L"if-sub", IfSubTreeTreeFilter)
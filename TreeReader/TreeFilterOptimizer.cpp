@@ -0,0 +1,160 @@
+#include "TreeFilterOptimizer.h"
+
+namespace TreeReader
+{
+   using namespace std;
+
+   namespace
+   {
+      bool IsAccept(const TreeFilterPtr& filter)
+      {
+         return dynamic_cast<const AcceptTreeFilter*>(filter.get()) != nullptr;
+      }
+
+      // Note: a not without sub-filter negates keeping all nodes.
+      bool IsNeverKept(const TreeFilterPtr& filter)
+      {
+         const auto notFilter = dynamic_cast<const NotTreeFilter*>(filter.get());
+         return notFilter && (!notFilter->Filter || IsAccept(notFilter->Filter));
+      }
+
+      // The texts searched by a contains or contains-any, separated as in contains-any.
+      // Note: a contains with the separator in its text would be split, so it has none.
+      const wstring* GetContainedTexts(const TreeFilterPtr& filter)
+      {
+         if (const auto contains = dynamic_cast<const ContainsTreeFilter*>(filter.get()))
+            return contains->Contained.find(ContainsAnyTreeFilter::Separator) == wstring::npos ? &contains->Contained : nullptr;
+
+         if (const auto containsAny = dynamic_cast<const ContainsAnyTreeFilter*>(filter.get()))
+            return &containsAny->Contained;
+
+         return nullptr;
+      }
+
+      // Replace the contains that follow each other in an or by a single contains-any.
+      // Note: the contains can be searched in any order since they have no state and
+      //       never stop nor skip children.
+      vector<TreeFilterPtr> CombineContains(const vector<TreeFilterPtr>& filters)
+      {
+         vector<TreeFilterPtr> combined;
+         vector<wstring> contained;
+
+         const auto addContains = [&]()
+         {
+            if (contained.size() > 1)
+            {
+               combined.pop_back();
+               combined.emplace_back(ContainsAny(contained));
+            }
+            contained.clear();
+         };
+
+         for (const auto& filter : filters)
+         {
+            if (const wstring* texts = GetContainedTexts(filter))
+            {
+               // Note: the first filter of a run is kept until the run has more than one.
+               if (contained.empty())
+                  combined.emplace_back(filter);
+               contained.emplace_back(*texts);
+            }
+            else
+            {
+               addContains();
+               combined.emplace_back(filter);
+            }
+         }
+         addContains();
+
+         return combined;
+      }
+
+      TreeFilterPtr OptimizeCombined(const TreeFilterPtr& filter, const CombineTreeFilter& combined)
+      {
+         const bool isAnd = dynamic_cast<const AndTreeFilter*>(&combined) != nullptr;
+
+         // An and stops at the first sub-filter that does not keep the node and an or
+         // stops at the first one that keeps it, so the sub-filters that always do that
+         // make the following sub-filters unreachable. The sub-filters that always do
+         // the opposite have no effect on the result.
+         const auto stopsEvaluation = isAnd ? IsNeverKept : IsAccept;
+         const auto hasNoEffect = isAnd ? IsAccept : IsNeverKept;
+
+         vector<TreeFilterPtr> filters;
+         bool stopped = false;
+
+         const function<void(const TreeFilterPtr&)> addFilter = [&](const TreeFilterPtr& optimized)
+         {
+            if (stopped)
+               return;
+
+            // Note: the nested combiner is already optimized, so it is already flattened.
+            const auto nested = dynamic_cast<const CombineTreeFilter*>(optimized.get());
+            if (nested && (dynamic_cast<const AndTreeFilter*>(nested) != nullptr) == isAnd)
+            {
+               for (const auto& sub : nested->Filters)
+                  addFilter(sub);
+               return;
+            }
+
+            if (hasNoEffect(optimized))
+               return;
+
+            filters.emplace_back(optimized);
+            stopped = stopsEvaluation(optimized);
+         };
+
+         for (const auto& sub : combined.Filters)
+            if (sub)
+               addFilter(OptimizeFilter(sub));
+
+         if (!isAnd)
+            filters = CombineContains(filters);
+
+         if (filters.empty())
+            return isAnd ? TreeFilterPtr(Accept()) : TreeFilterPtr(Not(Accept()));
+
+         if (filters.size() == 1)
+            return filters[0];
+
+         if (filters == combined.Filters)
+            return filter;
+
+         return isAnd ? TreeFilterPtr(All(filters)) : TreeFilterPtr(Any(filters));
+      }
+   }
+
+   TreeFilterPtr OptimizeFilter(const TreeFilterPtr& filter)
+   {
+      if (!filter)
+         return filter;
+
+      if (auto named = dynamic_cast<const NamedTreeFilter*>(filter.get()))
+      {
+         // Note: a named filter without definition keeps all nodes.
+         return named->Filter ? OptimizeFilter(named->Filter) : Accept();
+      }
+
+      if (auto combined = dynamic_cast<const CombineTreeFilter*>(filter.get()))
+         return OptimizeCombined(filter, *combined);
+
+      if (auto delegate = dynamic_cast<const DelegateTreeFilter*>(filter.get()))
+      {
+         TreeFilterPtr sub = OptimizeFilter(delegate->Filter);
+
+         // Note: the sub-filter is already optimized, so its own sub-filter is too.
+         if (dynamic_cast<const NotTreeFilter*>(delegate))
+            if (auto subNot = dynamic_cast<const NotTreeFilter*>(sub.get()))
+               return subNot->Filter ? subNot->Filter : Accept();
+
+         if (sub == delegate->Filter)
+            return filter;
+
+         auto copy = filter->Clone();
+         dynamic_pointer_cast<DelegateTreeFilter>(copy)->Filter = sub;
+         return copy;
+      }
+
+      return filter;
+   }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TreeFilter.h"
+
+namespace TreeReader
+{
+   // Simplify a tree of filters before filtering a tree.
+   //
+   // The simplified filter keeps exactly the same nodes and gives the same
+   // stop and skip-children results as the original filter:
+   //
+   //    - named filters are replaced by the filter they name,
+   //    - double negations are removed,
+   //    - and / or nested in the same kind of combiner are flattened,
+   //    - accept in an and, or never-keep in an or, is removed,
+   //    - the sub-filters that can never be reached are removed,
+   //    - contains that follow each other in an or are searched at once,
+   //    - and / or with a single sub-filter are replaced by that sub-filter.
+   //
+   // The original filter is not modified. Filters that are not simplified
+   // are shared with the original filter, so they keep their cached data.
+
+   TreeFilterPtr OptimizeFilter(const TreeFilterPtr& filter);
+}
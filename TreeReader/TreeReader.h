@@ -1,12 +1,22 @@
 #pragma once
 
 #include "TextTree.h"
+#include "TextTreeIndex.h"
+#include "TextSearcher.h"
+#include "TextRegex.h"
 #include "TextTreeVisitor.h"
+#include "FilteredView.h"
 #include "BuffersTextHolder.h"
 #include "TextLinesTextHolder.h"
+#include "MappedFileTextHolder.h"
+#include "LineScanner.h"
 #include "TreeFilter.h"
+#include "TreeFilterCompiler.h"
+#include "TreeFilterOptimizer.h"
 #include "TreeFilterMaker.h"
 #include "TreeFilterCommands.h"
 #include "TreeFilterCommandLine.h"
 #include "SimpleTreeReader.h"
 #include "TreeReaderHelpers.h"
+#include "TaskScheduler.h"
+#include "OperationProgress.h"
@@ -1,6 +1,10 @@
 #include "TreeReaderHelpers.h"
+#include "TaskScheduler.h"
 
+#include <algorithm>
+#include <future>
 #include <sstream>
+#include <thread>
 
 namespace TreeReader
 {
@@ -36,4 +40,123 @@ namespace TreeReader
 
       return result;
    }
+
+   size_t CountParallelChunks(size_t size, size_t minChunkSize, size_t threadCount)
+   {
+      if (threadCount)
+         return threadCount;
+
+      return max(size_t(1), min(size_t(thread::hardware_concurrency()), size / max(size_t(1), minChunkSize)));
+   }
+
+   void RunInParallel(size_t chunkCount, const function<void(size_t)>& func)
+   {
+      TaskScheduler::GetShared().RunInParallel(chunkCount, func);
+   }
+
+   char* ConvertToUtf8(const wchar_t* begin, const wchar_t* end, char* dest)
+   {
+      while (begin != end)
+      {
+         char32_t c = char32_t(*begin++);
+
+         // Combine UTF-16 surrogate pairs when wide characters are 16-bits.
+         if constexpr (sizeof(wchar_t) == 2)
+         {
+            if (c >= 0xD800 && c < 0xDC00 && begin != end && *begin >= 0xDC00 && *begin < 0xE000)
+               c = 0x10000 + ((c - 0xD800) << 10) + (char32_t(*begin++) - 0xDC00);
+         }
+
+         if (c < 0x80)
+         {
+            *dest++ = char(c);
+         }
+         else if (c < 0x800)
+         {
+            *dest++ = char(0xC0 | (c >> 6));
+            *dest++ = char(0x80 | (c & 0x3F));
+         }
+         else if (c < 0x10000)
+         {
+            *dest++ = char(0xE0 | (c >> 12));
+            *dest++ = char(0x80 | ((c >> 6) & 0x3F));
+            *dest++ = char(0x80 | (c & 0x3F));
+         }
+         else
+         {
+            *dest++ = char(0xF0 | (c >> 18));
+            *dest++ = char(0x80 | ((c >> 12) & 0x3F));
+            *dest++ = char(0x80 | ((c >> 6) & 0x3F));
+            *dest++ = char(0x80 | (c & 0x3F));
+         }
+      }
+
+      return dest;
+   }
+
+   string ConvertToUtf8(const wstring& text)
+   {
+      string result(text.size() * MaxUtf8PerWideChar, 0);
+      char* end = ConvertToUtf8(text.data(), text.data() + text.size(), result.data());
+      result.resize(end - result.data());
+      return result;
+   }
+
+   wstring ConvertFromUtf8(const char* text, size_t count)
+   {
+      wstring result;
+      result.reserve(count);
+
+      const unsigned char* pos = reinterpret_cast<const unsigned char*>(text);
+      const unsigned char* end = pos + count;
+      while (pos != end)
+      {
+         const unsigned char c = *pos;
+
+         // Determine the length of the UTF-8 sequence and the bits of the first byte.
+         size_t length = 1;
+         char32_t codePoint = c;
+         if (c >= 0xC2 && c < 0xE0)
+            length = 2, codePoint = c & 0x1F;
+         else if (c >= 0xE0 && c < 0xF0)
+            length = 3, codePoint = c & 0x0F;
+         else if (c >= 0xF0 && c < 0xF5)
+            length = 4, codePoint = c & 0x07;
+
+         // Verify the continuation bytes, otherwise treat the first byte as Latin-1.
+         bool valid = (length <= size_t(end - pos));
+         for (size_t i = 1; valid && i < length; ++i)
+         {
+            valid = ((pos[i] & 0xC0) == 0x80);
+            codePoint = (codePoint << 6) | (pos[i] & 0x3F);
+         }
+
+         if (!valid || (length == 3 && codePoint < 0x800) || (length == 4 && (codePoint < 0x10000 || codePoint > 0x10FFFF)))
+         {
+            length = 1;
+            codePoint = c;
+         }
+
+         pos += length;
+
+         // Split into UTF-16 surrogate pairs when wide characters are 16-bits.
+         if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+         {
+            codePoint -= 0x10000;
+            result += wchar_t(0xD800 + (codePoint >> 10));
+            result += wchar_t(0xDC00 + (codePoint & 0x3FF));
+         }
+         else
+         {
+            result += wchar_t(codePoint);
+         }
+      }
+
+      return result;
+   }
+
+   wstring ConvertFromUtf8(const string& text)
+   {
+      return ConvertFromUtf8(text.data(), text.size());
+   }
 }
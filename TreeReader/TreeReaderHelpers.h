@@ -1,3 +1,6 @@
+#pragma once
+
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -10,4 +13,30 @@ namespace TreeReader
 
    std::vector<std::wstring> split(const std::wstring& text, wchar_t delimiter = L' ', SplitOptions options = SplitOptions::RemoveEmpty);
    std::wstring join(const std::vector<std::wstring>& parts, wchar_t delimiter = L' ');
+
+   // Conversion between wide text and UTF-8 text.
+   //
+   // Bytes that are not valid UTF-8 are converted as if they were Latin-1 characters,
+   // so that text files that are not UTF-8 can still be read.
+
+   std::string ConvertToUtf8(const std::wstring& text);
+   std::wstring ConvertFromUtf8(const char* text, size_t count);
+   std::wstring ConvertFromUtf8(const std::string& text);
+
+   // Convert wide text to UTF-8 into a buffer that must be large enough.
+   // Returns the end of the converted text.
+
+   constexpr size_t MaxUtf8PerWideChar = 4;
+   char* ConvertToUtf8(const wchar_t* begin, const wchar_t* end, char* dest);
+
+   // Choose in how many chunks to split work of the given size, using one chunk per core
+   // as long as each chunk is at least the given minimum size.
+   // When the thread count is not zero, it is used as-is.
+
+   size_t CountParallelChunks(size_t size, size_t minChunkSize, size_t threadCount = 0);
+
+   // Call the function with the index of each chunk, on the threads of the shared task scheduler.
+   // The calling thread also processes chunks. Returns when all chunks are done.
+
+   void RunInParallel(size_t chunkCount, const std::function<void(size_t)>& func);
 }
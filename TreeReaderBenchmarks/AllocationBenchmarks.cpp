@@ -0,0 +1,111 @@
+#include "BenchmarkHelpers.h"
+#include "SimpleTreeReader.h"
+#include "TreeFilter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace
+{
+   // Count all allocations and deallocations made through the global operators.
+   // Note: the array and non-throwing forms call these ones.
+
+   std::atomic<size_t> allocationCount = 0;
+   std::atomic<size_t> allocatedBytes = 0;
+   std::atomic<size_t> deallocationCount = 0;
+}
+
+void* operator new(size_t size)
+{
+   allocationCount += 1;
+   allocatedBytes += size;
+
+   if (void* ptr = std::malloc(size ? size : 1))
+      return ptr;
+
+   throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+   if (ptr)
+      deallocationCount += 1;
+   std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+   operator delete(ptr);
+}
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   namespace
+   {
+      // Run the function once and print how many allocations and deallocations it made.
+
+      void PrintAllocations(const wstring& name, const function<void()>& func)
+      {
+         const size_t countBefore = allocationCount;
+         const size_t bytesBefore = allocatedBytes;
+         const size_t freedBefore = deallocationCount;
+
+         func();
+
+         const size_t count = allocationCount - countBefore;
+         const size_t megabytes = (allocatedBytes - bytesBefore) / (1024 * 1024);
+         const size_t freed = deallocationCount - freedBefore;
+         wcout << left << setw(40) << name << right
+               << setw(10) << count << L" allocations"
+               << setw(8) << megabytes << L" MB"
+               << setw(10) << freed << L" deallocations" << endl;
+      }
+   }
+
+   void RunAllocationBenchmarks()
+   {
+      const string text = CreateTreeText(32 * 1024 * 1024);
+
+      const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-benchmark-allocations.txt";
+      {
+         ofstream stream(path, ios::binary);
+         stream << text;
+      }
+
+      wcout << L"Allocations, " << text.size() / (1024 * 1024) << L" MB of text" << endl;
+
+      auto tree = make_shared<TextTree>();
+      PrintAllocations(L"Read file", [&]()
+      {
+         *tree = ReadSimpleTextTree(path);
+      });
+
+      PrintAllocations(L"Read stream", [&]()
+      {
+         wifstream stream(path);
+         ReadSimpleTextTree(stream);
+      });
+
+      TextTree filtered;
+      PrintAllocations(L"Filter tree", [&]()
+      {
+         FilterTree(*tree, filtered, Contains(L"e"));
+      });
+
+      PrintAllocations(L"Destroy trees", [&]()
+      {
+         tree.reset();
+         filtered = TextTree();
+      });
+
+      filesystem::remove(path);
+   }
+}
@@ -0,0 +1,67 @@
+#include "BenchmarkHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace std::chrono;
+
+   double TimeFastest(const function<void()>& func, size_t runs)
+   {
+      double fastest = numeric_limits<double>::max();
+      for (size_t i = 0; i < runs; ++i)
+      {
+         const auto start = steady_clock::now();
+         func();
+         const auto stop = steady_clock::now();
+         fastest = min(fastest, duration<double>(stop - start).count());
+      }
+      return fastest;
+   }
+
+   void PrintThroughput(const wstring& name, size_t byteCount, double seconds)
+   {
+      const double gigabytesPerSecond = seconds > 0 ? double(byteCount) / seconds / 1e9 : 0.;
+      wcout << left << setw(40) << name << right << fixed << setprecision(2)
+            << setw(8) << gigabytesPerSecond << L" GB/s" << endl;
+   }
+
+   string CreateTreeText(size_t approximateSize)
+   {
+      mt19937 random(12345);
+      uniform_int_distribution<size_t> depthChange(0, 2);
+      uniform_int_distribution<size_t> lineLength(4, 120);
+      uniform_int_distribution<int> letter('a', 'z');
+      uniform_int_distribution<int> useTab(0, 9);
+
+      string text;
+      text.reserve(approximateSize + 256);
+
+      size_t depth = 0;
+      while (text.size() < approximateSize)
+      {
+         // Move up or down at most one level, like real trees.
+         const size_t change = depthChange(random);
+         if (change == 0 && depth > 0)
+            depth -= 1;
+         else if (change == 2 && depth < 20)
+            depth += 1;
+
+         for (size_t i = 0; i < depth; ++i)
+            text += useTab(random) ? "  " : "\t";
+
+         const size_t length = lineLength(random);
+         for (size_t i = 0; i < length; ++i)
+            text += (i % 7 == 6) ? ' ' : char(letter(random));
+
+         text += '\n';
+      }
+
+      return text;
+   }
+}
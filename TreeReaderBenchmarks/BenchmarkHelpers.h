@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace TreeReaderBenchmarks
+{
+   // Run the function a few times and return the fastest time, in seconds.
+
+   double TimeFastest(const std::function<void()>& func, size_t runs = 5);
+
+   // Print the throughput of processing the given number of bytes in the given time.
+
+   void PrintThroughput(const std::wstring& name, size_t byteCount, double seconds);
+
+   // Create the text of a tree with varied indentation and line lengths.
+   // Uses a fixed seed so that all runs use the same text.
+
+   std::string CreateTreeText(size_t approximateSize);
+
+   // The benchmarks.
+
+   void RunLineScannerBenchmarks();
+   void RunReadTreeBenchmarks();
+   void RunAllocationBenchmarks();
+   void RunContainsBenchmarks();
+   void RunRegexBenchmarks();
+   void RunIndexBenchmarks();
+   void RunFilterBenchmarks();
+}
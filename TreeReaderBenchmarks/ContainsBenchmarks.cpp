@@ -0,0 +1,117 @@
+#include "BenchmarkHelpers.h"
+#include "TextSearcher.h"
+#include "TreeReaderHelpers.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   void RunContainsBenchmarks()
+   {
+      const string text = CreateTreeText(32 * 1024 * 1024);
+
+      // Split the text in lines, and make the wide null-terminated lines that wcsstr needs.
+      vector<string_view> lines;
+      vector<wstring> wideLines;
+      for (size_t pos = 0; pos < text.size(); )
+      {
+         size_t end = text.find('\n', pos);
+         if (end == string::npos)
+            end = text.size();
+         lines.emplace_back(text.data() + pos, end - pos);
+         wideLines.emplace_back(ConvertFromUtf8(lines.back().data(), lines.back().size()));
+         pos = end + 1;
+      }
+
+      wcout << L"Contains, " << text.size() / (1024 * 1024) << L" MB of text, " << lines.size() << L" lines" << endl;
+
+      // Note: the searched texts are taken from the text itself, so that there are
+      //       a few matches and many partial matches of the first characters.
+      const string_view source = lines[lines.size() / 2];
+      for (const size_t length : { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32 })
+      {
+         const string searched(source.substr(source.size() > length ? source.size() - length : 0));
+         const wstring wideSearched = ConvertFromUtf8(searched);
+         const TextSearcher searcher(searched);
+
+         // Note: the counts are printed so that the work cannot be optimized away.
+         size_t wcsstrCount = 0;
+         size_t findCount = 0;
+         size_t searcherCount = 0;
+
+         const double wcsstrTime = TimeFastest([&]()
+         {
+            wcsstrCount = 0;
+            for (const wstring& line : wideLines)
+               wcsstrCount += (wcsstr(line.c_str(), wideSearched.c_str()) != nullptr);
+         });
+
+         const double findTime = TimeFastest([&]()
+         {
+            findCount = 0;
+            for (const string_view line : lines)
+               findCount += (line.find(searched) != string_view::npos);
+         });
+
+         const double searcherTime = TimeFastest([&]()
+         {
+            searcherCount = 0;
+            for (const string_view line : lines)
+               searcherCount += searcher.IsFoundIn(line);
+         });
+
+         const wstring name = L"Length " + to_wstring(searched.size()) + L", ";
+         PrintThroughput(name + L"wcsstr", text.size(), wcsstrTime);
+         PrintThroughput(name + L"string find", text.size(), findTime);
+         PrintThroughput(name + L"text searcher", text.size(), searcherTime);
+
+         if (wcsstrCount != searcherCount || findCount != searcherCount)
+            wcout << L"Error: the number of matches differ." << endl;
+      }
+
+      // Search for many texts at once, each taken from a different line.
+      for (const size_t count : { 10, 100, 1000 })
+      {
+         vector<string> manySearched;
+         vector<TextSearcher> searchers;
+         for (size_t i = 0; i < count; ++i)
+         {
+            const string_view line = lines[(i * 7919) % lines.size()];
+            manySearched.emplace_back(line.substr(line.size() / 2, min<size_t>(line.size() / 2, 8)));
+            searchers.emplace_back(manySearched.back());
+         }
+         const MultiTextSearcher multiSearcher(manySearched);
+
+         size_t searchersCount = 0;
+         size_t multiSearcherCount = 0;
+
+         const double searchersTime = TimeFastest([&]()
+         {
+            searchersCount = 0;
+            for (const string_view line : lines)
+               searchersCount += any_of(searchers.begin(), searchers.end(), [line](const TextSearcher& searcher) { return searcher.IsFoundIn(line); });
+         }, 1);
+
+         const double multiSearcherTime = TimeFastest([&]()
+         {
+            multiSearcherCount = 0;
+            for (const string_view line : lines)
+               multiSearcherCount += multiSearcher.IsAnyFoundIn(line);
+         });
+
+         const wstring name = L"Any of " + to_wstring(count) + L", ";
+         PrintThroughput(name + L"one searcher each", text.size(), searchersTime);
+         PrintThroughput(name + L"multi-text searcher", text.size(), multiSearcherTime);
+
+         if (searchersCount != multiSearcherCount)
+            wcout << L"Error: the number of matches differ." << endl;
+      }
+   }
+}
@@ -0,0 +1,67 @@
+#include "BenchmarkHelpers.h"
+#include "SimpleTreeReader.h"
+#include "TreeFilter.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   void RunFilterBenchmarks()
+   {
+      const string text = CreateTreeText(32 * 1024 * 1024);
+
+      const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-benchmark-filter.txt";
+      {
+         ofstream stream(path, ios::binary);
+         stream << text;
+      }
+
+      const TextTree tree = ReadSimpleTextTree(path);
+      filesystem::remove(path);
+
+      const size_t threadCount = max<size_t>(1, thread::hardware_concurrency());
+      wcout << L"Filter, " << text.size() / (1024 * 1024) << L" MB of text, " << tree.CountNodes() << L" nodes, "
+            << tree.CountChildren(InvalidNode) << L" roots" << endl;
+
+      const vector<TreeFilterPtr> filters =
+      {
+         Contains(L"uilca"),
+         Regex(L"a.*e.*i"),
+         Under(Contains(L"uilca"), false),
+         IfSubTree(Contains(L"uilca")),
+      };
+
+      for (const TreeFilterPtr& filter : filters)
+      {
+         size_t singleCount = 0;
+         size_t parallelCount = 0;
+
+         const double singleTime = TimeFastest([&]()
+         {
+            TextTree filtered;
+            FilterTree(tree, filtered, filter, {}, 1);
+            singleCount = filtered.CountNodes();
+         });
+
+         const double parallelTime = TimeFastest([&]()
+         {
+            TextTree filtered;
+            FilterTree(tree, filtered, filter, {}, threadCount);
+            parallelCount = filtered.CountNodes();
+         });
+
+         PrintThroughput(filter->GetName() + L", one thread", text.size(), singleTime);
+         PrintThroughput(filter->GetName() + L", " + to_wstring(threadCount) + L" threads", text.size(), parallelTime);
+
+         if (singleCount != parallelCount)
+            wcout << L"Error: the filtered trees differ." << endl;
+      }
+   }
+}
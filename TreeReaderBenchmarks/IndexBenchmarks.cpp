@@ -0,0 +1,75 @@
+#include "BenchmarkHelpers.h"
+#include "SimpleTreeReader.h"
+#include "TextTreeIndex.h"
+#include "TreeFilter.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   void RunIndexBenchmarks()
+   {
+      const string text = CreateTreeText(32 * 1024 * 1024);
+
+      const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-benchmark-index.txt";
+      {
+         ofstream stream(path, ios::binary);
+         stream << text;
+      }
+
+      const TextTree tree = ReadSimpleTextTree(path);
+      filesystem::remove(path);
+
+      wcout << L"Text index, " << text.size() / (1024 * 1024) << L" MB of text, " << tree.CountNodes() << L" nodes" << endl;
+
+      shared_ptr<const TextTreeIndex> index;
+      const double singleTime = TimeFastest([&]()
+      {
+         index = make_shared<const TextTreeIndex>(tree, 1);
+      }, 1);
+      PrintThroughput(L"Build index, one thread", text.size(), singleTime);
+
+      const double parallelTime = TimeFastest([&]()
+      {
+         index = make_shared<const TextTreeIndex>(tree);
+      }, 1);
+      PrintThroughput(L"Build index, " + to_wstring(thread::hardware_concurrency()) + L" threads", text.size(), parallelTime);
+
+      wcout << L"Index: " << index->CountTrigrams() << L" trigrams, " << index->GetMemoryUsage() / (1024 * 1024) << L" MB" << endl;
+
+      // Note: the searched texts are taken from the text itself, so that there are a few matches.
+      const string_view source = tree.GetText(NodeIndex(tree.CountNodes() / 2));
+      const wstring searched(source.end() - min<size_t>(source.size(), 6), source.end());
+      for (const TreeFilterPtr& filter : { TreeFilterPtr(Contains(searched)), TreeFilterPtr(Regex(searched + L".*")) })
+      {
+         size_t scanCount = 0;
+         size_t indexedCount = 0;
+
+         const double scanTime = TimeFastest([&]()
+         {
+            TextTree filtered;
+            FilterTree(tree, filtered, filter);
+            scanCount = filtered.CountNodes();
+         });
+
+         const double indexedTime = TimeFastest([&]()
+         {
+            TextTree filtered;
+            FilterTree(tree, filtered, filter, index);
+            indexedCount = filtered.CountNodes();
+         });
+
+         PrintThroughput(filter->GetName() + L", without index", text.size(), scanTime);
+         PrintThroughput(filter->GetName() + L", with index", text.size(), indexedTime);
+
+         if (scanCount != indexedCount)
+            wcout << L"Error: the filtered trees differ." << endl;
+      }
+   }
+}
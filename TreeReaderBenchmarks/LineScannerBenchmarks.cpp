@@ -0,0 +1,107 @@
+#include "BenchmarkHelpers.h"
+#include "LineScanner.h"
+
+#include <iostream>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   namespace
+   {
+      // The previous way to find the end of lines, one character at a time.
+
+      const char* FindEndOfLineOneByOne(const char* pos, const char* end)
+      {
+         for (; pos < end; ++pos)
+            if (*pos == '\n' || *pos == '\r')
+               break;
+         return pos;
+      }
+
+      // The previous way to calculate the indentation, one character at a time.
+
+      size_t GetIndentOneByOne(const char*& pos, const char* end, const bool (&indents)[0x80], size_t tabSize)
+      {
+         size_t indent = 0;
+         for (; pos < end; ++pos)
+         {
+            const unsigned char c = *pos;
+            if (c >= 0x80 || !indents[c])
+               break;
+            indent += (c == '\t') ? tabSize : 1;
+         }
+         return indent;
+      }
+   }
+
+   void RunLineScannerBenchmarks()
+   {
+      const string text = CreateTreeText(64 * 1024 * 1024);
+      const char* const begin = text.data();
+      const char* const end = begin + text.size();
+
+      // Note: the sums are printed so that the work cannot be optimized away.
+      size_t oldSum = 0;
+      size_t newSum = 0;
+
+      wcout << L"Line scanner, " << text.size() / (1024 * 1024) << L" MB of text" << endl;
+
+      const double oldEndOfLineTime = TimeFastest([&]()
+      {
+         oldSum = 0;
+         for (const char* pos = begin; pos < end; ++pos)
+         {
+            pos = FindEndOfLineOneByOne(pos, end);
+            oldSum += pos - begin;
+         }
+      });
+      PrintThroughput(L"End-of-line, one by one", text.size(), oldEndOfLineTime);
+
+      const double newEndOfLineTime = TimeFastest([&]()
+      {
+         newSum = 0;
+         for (const char* pos = begin; pos < end; ++pos)
+         {
+            pos = FindEndOfLine(pos, end);
+            newSum += pos - begin;
+         }
+      });
+      PrintThroughput(L"End-of-line, vectorized", text.size(), newEndOfLineTime);
+
+      if (oldSum != newSum)
+         wcout << L"Error: the end-of-line results differ." << endl;
+
+      bool indents[0x80] = {};
+      indents[' '] = true;
+      indents['\t'] = true;
+
+      const double oldScanTime = TimeFastest([&]()
+      {
+         oldSum = 0;
+         for (const char* pos = begin; pos < end; ++pos)
+         {
+            oldSum += GetIndentOneByOne(pos, end, indents, 8);
+            pos = FindEndOfLineOneByOne(pos, end);
+         }
+      });
+      PrintThroughput(L"Indentation and end-of-line, one by one", text.size(), oldScanTime);
+
+      const LineScanner scanner(L" \t", 8);
+      const double newScanTime = TimeFastest([&]()
+      {
+         newSum = 0;
+         for (const char* pos = begin; pos < end; ++pos)
+         {
+            const auto scanned = scanner.ScanLine(pos, end);
+            newSum += scanned.Indent;
+            pos = scanned.EndOfLine;
+         }
+      });
+      PrintThroughput(L"Indentation and end-of-line, vectorized", text.size(), newScanTime);
+
+      if (oldSum != newSum)
+         wcout << L"Error: the indentation results differ." << endl;
+   }
+}
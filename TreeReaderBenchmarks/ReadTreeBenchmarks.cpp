@@ -0,0 +1,48 @@
+#include "BenchmarkHelpers.h"
+#include "SimpleTreeReader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   void RunReadTreeBenchmarks()
+   {
+      const string text = CreateTreeText(128 * 1024 * 1024);
+
+      const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-benchmark-read.txt";
+      {
+         ofstream stream(path, ios::binary);
+         stream << text;
+      }
+
+      wcout << L"Read tree file, " << text.size() / (1024 * 1024) << L" MB of text" << endl;
+
+      size_t singleNodeCount = 0;
+      ReadSimpleTextTreeOptions options;
+      options.ThreadCount = 1;
+      const double singleTime = TimeFastest([&]()
+      {
+         singleNodeCount = ReadSimpleTextTree(path, options).CountNodes();
+      }, 3);
+      PrintThroughput(L"Read file, one thread", text.size(), singleTime);
+
+      size_t parallelNodeCount = 0;
+      options.ThreadCount = 0;
+      const double parallelTime = TimeFastest([&]()
+      {
+         parallelNodeCount = ReadSimpleTextTree(path, options).CountNodes();
+      }, 3);
+      PrintThroughput(L"Read file, " + to_wstring(thread::hardware_concurrency()) + L" threads", text.size(), parallelTime);
+
+      if (singleNodeCount != parallelNodeCount)
+         wcout << L"Error: the trees differ." << endl;
+
+      filesystem::remove(path);
+   }
+}
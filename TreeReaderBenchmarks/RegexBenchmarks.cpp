@@ -0,0 +1,80 @@
+#include "BenchmarkHelpers.h"
+#include "TextRegex.h"
+
+#include <iostream>
+#include <regex>
+#include <string_view>
+#include <vector>
+
+namespace TreeReaderBenchmarks
+{
+   using namespace std;
+   using namespace TreeReader;
+
+   void RunRegexBenchmarks()
+   {
+      const string text = CreateTreeText(8 * 1024 * 1024);
+
+      vector<string_view> lines;
+      for (size_t pos = 0; pos < text.size(); )
+      {
+         size_t end = text.find('\n', pos);
+         if (end == string::npos)
+            end = text.size();
+         lines.emplace_back(text.data() + pos, end - pos);
+         pos = end + 1;
+      }
+
+      wcout << L"Regex, " << text.size() / (1024 * 1024) << L" MB of text, " << lines.size() << L" lines" << endl;
+
+      // Note: the last regular expression has no required text and makes backtracking engines retry at each character.
+      for (const wchar_t* textForm : { L"abc", L"[0-9]+x", L"a.*b.*c.*z", L"^\\s+[a-f]{3}", L"(a|e|i|o|u)+[^aeiou]{4}$" })
+      {
+         const TextRegex regex(textForm);
+         const std::regex stdRegex(string(textForm, textForm + wcslen(textForm)));
+
+         // Note: the counts are printed so that the work cannot be optimized away.
+         size_t stdCount = 0;
+         size_t regexCount = 0;
+
+         const double stdTime = TimeFastest([&]()
+         {
+            stdCount = 0;
+            for (const string_view line : lines)
+               stdCount += regex_search(line.begin(), line.end(), stdRegex);
+         }, 1);
+
+         const double regexTime = TimeFastest([&]()
+         {
+            regexCount = 0;
+            for (const string_view line : lines)
+               regexCount += regex.IsFoundIn(line);
+         });
+
+         const wstring name = wstring(textForm) + L", ";
+         PrintThroughput(name + L"std regex", text.size(), stdTime);
+         PrintThroughput(name + L"text regex", text.size(), regexTime);
+
+         if (stdCount != regexCount)
+            wcout << L"Error: the number of matches differ." << endl;
+      }
+
+      // Note: the preferred match could go on from each position up to the z,
+      //       so following each start on its own would read the first half for each of them.
+      {
+         const string line = string(1024 * 1024, 'a') + "z" + string(1024 * 1024, 'a') + "b";
+         const TextRegex regex(L"a[^z]*b|a");
+
+         size_t count = 0;
+         const double time = TimeFastest([&]()
+         {
+            count = regex.FindAll(line).size();
+         });
+
+         PrintThroughput(L"a[^z]*b|a, find all, text regex", line.size(), time);
+
+         if (count != 1024 * 1024 + 1)
+            wcout << L"Error: the number of matches is wrong." << endl;
+      }
+   }
+}
@@ -0,0 +1,16 @@
+#include "BenchmarkHelpers.h"
+
+using namespace TreeReaderBenchmarks;
+
+int main()
+{
+   RunLineScannerBenchmarks();
+   RunReadTreeBenchmarks();
+   RunAllocationBenchmarks();
+   RunContainsBenchmarks();
+   RunRegexBenchmarks();
+   RunIndexBenchmarks();
+   RunFilterBenchmarks();
+
+   return 0;
+}
@@ -0,0 +1,174 @@
+#include "FilteredView.h"
+#include "TreeFilter.h"
+#include "TextTreeIndex.h"
+#include "TreeReaderHelpers.h"
+#include "TreeReaderTestHelpers.h"
+#include "CppUnitTest.h"
+
+#include <sstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(FilteredViewTests)
+	{
+	public:
+
+		TEST_METHOD(FilterSimpleTreeIntoView)
+		{
+			FilteredView view;
+			FilterTree(CreateSimpleTree(), view, Not(Contains(L"h")));
+
+			Assert::IsFalse(view.IsEmpty());
+			Assert::AreEqual<size_t>(7, view.CountNodes());
+
+			const NodeIndex abc = view.GetFirstChild(InvalidNode);
+			Assert::AreEqual("abc", string(view.GetText(abc)).c_str());
+			Assert::AreEqual<NodeIndex>(InvalidNode, view.GetNextSibling(abc));
+			Assert::AreEqual<NodeIndex>(InvalidNode, view.GetParent(abc));
+
+			const NodeIndex def = view.GetFirstChild(abc);
+			Assert::AreEqual("def", string(view.GetText(def)).c_str());
+
+			// The children of the dropped ghi are now children of abc.
+			const NodeIndex mno = view.GetNextSibling(def);
+			Assert::AreEqual("mno", string(view.GetText(mno)).c_str());
+			Assert::AreEqual(abc, view.GetParent(mno));
+			Assert::AreEqual<NodeIndex>(InvalidNode, view.GetNextSibling(mno));
+
+			const NodeIndex pqr = view.GetFirstChild(mno);
+			const NodeIndex stu = view.GetNextSibling(pqr);
+			Assert::AreEqual("stu", string(view.GetText(stu)).c_str());
+			Assert::AreEqual("vwx", string(view.GetText(view.GetFirstChild(stu))).c_str());
+			Assert::AreEqual<NodeIndex>(InvalidNode, view.GetFirstChild(pqr));
+		}
+
+		TEST_METHOD(FilteredViewCreatesSameTreeAsFilterTree)
+		{
+			const TextTree tree = CreateSimpleTree();
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Contains(L"g"),
+				Not(Contains(L"f")),
+				Not(Contains(L"h")),
+				Or(Contains(L"a"), Contains(L"p")),
+				Under(Contains(L"m")),
+				NoChild(Contains(L"s")),
+				LevelRange(1, 2),
+				Not(Accept()),
+				TreeFilterPtr(),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree filtered;
+				FilterTree(tree, filtered, filter);
+
+				FilteredView view;
+				FilterTree(tree, view, filter);
+
+				wostringstream expected;
+				expected << filtered;
+
+				wostringstream created;
+				created << view.CreateTree();
+				Assert::AreEqual(expected.str().c_str(), created.str().c_str());
+				Assert::AreEqual(filtered.CountNodes(), view.CountNodes());
+
+				// Visiting the view gives the same levels as the filtered tree.
+				wostringstream visited;
+				VisitInOrder(view, [&visited](const TextTree& tree, NodeIndex node, size_t level)
+				{
+					visited << wstring(level * 2, L' ') << ConvertFromUtf8(string(tree.GetText(node))) << L"\n";
+					return TreeVisitor::Result();
+				});
+				Assert::AreEqual(expected.str().c_str(), visited.str().c_str());
+			}
+		}
+
+		TEST_METHOD(VisitFilteredViewWithLevelChanges)
+		{
+			FilteredView view;
+			FilterTree(CreateSimpleTree(), view, Not(Contains(L"h")));
+
+			struct LevelVisitor : SimpleTreeVisitor
+			{
+				string Visited;
+
+				Result GoDeeper(size_t deeperLevel) override { Visited += ">" + to_string(deeperLevel) + " "; return Result(); }
+				Result GoHigher(size_t higherLevel) override { Visited += "<" + to_string(higherLevel) + " "; return Result(); }
+				Result Visit(const TextTree& tree, NodeIndex node, size_t level) override
+				{
+					Visited += string(tree.GetText(node)) + " ";
+					return Result{ false, tree.GetText(node) == "def" };
+				}
+			};
+
+			LevelVisitor visitor;
+			VisitInOrder(view, visitor);
+			Assert::AreEqual("abc >1 def mno >2 pqr stu >3 vwx <2 <1 <0 ", visitor.Visited.c_str());
+		}
+
+		TEST_METHOD(FilterViewKeepsSameNodesAsFilteringItsTree)
+		{
+			vector<string> lines;
+			vector<NodeIndex> parents;
+			for (size_t i = 0; i < 100000; ++i)
+			{
+				lines.emplace_back((i % 5) ? "child " + to_string(i) : "root " + to_string(i));
+				parents.emplace_back((i % 5 == 0) ? InvalidNode : (i % 5 == 1) ? NodeIndex(i - 1) : NodeIndex(i - i % 5 + 1));
+			}
+
+			TextTree tree;
+			tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+			tree.Freeze();
+
+			const auto index = make_shared<const TextTreeIndex>(tree);
+
+			FilteredView view;
+			FilterTree(tree, view, Not(Regex(L"[13]$")));
+			const TextTree viewTree = view.CreateTree();
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Contains(L"7"),
+				Under(Contains(L"99"), false),
+				CountChildren(Contains(L"5"), 1),
+				IfSubTree(Contains(L"42")),
+				IfSibling(Contains(L"44")),
+				CountSiblings(Contains(L"6"), 1),
+				TreeFilterPtr(),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree expected;
+				FilterTree(viewTree, expected, filter, {}, 1);
+
+				wostringstream expectedStream;
+				expectedStream << expected;
+
+				for (const size_t threadCount : { 1, 4 })
+				{
+					FilteredView filtered;
+					FilterTree(view, filtered, filter, index, threadCount);
+
+					wostringstream filteredStream;
+					filteredStream << filtered.CreateTree();
+
+					Assert::AreEqual(expectedStream.str().c_str(), filteredStream.str().c_str());
+				}
+			}
+
+			TextTree expected;
+			FilterTree(viewTree, expected, filters[0]);
+
+			auto [fut, abort] = FilterTreeAsync(make_shared<const FilteredView>(view), filters[0], index, 4);
+			Assert::AreEqual(expected.CountNodes(), fut.get().CountNodes());
+		}
+	};
+}
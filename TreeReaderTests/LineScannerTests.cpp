@@ -0,0 +1,104 @@
+#include "LineScanner.h"
+#include "CppUnitTest.h"
+
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(LineScannerTests)
+	{
+	public:
+
+		TEST_METHOD(FindEndOfLineInEmptyText)
+		{
+			const string text;
+			Assert::IsTrue(FindEndOfLine(text.data(), text.data()) == text.data());
+		}
+
+		TEST_METHOD(FindEndOfLineAtAllPositions)
+		{
+			// Note: long lines verify each block of characters and the partial block at the end.
+			for (size_t length = 0; length < 100; ++length)
+			{
+				for (const char eol : { '\n', '\r' })
+				{
+					const string text = string(length, 'a') + eol + string(length % 37, 'b');
+					const char* found = FindEndOfLine(text.data(), text.data() + text.size());
+					Assert::AreEqual<size_t>(length, found - text.data());
+				}
+
+				const string text(length, 'a');
+				const char* found = FindEndOfLine(text.data(), text.data() + text.size());
+				Assert::AreEqual<size_t>(length, found - text.data());
+			}
+		}
+
+		TEST_METHOD(GetIndentOfLines)
+		{
+			LineScanner scanner(L" \t", 4);
+
+			const string text = "  \t abc";
+			const auto indentation = scanner.GetIndent(text.data(), text.data() + text.size());
+			Assert::AreEqual<size_t>(7, indentation.Indent);
+			Assert::AreEqual<size_t>(4, indentation.TextIndex);
+
+			const string noIndent = "abc  ";
+			const auto noIndentation = scanner.GetIndent(noIndent.data(), noIndent.data() + noIndent.size());
+			Assert::AreEqual<size_t>(0, noIndentation.Indent);
+			Assert::AreEqual<size_t>(0, noIndentation.TextIndex);
+		}
+
+		TEST_METHOD(GetLongIndentOfLines)
+		{
+			LineScanner scanner(L" \t", 8);
+
+			for (size_t length = 0; length < 100; ++length)
+			{
+				const string text = string(length, ' ') + "\t\t" + string(length, ' ') + "abc";
+				const auto indentation = scanner.GetIndent(text.data(), text.data() + text.size());
+				Assert::AreEqual<size_t>(length * 2 + 16, indentation.Indent);
+				Assert::AreEqual<size_t>(length * 2 + 2, indentation.TextIndex);
+			}
+		}
+
+		TEST_METHOD(GetIndentWithOtherIndentChars)
+		{
+			LineScanner scanner(L".\u00B7", 8);
+
+			const string text = "..\xC2\xB7.\tabc";
+			const auto indentation = scanner.GetIndent(text.data(), text.data() + text.size());
+			Assert::AreEqual<size_t>(4, indentation.Indent);
+			Assert::AreEqual<size_t>(5, indentation.TextIndex);
+		}
+
+		TEST_METHOD(ScanLines)
+		{
+			LineScanner scanner;
+
+			const string text = "    abc def\n\t  ghi\r\njkl";
+			const char* end = text.data() + text.size();
+
+			const auto first = scanner.ScanLine(text.data(), end);
+			Assert::AreEqual<size_t>(4, first.Indent);
+			Assert::AreEqual<size_t>(4, first.TextIndex);
+			Assert::AreEqual<size_t>(11, first.EndOfLine - text.data());
+
+			const auto second = scanner.ScanLine(first.EndOfLine + 1, end);
+			Assert::AreEqual<size_t>(10, second.Indent);
+			Assert::AreEqual<size_t>(3, second.TextIndex);
+			Assert::AreEqual<size_t>(18, second.EndOfLine - text.data());
+
+			const auto empty = scanner.ScanLine(second.EndOfLine + 1, end);
+			Assert::AreEqual<size_t>(0, empty.Indent);
+			Assert::AreEqual<size_t>(19, empty.EndOfLine - text.data());
+
+			const auto last = scanner.ScanLine(empty.EndOfLine + 1, end);
+			Assert::AreEqual<size_t>(0, last.Indent);
+			Assert::IsTrue(last.EndOfLine == end);
+		}
+	};
+}
@@ -0,0 +1,70 @@
+#include "OperationProgress.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(OperationProgressTests)
+	{
+	public:
+
+		TEST_METHOD(ReportProgressInBatches)
+		{
+			OperationProgress progress;
+			progress.AddTotal(100);
+
+			Assert::AreEqual(0., progress.GetFraction());
+
+			{
+				ProgressBatch batch(&progress, 10);
+				for (size_t i = 0; i < 25; ++i)
+					Assert::IsFalse(batch.Advance());
+
+				// Only the full batches were reported, the rest is reported when the batch ends.
+				Assert::AreEqual<size_t>(20, progress.GetDone());
+			}
+
+			Assert::AreEqual<size_t>(25, progress.GetDone());
+			Assert::AreEqual(0.25, progress.GetFraction());
+
+			// Work that is not counted only checks for cancellation.
+			{
+				ProgressBatch batch(&progress, 10);
+				for (size_t i = 0; i < 25; ++i)
+					Assert::IsFalse(batch.Poll());
+			}
+
+			Assert::AreEqual<size_t>(25, progress.GetDone());
+		}
+
+		TEST_METHOD(CancelProgress)
+		{
+			OperationProgress progress;
+			ProgressBatch batch(&progress, 10);
+
+			Assert::IsFalse(batch.Advance(5));
+
+			// The cancellation is only seen at the end of the batch.
+			progress.Cancel();
+			Assert::IsTrue(progress.IsCancelled());
+			Assert::IsFalse(batch.Advance(4));
+			Assert::IsTrue(batch.Advance(1));
+			Assert::IsTrue(batch.IsCancelled());
+
+			// A batch started after the cancellation sees it right away.
+			ProgressBatch late(&progress, 10);
+			Assert::IsTrue(late.IsCancelled());
+		}
+
+		TEST_METHOD(BatchWithoutProgress)
+		{
+			ProgressBatch batch(nullptr, 10);
+			for (size_t i = 0; i < 25; ++i)
+				Assert::IsFalse(batch.Advance());
+			Assert::IsFalse(batch.Flush());
+		}
+	};
+}
@@ -1,8 +1,10 @@
 #include "SimpleTreeReader.h"
+#include "SimpleTreeWriter.h"
 #include "TreeReaderTestHelpers.h"
 #include "CppUnitTest.h"
 
 #include <sstream>
+#include <fstream>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std;
@@ -39,6 +41,258 @@ namespace TreeReaderTests
 			Assert::AreEqual(expectedOutput, sstream2.str().c_str());
 		}
 
+		TEST_METHOD(ReadSimpleTreeFromFile)
+		{
+			const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-read-file.txt";
+			{
+				wofstream stream(path);
+				stream << L"abc\n\n  def\r\n    jkl\n\tghi\n";
+			}
+
+			TextTree tree = ReadSimpleTextTree(path);
+			filesystem::remove(path);
+
+			wostringstream sstream;
+			sstream << tree;
+
+			const wchar_t expectedOutput[] =
+				L"abc\n"
+				L"  def\n"
+				L"    jkl\n"
+				L"      ghi\n";
+			Assert::AreEqual(expectedOutput, sstream.str().c_str());
+		}
+
+		TEST_METHOD(ReadUtf8TreeFromFile)
+		{
+			const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-read-utf8-file.txt";
+			{
+				ofstream stream(path, ios::binary);
+				stream << "h\xC3\xA9llo\n  w\xC3\xB6rld";
+			}
+
+			TextTree tree = ReadSimpleTextTree(path);
+			filesystem::remove(path);
+
+			wostringstream sstream;
+			sstream << tree;
+
+			const wchar_t expectedOutput[] =
+				L"h\u00E9llo\n"
+				L"  w\u00F6rld\n";
+			Assert::AreEqual(expectedOutput, sstream.str().c_str());
+
+			ostringstream utf8Stream;
+			utf8Stream << tree;
+
+			Assert::AreEqual("h\xC3\xA9llo\n  w\xC3\xB6rld\n", utf8Stream.str().c_str());
+		}
+
+		TEST_METHOD(ReadSimpleTreeFromFileInParallel)
+		{
+			const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-read-in-parallel.txt";
+			{
+				ofstream stream(path, ios::binary);
+				for (int i = 0; i < 50; ++i)
+					stream << "abc" << i << "\r\n  def\n    jkl\n\n  ghi\r\n\tmno\n";
+				stream << "  last";
+			}
+
+			ReadSimpleTextTreeOptions options;
+			options.ThreadCount = 1;
+
+			wostringstream expected;
+			expected << ReadSimpleTextTree(path, options);
+
+			for (const size_t threadCount : { 2, 3, 7, 64, 1000 })
+			{
+				options.ThreadCount = threadCount;
+
+				wostringstream sstream;
+				sstream << ReadSimpleTextTree(path, options);
+
+				Assert::AreEqual(expected.str().c_str(), sstream.str().c_str());
+			}
+
+			options.InputFilter = L"([^bek]*)";
+			options.ThreadCount = 1;
+
+			wostringstream expectedFiltered;
+			expectedFiltered << ReadSimpleTextTree(path, options);
+
+			options.ThreadCount = 5;
+
+			wostringstream filtered;
+			filtered << ReadSimpleTextTree(path, options);
+
+			filesystem::remove(path);
+
+			Assert::AreEqual(expectedFiltered.str().c_str(), filtered.str().c_str());
+			Assert::AreEqual(L"ac0\n  df\n    jl\n  ghi\n", expectedFiltered.str().substr(0, 22).c_str());
+		}
+
+		TEST_METHOD(ReadAndWriteTreeWithProgress)
+		{
+			const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-read-with-progress.txt";
+			{
+				ofstream stream(path, ios::binary);
+				for (int i = 0; i < 5000; ++i)
+					stream << "abc" << i << "\n  def\n    jkl\n\n  ghi\n";
+			}
+
+			ReadSimpleTextTreeOptions options;
+			options.ThreadCount = 3;
+
+			OperationProgress reading;
+			const TextTree tree = ReadSimpleTextTree(path, options, &reading);
+
+			Assert::AreEqual<size_t>(20000, tree.CountNodes());
+			Assert::AreEqual<size_t>(filesystem::file_size(path), reading.GetTotal());
+			Assert::AreEqual<size_t>(filesystem::file_size(path), reading.GetDone());
+
+			OperationProgress cancelledReading;
+			cancelledReading.Cancel();
+			Assert::IsTrue(ReadSimpleTextTree(path, options, &cancelledReading).IsEmpty());
+
+			// Note: the tree refers to the text of the file it was read from, so it is written to another file.
+			const filesystem::path writtenPath = filesystem::temp_directory_path() / L"tree-reader-test-write-with-progress.txt";
+
+			OperationProgress writing;
+			WriteSimpleTextTree(writtenPath, tree, L"  ", &writing);
+
+			Assert::AreEqual(tree.CountNodes(), writing.GetTotal());
+			Assert::AreEqual(tree.CountNodes(), writing.GetDone());
+
+			OperationProgress cancelledWriting;
+			cancelledWriting.Cancel();
+			WriteSimpleTextTree(writtenPath, tree, L"  ", &cancelledWriting);
+
+			Assert::AreEqual<size_t>(0, cancelledWriting.GetDone());
+			Assert::AreEqual<uintmax_t>(0, filesystem::file_size(writtenPath));
+
+			filesystem::remove(writtenPath);
+			filesystem::remove(path);
+		}
+
+		TEST_METHOD(ReadTreeFromFileInParts)
+		{
+			const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-read-in-parts.txt";
+			{
+				ofstream stream(path, ios::binary);
+				for (int i = 0; i < 450000; ++i)
+					stream << "root " << i << "\n  child " << i << "\n    leaf " << i << "\n";
+			}
+
+			{
+				const TextTree expected = ReadSimpleTextTree(path);
+
+				vector<TextTree> partialTrees;
+				OperationProgress progress;
+				const TextTree tree = ReadSimpleTextTreeInParts(path, ReadSimpleTextTreeOptions(), [&partialTrees](const TextTree& partial)
+				{
+					partialTrees.emplace_back(partial);
+				}, &progress);
+
+				ostringstream expectedStream;
+				expectedStream << expected;
+
+				ostringstream treeStream;
+				treeStream << tree;
+
+				Assert::IsTrue(expectedStream.str() == treeStream.str());
+				Assert::AreEqual<size_t>(filesystem::file_size(path), progress.GetDone());
+
+				// The file is read in parts of 4 MB, 8 MB, then the rest.
+				Assert::AreEqual<size_t>(2, partialTrees.size());
+
+				// Each partial tree is a frozen prefix of the whole tree.
+				size_t previousCount = 0;
+				for (const TextTree& partial : partialTrees)
+				{
+					Assert::IsTrue(partial.IsFrozen());
+					Assert::IsTrue(partial.CountNodes() > previousCount);
+					Assert::IsTrue(partial.CountNodes() < tree.CountNodes());
+					for (NodeIndex node = 0; node < partial.CountNodes(); ++node)
+					{
+						Assert::IsTrue(partial.GetText(node) == tree.GetText(node));
+						Assert::AreEqual(tree.GetParent(node), partial.GetParent(node));
+					}
+					previousCount = partial.CountNodes();
+				}
+			}
+
+			filesystem::remove(path);
+		}
+
+		TEST_METHOD(ReadTreeWithLineLessIndentedThanFirst)
+		{
+			wistringstream sstream(L"  abc\n    def\nghi\n  jkl\n");
+
+			TextTree tree = ReadSimpleTextTree(sstream);
+
+			wostringstream sstream2;
+			sstream2 << tree;
+
+			const wchar_t expectedOutput[] =
+				L"abc\n"
+				L"  def\n"
+				L"ghi\n"
+				L"  jkl\n";
+			Assert::AreEqual(expectedOutput, sstream2.str().c_str());
+		}
+
+		TEST_METHOD(ReadTreeWithVariedIndentsInParallel)
+		{
+			const wchar_t input[] =
+				L"    a\n"
+				L"  b\n"
+				L"      c\n"
+				L"    d\n"
+				L"        e\n"
+				L"      f\n"
+				L"  g\n"
+				L"h\n"
+				L"   i\n"
+				L"  j\n"
+				L" k\n"
+				L"  l\n";
+
+			const wchar_t expectedOutput[] =
+				L"a\n"
+				L"b\n"
+				L"  c\n"
+				L"  d\n"
+				L"    e\n"
+				L"    f\n"
+				L"g\n"
+				L"h\n"
+				L"  i\n"
+				L"  j\n"
+				L"  k\n"
+				L"    l\n";
+
+			for (const size_t threadCount : { 1, 2, 3, 4, 6, 12, 30 })
+			{
+				ReadSimpleTextTreeOptions options;
+				options.ThreadCount = threadCount;
+
+				wistringstream sstream(input);
+				TextTree tree = ReadSimpleTextTree(sstream, options);
+
+				wostringstream sstream2;
+				sstream2 << tree;
+
+				Assert::AreEqual(expectedOutput, sstream2.str().c_str());
+			}
+		}
+
+		TEST_METHOD(ReadSimpleTreeFromMissingFile)
+		{
+			TextTree tree = ReadSimpleTextTree(filesystem::temp_directory_path() / L"tree-reader-test-no-such-file.txt");
+
+			Assert::IsTrue(tree.IsEmpty());
+		}
+
 		TEST_METHOD(ReadSimpleTreeWithInputFilter)
 		{
 			wstringstream sstream;
@@ -0,0 +1,128 @@
+#include "TaskScheduler.h"
+#include "CppUnitTest.h"
+
+#include <numeric>
+#include <stdexcept>
+#include <future>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TaskSchedulerTests)
+	{
+	public:
+
+		TEST_METHOD(SubmitTasksAndGetResults)
+		{
+			TaskScheduler scheduler(3);
+
+			Assert::AreEqual<size_t>(3, scheduler.CountThreads());
+
+			vector<future<size_t>> results;
+			for (size_t i = 0; i < 100; ++i)
+				results.emplace_back(scheduler.Submit([i]() { return i * i; }));
+
+			size_t total = 0;
+			for (auto& result : results)
+				total += result.get();
+
+			Assert::AreEqual<size_t>(328350, total);
+
+			auto failed = scheduler.Submit([]() -> int { throw runtime_error("failed"); });
+			Assert::ExpectException<runtime_error>([&failed]() { failed.get(); });
+		}
+
+		TEST_METHOD(HigherPriorityTasksRunFirst)
+		{
+			TaskScheduler scheduler(1);
+
+			// Keep the only thread busy while the other tasks are queued.
+			promise<void> release;
+			shared_future<void> released = release.get_future().share();
+			auto blocker = scheduler.Submit([released]() { released.wait(); });
+
+			vector<int> order;
+			vector<future<void>> done;
+			done.emplace_back(scheduler.Submit([&order]() { order.emplace_back(1); }, TaskScheduler::Priority::Background));
+			done.emplace_back(scheduler.Submit([&order]() { order.emplace_back(2); }, TaskScheduler::Priority::Normal));
+			done.emplace_back(scheduler.Submit([&order]() { order.emplace_back(3); }, TaskScheduler::Priority::Interactive));
+			done.emplace_back(scheduler.Submit([&order]() { order.emplace_back(4); }, TaskScheduler::Priority::Interactive));
+
+			release.set_value();
+			blocker.get();
+			for (auto& task : done)
+				task.get();
+
+			Assert::IsTrue(vector<int>{ 3, 4, 2, 1 } == order);
+		}
+
+		TEST_METHOD(DropQueuedTasksWhenDestroyed)
+		{
+			promise<void> release;
+			thread releaser;
+			future<void> blocker;
+			future<void> dropped;
+			{
+				TaskScheduler scheduler(1);
+
+				promise<void> started;
+				shared_future<void> released = release.get_future().share();
+				blocker = scheduler.Submit([&started, released]() { started.set_value(); released.wait(); });
+				dropped = scheduler.Submit([]() {});
+				started.get_future().wait();
+
+				// Note: the only thread is released once the scheduler is being destroyed.
+				releaser = thread([&release]() { this_thread::sleep_for(200ms); release.set_value(); });
+			}
+			releaser.join();
+
+			blocker.get();
+			Assert::ExpectException<future_error>([&dropped]() { dropped.get(); });
+		}
+
+		TEST_METHOD(RunChunksInParallel)
+		{
+			TaskScheduler scheduler(4);
+
+			vector<atomic<size_t>> calls(1000);
+			scheduler.RunInParallel(calls.size(), [&calls](size_t chunk) { calls[chunk] += 1; });
+
+			for (const auto& count : calls)
+				Assert::AreEqual<size_t>(1, count);
+
+			Assert::ExpectException<runtime_error>([&scheduler]()
+			{
+				scheduler.RunInParallel(10, [](size_t chunk) { if (chunk == 7) throw runtime_error("failed"); });
+			});
+		}
+
+		TEST_METHOD(RunChunksInParallelFromManyTasks)
+		{
+			// Note: there are more tasks waiting for their chunks than threads.
+			TaskScheduler scheduler(2);
+
+			vector<future<size_t>> results;
+			for (size_t i = 0; i < 8; ++i)
+			{
+				results.emplace_back(scheduler.Submit([&scheduler]()
+				{
+					vector<size_t> sums(50);
+					scheduler.RunInParallel(sums.size(), [&scheduler, &sums](size_t chunk)
+					{
+						vector<size_t> values(10);
+						scheduler.RunInParallel(values.size(), [&values, chunk](size_t i) { values[i] = chunk * 10 + i; });
+						sums[chunk] = accumulate(values.begin(), values.end(), size_t(0));
+					});
+					return accumulate(sums.begin(), sums.end(), size_t(0));
+				}));
+			}
+
+			for (auto& result : results)
+				Assert::AreEqual<size_t>(124750, result.get());
+		}
+	};
+}
@@ -0,0 +1,225 @@
+#include "TextRegex.h"
+#include "CppUnitTest.h"
+
+#include <functional>
+#include <random>
+#include <regex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TextRegexTests)
+	{
+	public:
+
+		TEST_METHOD(MatchSimpleRegex)
+		{
+			Assert::IsTrue(TextRegex(L"").IsFoundIn(""));
+			Assert::IsTrue(TextRegex(L"b").IsFoundIn("abc"));
+			Assert::IsFalse(TextRegex(L"d").IsFoundIn("abc"));
+			Assert::IsTrue(TextRegex(L"a.c").IsFoundIn("xxabcxx"));
+			Assert::IsTrue(TextRegex(L"^ab").IsFoundIn("abc"));
+			Assert::IsFalse(TextRegex(L"^bc").IsFoundIn("abc"));
+			Assert::IsTrue(TextRegex(L"bc$").IsFoundIn("abc"));
+			Assert::IsFalse(TextRegex(L"ab$").IsFoundIn("abc"));
+			Assert::IsTrue(TextRegex(L"^$").IsFoundIn(""));
+			Assert::IsTrue(TextRegex(L"a(b|cd)+e").IsFoundIn("xacdbcde"));
+			Assert::IsTrue(TextRegex(L"\\d{3}-\\d{2,}").IsFoundIn("call 555-1234"));
+			Assert::IsFalse(TextRegex(L"\\d{3}-\\d{2,}").IsFoundIn("call 555-1"));
+			Assert::IsTrue(TextRegex(L"[^a-c]").IsFoundIn("abcd"));
+			Assert::IsFalse(TextRegex(L"[^a-c]").IsFoundIn("abcabc"));
+			Assert::IsTrue(TextRegex(L"a{2}?b").IsFoundIn("aab"));
+			Assert::IsTrue(TextRegex(L"x{").IsFoundIn("x{"));
+			Assert::IsTrue(TextRegex(L"\\x41\\u0042").IsFoundIn("AB"));
+			Assert::IsTrue(TextRegex(L"\\bERROR\\b").IsFoundIn("1: ERROR: failed"));
+			Assert::IsFalse(TextRegex(L"\\bERROR\\b").IsFoundIn("1: ERRORS: failed"));
+			Assert::IsTrue(TextRegex(L"\\BRR\\B").IsFoundIn("ERROR"));
+			Assert::IsFalse(TextRegex(L"\\BER").IsFoundIn("ERROR"));
+			Assert::IsTrue(TextRegex(L"[\\b]").IsFoundIn("\b"));
+
+			// The text is not null-terminated.
+			const string_view partial = string_view("abcdef").substr(0, 3);
+			Assert::IsFalse(TextRegex(L"cd").IsFoundIn(partial));
+			Assert::IsTrue(TextRegex(L"c$").IsFoundIn(partial));
+		}
+
+		TEST_METHOD(MatchUtf8Characters)
+		{
+			const string text = "caf\xC3\xA9 \xE2\x82\xAC" "5";
+
+			Assert::IsTrue(TextRegex(L"caf\u00E9").IsFoundIn(text));
+			Assert::IsTrue(TextRegex(L"^caf. .\\d$").IsFoundIn(text));
+			Assert::IsTrue(TextRegex(L"[\u00E0-\u00FF]").IsFoundIn(text));
+			Assert::IsTrue(TextRegex(L"[^a-z ]\\d").IsFoundIn(text));
+			Assert::IsFalse(TextRegex(L"caf[^\u00E9]").IsFoundIn(text));
+			Assert::IsFalse(TextRegex(L"^.{3}$").IsFoundIn(text));
+			Assert::IsTrue(TextRegex(L"^.{7}$").IsFoundIn(text));
+
+			// The assertions are not checked between the bytes of a character.
+			Assert::IsFalse(TextRegex(L"\\B").IsFoundIn("a\xC3\xA9" "c"));
+			Assert::IsTrue(TextRegex(L"a\\b\u00E9$").IsFoundIn("a\xC3\xA9"));
+			Assert::IsFalse(TextRegex(L"\\B\\W$").IsFoundIn("a\xC3\xA9"));
+		}
+
+		TEST_METHOD(InvalidRegexNeverMatches)
+		{
+			for (const wchar_t* textForm : { L"(a", L"a)", L"[ab", L"*a", L"\\", L"(a)\\1", L"(?=a)", L"[z-a]", L"a{3,2}" })
+			{
+				TextRegex regex(textForm);
+				Assert::IsFalse(regex.IsValid());
+				Assert::IsFalse(regex.GetError().empty());
+				Assert::IsFalse(regex.IsFoundIn("a"));
+				Assert::IsTrue(regex.FindAll("a").empty());
+			}
+
+			Assert::IsFalse(TextRegex().IsFoundIn(""));
+			Assert::IsTrue(TextRegex(L"a").IsValid());
+		}
+
+		TEST_METHOD(FindAllMatches)
+		{
+			const auto findAll = [](const wchar_t* textForm, string_view text)
+			{
+				wstring found;
+				for (const string_view match : TextRegex(textForm).FindAll(text))
+					found += L"<" + wstring(match.begin(), match.end()) + L">";
+				return found;
+			};
+
+			Assert::AreEqual(L"<ab><ab>", findAll(L"ab", "xabyyabz").c_str());
+			Assert::AreEqual(L"<aaa><aa>", findAll(L"a+", "aaabaa").c_str());
+			Assert::AreEqual(L"<abcd>", findAll(L"a.*d", "abcd").c_str());
+			Assert::AreEqual(L"<123><45>", findAll(L"\\d+", "a123b45").c_str());
+			Assert::AreEqual(L"<a>", findAll(L"^a", "aaa").c_str());
+			Assert::AreEqual(L"<a>", findAll(L"a$", "aaa").c_str());
+			Assert::AreEqual(L"", findAll(L"z", "aaa").c_str());
+
+			// The first alternative is preferred, and lazy repeats match as little as possible.
+			Assert::AreEqual(L"<a>", findAll(L"a|ab", "ab").c_str());
+			Assert::AreEqual(L"<ab>", findAll(L"ab|a", "ab").c_str());
+			Assert::AreEqual(L"<[a] x [b]>", findAll(L"\\[.*\\]", "[a] x [b]").c_str());
+			Assert::AreEqual(L"<[a]><[b]>", findAll(L"\\[.*?\\]", "[a] x [b]").c_str());
+			Assert::AreEqual(L"<aa><aa>", findAll(L"a{2,3}?", "aaaa").c_str());
+
+			// A higher priority match that ends later replaces the matches found meanwhile.
+			Assert::AreEqual(L"<abcd>", findAll(L"ab.*d|a", "abcd").c_str());
+			Assert::AreEqual(L"<a><a><a>", findAll(L"ab.*d|a", "aaa").c_str());
+
+			Assert::AreEqual(L"<ERROR><ERROR>", findAll(L"\\bERROR\\b", "ERROR ERRORS, ERROR").c_str());
+
+			// Empty matches are found between the characters.
+			Assert::AreEqual(L"<><ac><><e><>", findAll(L"[^bd]*", "bacde").c_str());
+			Assert::AreEqual(L"<a><><>", findAll(L"a*", "ab").c_str());
+			Assert::AreEqual(L"<><><><>", findAll(L"x*", "a\xC3\xA9" "c").c_str());
+			Assert::AreEqual(L"<><>", findAll(L"\\b", "\xC3\xA9 ab").c_str());
+			Assert::AreEqual(L"<><><>", findAll(L"\\B", "\xC3\xA9\xE2\x82\xAC").c_str());
+
+			// Like ECMAScript, an optional repeat that reads no character is not taken.
+			Assert::AreEqual(L"<><a><>", findAll(L"(?:(?:a)??)?", "ca").c_str());
+			Assert::AreEqual(L"<><ccc><><>", findAll(L"(?:(?:c)*?)*", "accca").c_str());
+			Assert::AreEqual(L"<c 1 >", findAll(L"[^a]+?(?:\\W|b)(?:aa|(?:\\b|[^a] )?|[^a]+?)", "ac 1 ").c_str());
+			Assert::AreEqual(L"<abba><>", findAll(L"(?:a?b?)*", "abba").c_str());
+			Assert::AreEqual(L"<aa><>", findAll(L"(?:|a)*", "aa").c_str());
+			Assert::AreEqual(L"<aa><>", findAll(L"(?:a??)+", "aa").c_str());
+			Assert::AreEqual(L"<aab>", findAll(L"(?:a*?)+?b", "aab").c_str());
+			Assert::AreEqual(L"<ab><>", findAll(L"(?:a|b??){2,}", "ab").c_str());
+			Assert::AreEqual(L"<aa><>", findAll(L"(?:$|a)+", "aa").c_str());
+
+			// Not repeating a bounded lazy repeat again goes on after it.
+			Assert::AreEqual(L"<  -><1><>", findAll(L"(?:(?:.(?:|.+)){0,2}?){1,3}\\b", "  -1 ").c_str());
+		}
+
+		TEST_METHOD(FindAllInLinearTime)
+		{
+			// Note: the preferred match could go on from each position up to the z,
+			//       so following each start on its own would read the first half for each of them.
+			//       The time taken is measured in the regex benchmarks.
+			const string line = string(100000, 'a') + "z" + string(100000, 'a') + "b";
+
+			const vector<string_view> matches = TextRegex(L"a[^z]*b|a").FindAll(line);
+
+			Assert::AreEqual<size_t>(100001, matches.size());
+			Assert::AreEqual<size_t>(1, matches[0].size());
+			Assert::AreEqual<size_t>(100001, matches.back().size());
+		}
+
+		TEST_METHOD(MatchGivesSameResultsAsStdRegex)
+		{
+			mt19937 random(12345);
+
+			// Note: patterns are built from a small grammar so that they are always valid.
+			const wstring atoms[] = { L"a", L"b", L"c", L".", L"[ab]", L"[^a]", L"\\d", L"1", L"(a|bc)", L"(?:ab)", L"(b|ab)", L"^", L"$", L"\\b", L"\\B" };
+			const wstring quantifiers[] = { L"", L"", L"", L"*", L"+", L"?", L"{2}", L"{1,3}", L"*?", L"+?", L"??" };
+			const wstring characters[] = { L"a", L"b", L"c", L".", L"[ab]", L"[^a]", L"\\d", L"1" };
+			uniform_int_distribution<size_t> atom(0, size(atoms) - 1);
+			uniform_int_distribution<size_t> quantifier(0, size(quantifiers) - 1);
+			uniform_int_distribution<size_t> character(0, size(characters) - 1);
+			uniform_int_distribution<size_t> patternLength(1, 5);
+			uniform_int_distribution<size_t> groupKind(0, 5);
+
+			// Note: quantified groups are nested in the patterns. They always end with a character,
+			//       since the std::regex implementations differ from ECMAScript when an optional
+			//       repeat matches empty. Those cases are checked in FindAllMatches instead.
+			function<wstring(size_t)> makePattern = [&](size_t depth)
+			{
+				wstring pattern;
+				const size_t length = patternLength(random);
+				for (size_t j = 0; j < length; ++j)
+				{
+					const size_t kind = groupKind(random);
+					if (depth > 0 && kind < 2)
+					{
+						wstring group = makePattern(depth - 1) + characters[character(random)];
+						if (kind == 1)
+							group += L"|" + makePattern(depth - 1) + characters[character(random)];
+						pattern += L"(?:" + group + L")" + quantifiers[quantifier(random)];
+						continue;
+					}
+
+					const wstring& a = atoms[atom(random)];
+					pattern += a;
+					if (a != L"^" && a != L"$" && a != L"\\b" && a != L"\\B")
+						pattern += quantifiers[quantifier(random)];
+				}
+				return pattern;
+			};
+
+			const string letters = "abc1 ";
+			uniform_int_distribution<size_t> letter(0, letters.size() - 1);
+			uniform_int_distribution<size_t> textLength(0, 12);
+
+			for (size_t i = 0; i < 2000; ++i)
+			{
+				const wstring pattern = makePattern(2);
+
+				TextRegex regex(pattern);
+				Assert::IsTrue(regex.IsValid());
+
+				const std::regex expected(string(pattern.begin(), pattern.end()));
+
+				for (size_t j = 0; j < 10; ++j)
+				{
+					string text(textLength(random), ' ');
+					for (auto& c : text)
+						c = letters[letter(random)];
+
+					// Note: the first match must also be the same, as later ones depend on how empty matches are skipped.
+					smatch expectedMatch;
+					const bool isFound = regex_search(text, expectedMatch, expected);
+					Assert::AreEqual(isFound, regex.IsFoundIn(text));
+
+					const vector<string_view> matches = regex.FindAll(text);
+					Assert::AreEqual(isFound, !matches.empty());
+					if (isFound)
+					{
+						Assert::AreEqual<size_t>(expectedMatch.position(0), matches[0].data() - text.data());
+						Assert::AreEqual<size_t>(expectedMatch.length(0), matches[0].size());
+					}
+				}
+			}
+		}
+	};
+}
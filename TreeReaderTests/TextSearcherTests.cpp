@@ -0,0 +1,107 @@
+#include "TextSearcher.h"
+#include "CppUnitTest.h"
+
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TextSearcherTests)
+	{
+	public:
+
+		TEST_METHOD(SearchSimpleTexts)
+		{
+			Assert::AreEqual<size_t>(0, TextSearcher("").Find("abc"));
+			Assert::AreEqual<size_t>(0, TextSearcher("").Find(""));
+			Assert::AreEqual<size_t>(1, TextSearcher("b").Find("abc"));
+			Assert::AreEqual<size_t>(string_view::npos, TextSearcher("d").Find("abc"));
+			Assert::AreEqual<size_t>(string_view::npos, TextSearcher("abcd").Find("abc"));
+			Assert::AreEqual<size_t>(0, TextSearcher("abc").Find("abc"));
+			Assert::AreEqual<size_t>(36, TextSearcher("needle").Find("haystack haystack haystack haystack needle haystack"));
+			Assert::AreEqual<size_t>(string_view::npos, TextSearcher("needle").Find("haystack haystack haystack haystack needl haystack"));
+
+			// The searched text at the very end of a text longer than a block.
+			Assert::AreEqual<size_t>(34, TextSearcher("xy").Find("abcdefghijklmnopqrstuvwabcdefghijkxy"));
+			Assert::IsTrue(TextSearcher("xy").IsFoundIn("abcdefghijklmnopqrstuvwabcdefghijkxy"));
+
+			// The text is not null-terminated.
+			const string_view partial = string_view("abcdefghijklmnopqrstuvwxyz").substr(0, 20);
+			Assert::IsFalse(TextSearcher("tu").IsFoundIn(partial));
+			Assert::IsTrue(TextSearcher("st").IsFoundIn(partial));
+		}
+
+		TEST_METHOD(SearchGivesSameResultsAsFind)
+		{
+			mt19937 random(12345);
+
+			// Note: spaces and common letters change which characters are compared first.
+			const string letters = "abc e";
+			uniform_int_distribution<size_t> letter(0, letters.size() - 1);
+			uniform_int_distribution<size_t> textLength(0, 80);
+			uniform_int_distribution<size_t> searchedLength(0, 6);
+
+			for (size_t i = 0; i < 20000; ++i)
+			{
+				string text(textLength(random), ' ');
+				for (auto& c : text)
+					c = letters[letter(random)];
+
+				string searched(searchedLength(random), ' ');
+				for (auto& c : searched)
+					c = letters[letter(random)];
+
+				Assert::AreEqual(string_view(text).find(searched), TextSearcher(searched).Find(text));
+			}
+		}
+
+		TEST_METHOD(SearchManyTexts)
+		{
+			const MultiTextSearcher searcher({ "he", "she", "his", "hers" });
+			Assert::IsTrue(searcher.IsAnyFoundIn("ushers"));
+			Assert::IsTrue(searcher.IsAnyFoundIn("this"));
+			Assert::IsTrue(searcher.IsAnyFoundIn("ahe"));
+			Assert::IsFalse(searcher.IsAnyFoundIn("hi sh hr"));
+			Assert::IsFalse(searcher.IsAnyFoundIn(""));
+
+			Assert::IsTrue(MultiTextSearcher({ "abc", "" }).IsAnyFoundIn("x"));
+			Assert::IsFalse(MultiTextSearcher(vector<string>()).IsAnyFoundIn("x"));
+			Assert::IsFalse(MultiTextSearcher().IsAnyFoundIn("x"));
+		}
+
+		TEST_METHOD(SearchManyTextsGivesSameResultsAsFind)
+		{
+			mt19937 random(6789);
+
+			const string letters = "abc";
+			uniform_int_distribution<size_t> letter(0, letters.size() - 1);
+			uniform_int_distribution<size_t> textLength(0, 30);
+			uniform_int_distribution<size_t> searchedLength(1, 5);
+			uniform_int_distribution<size_t> searchedCount(1, 6);
+
+			for (size_t i = 0; i < 5000; ++i)
+			{
+				vector<string> searched(searchedCount(random));
+				for (auto& text : searched)
+				{
+					text.resize(searchedLength(random));
+					for (auto& c : text)
+						c = letters[letter(random)];
+				}
+
+				string text(textLength(random), ' ');
+				for (auto& c : text)
+					c = letters[letter(random)];
+
+				bool expected = false;
+				for (const auto& s : searched)
+					expected = expected || (text.find(s) != string::npos);
+
+				Assert::AreEqual(expected, MultiTextSearcher(searched).IsAnyFoundIn(text));
+			}
+		}
+	};
+}
@@ -0,0 +1,150 @@
+#include "TextTreeIndex.h"
+#include "TreeFilter.h"
+#include "TreeReaderTestHelpers.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TextTreeIndexTests)
+	{
+	public:
+
+		static TextTree CreateNumberedTree(vector<string>& lines)
+		{
+			vector<NodeIndex> parents;
+			for (size_t i = 0; i < 50000; ++i)
+			{
+				lines.emplace_back((i % 3) ? "child " + to_string(i) : "root " + to_string(i));
+				parents.emplace_back((i % 3) ? NodeIndex(i - i % 3) : InvalidNode);
+			}
+
+			TextTree tree;
+			tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+			tree.Freeze();
+			return tree;
+		}
+
+		TEST_METHOD(FindCandidatesOfTexts)
+		{
+			vector<string> lines;
+			const TextTree tree = CreateNumberedTree(lines);
+			const TextTreeIndex index(tree);
+
+			Assert::IsTrue(index.IsIndexOf(tree));
+			Assert::IsFalse(index.IsIndexOf(CreateSimpleTree()));
+			Assert::IsTrue(index.CountTrigrams() > 0);
+			Assert::IsTrue(index.GetMemoryUsage() > 0);
+
+			for (const string text : { "123", "ild 4", "oot 1000", "49999" })
+			{
+				vector<NodeIndex> candidates;
+				Assert::IsTrue(index.FindCandidates(text, candidates));
+				Assert::IsTrue(is_sorted(candidates.begin(), candidates.end()));
+
+				for (NodeIndex node = 0; node < tree.CountNodes(); ++node)
+				{
+					const bool isCandidate = binary_search(candidates.begin(), candidates.end(), node);
+					if (tree.GetText(node).find(text) != string_view::npos)
+						Assert::IsTrue(isCandidate);
+				}
+			}
+
+			// Texts too short cannot be searched, texts with unknown trigrams are in no node.
+			vector<NodeIndex> candidates;
+			Assert::IsFalse(index.FindCandidates("12", candidates));
+			Assert::IsTrue(index.FindCandidates("xyz", candidates));
+			Assert::IsTrue(candidates.empty());
+		}
+
+		TEST_METHOD(IndexBuiltWithManyThreadsIsSame)
+		{
+			vector<string> lines;
+			const TextTree tree = CreateNumberedTree(lines);
+			const TextTreeIndex single(tree, 1);
+			const TextTreeIndex many(tree, 7);
+
+			Assert::AreEqual(single.CountTrigrams(), many.CountTrigrams());
+
+			for (const string text : { "root", "123", "ld 77" })
+			{
+				vector<NodeIndex> singleCandidates;
+				vector<NodeIndex> manyCandidates;
+				single.FindCandidates(text, singleCandidates);
+				many.FindCandidates(text, manyCandidates);
+				Assert::IsTrue(singleCandidates == manyCandidates);
+			}
+		}
+
+		TEST_METHOD(BuildIndexWithProgress)
+		{
+			vector<string> lines;
+			const TextTree tree = CreateNumberedTree(lines);
+
+			OperationProgress progress;
+			const TextTreeIndex index(tree, 3, &progress);
+
+			Assert::IsTrue(index.IsIndexOf(tree));
+			Assert::AreEqual<size_t>(3 * tree.CountNodes(), progress.GetTotal());
+			Assert::AreEqual(progress.GetTotal(), progress.GetDone());
+
+			// A cancelled index is left empty.
+			OperationProgress cancelled;
+			cancelled.Cancel();
+			const TextTreeIndex empty(tree, 3, &cancelled);
+
+			Assert::IsFalse(empty.IsIndexOf(tree));
+			Assert::AreEqual<size_t>(0, empty.CountTrigrams());
+		}
+
+		TEST_METHOD(FilterWithIndexKeepsSameNodes)
+		{
+			vector<string> lines;
+			const TextTree tree = CreateNumberedTree(lines);
+			const auto index = make_shared<const TextTreeIndex>(tree);
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Contains(L"123"),
+				Contains(L"12"),
+				Regex(L"ro+t 4.*9$"),
+				ContainsAny(L"777|4242"),
+				ContainsAny(L"777|42"),
+				Under(Contains(L"999")),
+				And(Contains(L"child"), Not(Contains(L"11"))),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree expected;
+				FilterTree(tree, expected, filter);
+
+				TextTree indexed;
+				FilterTree(tree, indexed, filter, index);
+
+				wostringstream expectedStream;
+				expectedStream << expected;
+
+				wostringstream indexedStream;
+				indexedStream << indexed;
+
+				Assert::AreEqual(expectedStream.str().c_str(), indexedStream.str().c_str());
+
+				// The index of another tree is ignored.
+				TextTree simpleExpected;
+				FilterTree(CreateSimpleTree(), simpleExpected, filter);
+
+				TextTree simpleIndexed;
+				FilterTree(CreateSimpleTree(), simpleIndexed, filter, index);
+
+				Assert::AreEqual(simpleExpected.CountNodes(), simpleIndexed.CountNodes());
+			}
+		}
+	};
+}
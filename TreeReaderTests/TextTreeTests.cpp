@@ -27,35 +27,53 @@ namespace TreeReaderTests
 		{
 			const TextTree tree = CreateSimpleTree();
 
-         Assert::AreEqual<size_t>(1, tree.Roots.size());
-
-			Assert::AreEqual<size_t>(2, tree.CountChildren(tree.Roots[0]));
-			Assert::AreEqual<size_t>(1, tree.CountChildren(tree.Roots[0]->Children[0]));
-         Assert::AreEqual<size_t>(0, tree.CountChildren(tree.Roots[0]->Children[0]->Children[0]));
-         Assert::AreEqual<size_t>(1, tree.CountChildren(tree.Roots[0]->Children[1]));
-			Assert::AreEqual<size_t>(2, tree.CountChildren(tree.Roots[0]->Children[1]->Children[0]));
-			Assert::AreEqual<size_t>(0, tree.CountChildren(tree.Roots[0]->Children[1]->Children[0]->Children[0]));
-			Assert::AreEqual<size_t>(1, tree.CountChildren(tree.Roots[0]->Children[1]->Children[0]->Children[1]));
-			Assert::AreEqual<size_t>(0, tree.CountChildren(tree.Roots[0]->Children[1]->Children[0]->Children[1]->Children[0]));
-
-			Assert::AreEqual<size_t>(1, tree.CountSiblings(tree.Roots[0]));
-         Assert::AreEqual<size_t>(2, tree.CountSiblings(tree.Roots[0]->Children[0]));
-         Assert::AreEqual<size_t>(1, tree.CountSiblings(tree.Roots[0]->Children[0]->Children[0]));
-         Assert::AreEqual<size_t>(2, tree.CountSiblings(tree.Roots[0]->Children[1]));
-         Assert::AreEqual<size_t>(1, tree.CountSiblings(tree.Roots[0]->Children[1]->Children[0]));
-         Assert::AreEqual<size_t>(2, tree.CountSiblings(tree.Roots[0]->Children[1]->Children[0]->Children[0]));
-         Assert::AreEqual<size_t>(2, tree.CountSiblings(tree.Roots[0]->Children[1]->Children[0]->Children[1]));
-         Assert::AreEqual<size_t>(1, tree.CountSiblings(tree.Roots[0]->Children[1]->Children[0]->Children[1]->Children[0]));
-
-         Assert::AreEqual<size_t>(0, tree.CountAncestors(tree.Roots[0]));
-         Assert::AreEqual<size_t>(1, tree.CountAncestors(tree.Roots[0]->Children[0]));
-         Assert::AreEqual<size_t>(2, tree.CountAncestors(tree.Roots[0]->Children[0]->Children[0]));
-         Assert::AreEqual<size_t>(1, tree.CountAncestors(tree.Roots[0]->Children[1]));
-         Assert::AreEqual<size_t>(2, tree.CountAncestors(tree.Roots[0]->Children[1]->Children[0]));
-         Assert::AreEqual<size_t>(3, tree.CountAncestors(tree.Roots[0]->Children[1]->Children[0]->Children[0]));
-         Assert::AreEqual<size_t>(3, tree.CountAncestors(tree.Roots[0]->Children[1]->Children[0]->Children[1]));
-         Assert::AreEqual<size_t>(4, tree.CountAncestors(tree.Roots[0]->Children[1]->Children[0]->Children[1]->Children[0]));
-      }
+			Assert::AreEqual<size_t>(1, tree.CountChildren(InvalidNode));
+			Assert::AreEqual<size_t>(8, tree.CountNodes());
+
+			const NodeIndex abc = tree.GetFirstChild(InvalidNode);
+			const NodeIndex def = tree.GetChild(abc, 0);
+			const NodeIndex jkl = tree.GetChild(def, 0);
+			const NodeIndex ghi = tree.GetChild(abc, 1);
+			const NodeIndex mno = tree.GetChild(ghi, 0);
+			const NodeIndex pqr = tree.GetChild(mno, 0);
+			const NodeIndex stu = tree.GetChild(mno, 1);
+			const NodeIndex vwx = tree.GetChild(stu, 0);
+
+			Assert::AreEqual("vwx", string(tree.GetText(vwx)).c_str());
+			Assert::AreEqual(InvalidNode, tree.GetChild(abc, 2));
+			Assert::AreEqual(InvalidNode, tree.GetNextSibling(ghi));
+			Assert::AreEqual(ghi, tree.GetNextSibling(def));
+			Assert::AreEqual(mno, tree.GetParent(stu));
+			Assert::AreEqual(InvalidNode, tree.GetParent(abc));
+			Assert::AreEqual<size_t>(1, tree.GetIndexInParent(stu));
+
+			Assert::AreEqual<size_t>(2, tree.CountChildren(abc));
+			Assert::AreEqual<size_t>(1, tree.CountChildren(def));
+			Assert::AreEqual<size_t>(0, tree.CountChildren(jkl));
+			Assert::AreEqual<size_t>(1, tree.CountChildren(ghi));
+			Assert::AreEqual<size_t>(2, tree.CountChildren(mno));
+			Assert::AreEqual<size_t>(0, tree.CountChildren(pqr));
+			Assert::AreEqual<size_t>(1, tree.CountChildren(stu));
+			Assert::AreEqual<size_t>(0, tree.CountChildren(vwx));
+
+			Assert::AreEqual<size_t>(1, tree.CountSiblings(abc));
+			Assert::AreEqual<size_t>(2, tree.CountSiblings(def));
+			Assert::AreEqual<size_t>(1, tree.CountSiblings(jkl));
+			Assert::AreEqual<size_t>(2, tree.CountSiblings(ghi));
+			Assert::AreEqual<size_t>(1, tree.CountSiblings(mno));
+			Assert::AreEqual<size_t>(2, tree.CountSiblings(pqr));
+			Assert::AreEqual<size_t>(2, tree.CountSiblings(stu));
+			Assert::AreEqual<size_t>(1, tree.CountSiblings(vwx));
+
+			Assert::AreEqual<size_t>(0, tree.CountAncestors(abc));
+			Assert::AreEqual<size_t>(1, tree.CountAncestors(def));
+			Assert::AreEqual<size_t>(2, tree.CountAncestors(jkl));
+			Assert::AreEqual<size_t>(1, tree.CountAncestors(ghi));
+			Assert::AreEqual<size_t>(2, tree.CountAncestors(mno));
+			Assert::AreEqual<size_t>(3, tree.CountAncestors(pqr));
+			Assert::AreEqual<size_t>(3, tree.CountAncestors(stu));
+			Assert::AreEqual<size_t>(4, tree.CountAncestors(vwx));
+		}
 
 		TEST_METHOD(PrintSimpleTree)
 		{
@@ -74,6 +92,129 @@ namespace TreeReaderTests
 			Assert::AreEqual(expectedOutput, sstream.str().c_str());
 		}
 
+		TEST_METHOD(AddManyNodes)
+		{
+			auto textLines = CreateTextLines();
+			const vector<string_view> texts =
+			{
+				textLines->Lines[0], textLines->Lines[1], textLines->Lines[3],
+				textLines->Lines[2], textLines->Lines[4], textLines->Lines[5],
+				textLines->Lines[6], textLines->Lines[7], textLines->Lines[0],
+			};
+			const vector<NodeIndex> parents = { InvalidNode, 0, 1, 0, 3, 4, 4, 6, InvalidNode };
+
+			const wchar_t expectedOutput[] =
+				L"abc\n"
+				L"  def\n"
+				L"    jkl\n"
+				L"  ghi\n"
+				L"    mno\n"
+				L"      pqr\n"
+				L"      stu\n"
+				L"        vwx\n"
+				L"abc\n";
+
+			for (const size_t threadCount : { 1, 2, 3, 5, 9, 20 })
+			{
+				TextTree tree;
+				tree.SourceTextLines = textLines;
+				tree.AddNodes(texts, parents, threadCount);
+
+				wostringstream sstream;
+				sstream << tree;
+				Assert::AreEqual(expectedOutput, sstream.str().c_str());
+
+				Assert::AreEqual<size_t>(2, tree.CountChildren(InvalidNode));
+				Assert::AreEqual<size_t>(1, tree.GetIndexInParent(8));
+				Assert::AreEqual<size_t>(1, tree.GetIndexInParent(3));
+				Assert::AreEqual<NodeIndex>(0, tree.GetParent(3));
+				Assert::AreEqual<NodeIndex>(8, tree.GetNextSibling(0));
+				Assert::AreEqual<NodeIndex>(6, tree.GetNextSibling(5));
+				Assert::AreEqual<size_t>(2, tree.CountChildren(4));
+				Assert::AreEqual<size_t>(4, tree.CountAncestors(7));
+			}
+		}
+
+		TEST_METHOD(PrintTreeWithTextLengths)
+		{
+			// Note: the text of the nodes need not be null-terminated.
+			const char text[] = "abcdefghi";
+
+			TextTree tree;
+			const NodeIndex abc = tree.AddChild(InvalidNode, string_view(text, 3));
+			tree.AddChild(abc, string_view(text + 3, 3));
+			tree.AddChild(InvalidNode, string_view(text + 6, 0));
+
+			Assert::AreEqual<size_t>(3, tree.GetText(abc).size());
+
+			wostringstream sstream;
+			sstream << tree;
+			const wchar_t expectedOutput[] =
+				L"abc\n"
+				L"  def\n"
+				L"\n";
+			Assert::AreEqual(expectedOutput, sstream.str().c_str());
+		}
+
+		TEST_METHOD(CopySimpleTree)
+		{
+			const TextTree tree = CreateSimpleTree();
+			TextTree copy = tree;
+			Assert::IsTrue(copy.SharesNodesWith(tree));
+
+			// Modifying the copy does not modify the original.
+			copy.AddChild(InvalidNode, tree.GetText(0));
+			Assert::IsFalse(copy.SharesNodesWith(tree));
+			Assert::AreEqual<size_t>(9, copy.CountNodes());
+			Assert::AreEqual<size_t>(8, tree.CountNodes());
+			Assert::AreEqual<size_t>(2, copy.CountChildren(InvalidNode));
+			Assert::AreEqual<size_t>(1, tree.CountChildren(InvalidNode));
+
+			copy.Reset();
+			Assert::IsTrue(copy.IsEmpty());
+			Assert::IsTrue(TextTree().SharesNodesWith(copy));
+			Assert::AreEqual<size_t>(8, tree.CountNodes());
+		}
+
+		TEST_METHOD(FreezeSimpleTree)
+		{
+			TextTree tree = CreateSimpleTree();
+			Assert::IsFalse(tree.IsFrozen());
+
+			tree.Freeze();
+			Assert::IsTrue(tree.IsFrozen());
+
+			const char* expectedTexts[] = { "abc", "def", "jkl", "ghi", "mno", "pqr", "stu", "vwx" };
+			const NodeIndex expectedEnds[] = { 8, 3, 3, 8, 8, 6, 8, 8 };
+			Assert::AreEqual<size_t>(8, tree.CountNodes());
+			for (NodeIndex node = 0; node < 8; ++node)
+			{
+				Assert::AreEqual(expectedTexts[node], string(tree.GetText(node)).c_str());
+				Assert::AreEqual(expectedEnds[node], tree.GetSubTreeEnd(node));
+			}
+
+			Assert::AreEqual<NodeIndex>(3, tree.GetNextSibling(1));
+			Assert::AreEqual<NodeIndex>(4, tree.GetParent(6));
+			Assert::AreEqual<size_t>(1, tree.GetIndexInParent(6));
+			Assert::AreEqual<size_t>(4, tree.CountAncestors(7));
+
+			wostringstream sstream;
+			sstream << tree;
+			const wchar_t expectedOutput[] =
+				L"abc\n"
+				L"  def\n"
+				L"    jkl\n"
+				L"  ghi\n"
+				L"    mno\n"
+				L"      pqr\n"
+				L"      stu\n"
+				L"        vwx\n";
+			Assert::AreEqual(expectedOutput, sstream.str().c_str());
+
+			tree.AddChild(0, tree.GetText(1));
+			Assert::IsFalse(tree.IsFrozen());
+		}
+
 		TEST_METHOD(PrintSimpleTreeWithDotDotIndent)
 		{
 			wostringstream sstream;
@@ -15,7 +15,7 @@ namespace TreeReaderTests
       TEST_METHOD(VisitEmptyTree)
       {
          size_t visits = 0;
-         VisitInOrder(TextTree(), FunctionTreeVisitor([&visits](const TextTree& tree, const TextTree::Node& node, size_t level)
+         VisitInOrder(TextTree(), FunctionTreeVisitor([&visits](const TextTree& tree, NodeIndex node, size_t level)
          {
             visits += 1;
             return TreeVisitor::Result();
@@ -27,7 +27,7 @@ namespace TreeReaderTests
       TEST_METHOD(VisitSimpleTree)
       {
          size_t visits = 0;
-         VisitInOrder(CreateSimpleTree(), FunctionTreeVisitor([&visits](const TextTree& tree, const TextTree::Node& node, size_t level)
+         VisitInOrder(CreateSimpleTree(), FunctionTreeVisitor([&visits](const TextTree& tree, NodeIndex node, size_t level)
          {
             visits += 1;
             return TreeVisitor::Result();
@@ -36,10 +36,61 @@ namespace TreeReaderTests
          Assert::AreEqual<size_t>(8, visits);
       }
 
+      TEST_METHOD(VisitSimpleSubTree)
+      {
+         const TextTree tree = CreateSimpleTree();
+         const NodeIndex abc = tree.GetFirstChild(InvalidNode);
+         const NodeIndex def = tree.GetChild(abc, 0);
+         const NodeIndex ghi = tree.GetChild(abc, 1);
+
+         string visited;
+         const auto visit = [&visited](const TextTree& tree, NodeIndex node, size_t level)
+         {
+            visited += to_string(level) + string(tree.GetText(node)) + " ";
+            return TreeVisitor::Result();
+         };
+
+         VisitInOrder(tree, ghi, false, visit);
+         Assert::AreEqual("0mno 1pqr 1stu 2vwx ", visited.c_str());
+
+         visited.clear();
+         VisitInOrder(tree, def, true, visit);
+         Assert::AreEqual("0def 1jkl 0ghi 1mno 2pqr 2stu 3vwx ", visited.c_str());
+      }
+
+      TEST_METHOD(VisitFrozenSimpleTree)
+      {
+         TextTree tree = CreateSimpleTree();
+         tree.Freeze();
+
+         string visited;
+         auto visitor = FunctionTreeVisitor([&visited](const TextTree& tree, NodeIndex node, size_t level)
+         {
+            visited += to_string(level) + string(tree.GetText(node)) + " ";
+            return TreeVisitor::Result{ false, tree.GetText(node) == "mno" };
+         });
+
+         VisitInOrder(tree, visitor);
+         Assert::AreEqual("0abc 1def 2jkl 1ghi 2mno ", visited.c_str());
+
+         // The sub-tree starts at ghi, so mno is at level 0.
+         visited.clear();
+         VisitInOrder(tree, 3, false, visitor);
+         Assert::AreEqual("0mno ", visited.c_str());
+
+         visited.clear();
+         VisitInOrder(tree, 1, true, visitor);
+         Assert::AreEqual("0def 1jkl 0ghi 1mno ", visited.c_str());
+
+         visited.clear();
+         VisitInOrder(tree, 5, true, visitor);
+         Assert::AreEqual("0pqr 0stu 1vwx ", visited.c_str());
+      }
+
       TEST_METHOD(VisitSimpleTreeWithDelegate)
       {
          size_t visits = 0;
-         auto visitor = make_shared<FunctionTreeVisitor>([&visits](const TextTree& tree, const TextTree::Node& node, size_t level)
+         auto visitor = make_shared<FunctionTreeVisitor>([&visits](const TextTree& tree, NodeIndex node, size_t level)
          {
             visits += 1;
             return TreeVisitor::Result();
@@ -53,7 +104,7 @@ namespace TreeReaderTests
       TEST_METHOD(VisitSimpleTreeWithAbort)
       {
          size_t visits = 0;
-         auto visitor = make_shared<FunctionTreeVisitor>([&visits](const TextTree& tree, const TextTree::Node& node, size_t level)
+         auto visitor = make_shared<FunctionTreeVisitor>([&visits](const TextTree& tree, NodeIndex node, size_t level)
          {
             visits += 1;
             return TreeVisitor::Result();
@@ -67,5 +118,30 @@ namespace TreeReaderTests
          Assert::AreEqual<size_t>(0, visits);
       }
 
+      TEST_METHOD(VisitSimpleTreeWithProgress)
+      {
+         size_t visits = 0;
+         auto visitor = make_shared<FunctionTreeVisitor>([&visits](const TextTree& tree, NodeIndex node, size_t level)
+         {
+            visits += 1;
+            return TreeVisitor::Result();
+         });
+
+         OperationProgress progress;
+         {
+            ProgressTreeVisitor counter(&progress, visitor);
+            VisitInOrder(CreateSimpleTree(), counter);
+         }
+
+         Assert::AreEqual<size_t>(8, visits);
+         Assert::AreEqual<size_t>(8, progress.GetDone());
+
+         progress.Cancel();
+         ProgressTreeVisitor cancelled(&progress, visitor);
+         VisitInOrder(CreateSimpleTree(), cancelled);
+
+         Assert::AreEqual<size_t>(8, visits);
+      }
+
    };
 }
@@ -3,6 +3,8 @@
 #include "CppUnitTest.h"
 
 #include <sstream>
+#include <fstream>
+#include <thread>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace TreeReader;
@@ -35,5 +37,125 @@ namespace TreeReaderTests
          Assert::AreEqual(L"ghi", ctx2.Options.ReadOptions.InputIndent.c_str());
          Assert::AreEqual<size_t>(5, ctx2.Options.ReadOptions.TabSize);
       }
+
+		TEST_METHOD(LoadTreeAsync)
+		{
+         const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-load-async.txt";
+         {
+            ofstream stream(path, ios::binary);
+            for (int i = 0; i < 1000; ++i)
+               stream << "abc" << i << "\n  def\n    ghi\n";
+         }
+
+         {
+            CommandsContext ctx;
+            ctx.Options.IndexTree = false;
+
+            ctx.LoadTreeAsync(path);
+            while (!ctx.IsAsyncLoadReady())
+            {
+               Assert::IsTrue(ctx.GetAsyncLoadProgress() != nullptr);
+               this_thread::sleep_for(1ms);
+            }
+
+            Assert::IsTrue(ctx.GetCurrentTree() != nullptr);
+            Assert::AreEqual<size_t>(3000, ctx.GetCurrentTree()->CountNodes());
+            Assert::IsTrue(ctx.GetAsyncLoadProgress() == nullptr);
+            Assert::IsTrue(ctx.GetPartiallyLoadedTree() == nullptr);
+
+            // An aborted loading is never ready and leaves the current tree.
+            const auto current = ctx.GetCurrentTree();
+            ctx.LoadTreeAsync(path);
+            ctx.AbortAsyncLoad();
+            while (ctx.GetAsyncLoadProgress())
+               Assert::IsFalse(ctx.IsAsyncLoadReady());
+
+            Assert::IsTrue(ctx.GetCurrentTree() == current);
+         }
+
+         filesystem::remove(path);
+      }
+
+		TEST_METHOD(SaveFilteredTreeAsync)
+		{
+         const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-save-async-input.txt";
+         const filesystem::path savedPath = filesystem::temp_directory_path() / L"tree-reader-test-save-async.txt";
+         {
+            ofstream stream(path, ios::binary);
+            for (int i = 0; i < 1000; ++i)
+               stream << "abc" << i << "\n  def\n    ghi\n";
+         }
+
+         {
+            CommandsContext ctx;
+            ctx.Options.IndexTree = false;
+            ctx.LoadTree(path);
+            ctx.SetFilter(Contains(L"def"));
+            ctx.ApplyFilterToTree();
+            Assert::IsFalse(ctx.IsFilteredTreeSaved());
+
+            ctx.SaveFilteredTreeAsync(savedPath);
+            while (!ctx.IsAsyncSaveReady())
+            {
+               Assert::IsTrue(ctx.GetAsyncSaveProgress() != nullptr);
+               this_thread::sleep_for(1ms);
+            }
+
+            Assert::IsTrue(ctx.IsFilteredTreeSaved());
+            Assert::IsTrue(ctx.GetAsyncSaveProgress() == nullptr);
+            Assert::AreEqual<size_t>(1000, ReadSimpleTextTree(savedPath).CountNodes());
+
+            // An aborted saving is never ready and leaves the filtered tree unsaved.
+            ctx.SetFilter(Contains(L"ghi"));
+            ctx.ApplyFilterToTree();
+            ctx.SaveFilteredTreeAsync(savedPath);
+            ctx.AbortAsyncSave();
+            while (ctx.GetAsyncSaveProgress())
+               Assert::IsFalse(ctx.IsAsyncSaveReady());
+
+            Assert::IsFalse(ctx.IsFilteredTreeSaved());
+         }
+
+         filesystem::remove(path);
+         filesystem::remove(savedPath);
+      }
+
+		TEST_METHOD(FilterPushedFilteredTree)
+		{
+         const filesystem::path path = filesystem::temp_directory_path() / L"tree-reader-test-filter-pushed.txt";
+         {
+            ofstream stream(path, ios::binary);
+            for (int i = 0; i < 1000; ++i)
+               stream << "abc" << i << "\n  def\n    ghi\n";
+         }
+
+         {
+            CommandsContext ctx;
+            ctx.LoadTree(path);
+
+            ctx.SetFilter(Under(Contains(L"abc1")));
+            ctx.ApplyFilterToTree();
+            Assert::AreEqual<size_t>(333, ctx.GetFilteredTree()->CountNodes());
+
+            ctx.PushFilteredAsTree();
+            Assert::AreEqual<size_t>(333, ctx.GetCurrentTree()->CountNodes());
+
+            ctx.SetFilter(Contains(L"ghi"));
+            ctx.ApplyFilterToTree();
+            Assert::AreEqual<size_t>(111, ctx.GetFilteredTree()->CountNodes());
+
+            ctx.SetFilter(IfSubTree(Contains(L"ghi")));
+            ctx.ApplyFilterToTree();
+            Assert::AreEqual<size_t>(222, ctx.GetFilteredTree()->CountNodes());
+
+            ctx.SearchInTree(L"def");
+            Assert::AreEqual<size_t>(111, ctx.GetFilteredTree()->CountNodes());
+
+            ctx.PopTree();
+            Assert::AreEqual<size_t>(3000, ctx.GetCurrentTree()->CountNodes());
+         }
+
+         filesystem::remove(path);
+      }
 	};
 }
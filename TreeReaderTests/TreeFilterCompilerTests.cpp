@@ -0,0 +1,156 @@
+#include "TreeFilterCompiler.h"
+#include "NamedFilters.h"
+#include "TreeReaderTestHelpers.h"
+#include "CppUnitTest.h"
+
+#include <sstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TreeFilterCompilerTests)
+	{
+	public:
+
+		TEST_METHOD(CompiledFiltersKeepSameNodesAsFilters)
+		{
+			const TextTree tree = CreateSimpleTree();
+
+			NamedFilters named;
+			named.Add(L"has-m", Contains(L"m"));
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Accept(),
+				Stop(),
+				Until(Contains(L"m")),
+				Contains(L"g"),
+				ExactAddress(tree.GetText(3).data()),
+				Regex(L"[dm]"),
+				Not(Contains(L"h")),
+				Or(Contains(L"a"), Contains(L"p")),
+				And(Not(Contains(L"a")), Or(Contains(L"p"), Contains(L"s"))),
+				Any({ Contains(L"m"), TreeFilterPtr(), Under(Contains(L"s")) }),
+				Under(Contains(L"m")),
+				Under(Contains(L"g"), false),
+				CountSiblings(Contains(L"p"), 1, false),
+				CountChildren(Contains(L"g"), 1),
+				NoChild(Contains(L"s")),
+				NoChild(Contains(L"s"), true),
+				LevelRange(1, 2),
+				Under(named.Get(L"has-m")),
+				IfSubTree(Contains(L"w")),
+				Not(NoChild(Until(Contains(L"v")))),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree expected;
+				FilterTreeVisitor visitor(tree, expected, filter);
+				VisitInOrder(tree, visitor);
+
+				TextTree compiled;
+				FilterTree(tree, compiled, CompileFilter(filter));
+
+				wostringstream expectedStream;
+				expectedStream << expected;
+
+				wostringstream compiledStream;
+				compiledStream << compiled;
+
+				Assert::AreEqual(expectedStream.str().c_str(), compiledStream.str().c_str());
+			}
+		}
+
+		TEST_METHOD(CompiledFilterRunsSelectiveSubFiltersFirst)
+		{
+			struct CountingTreeFilter : DelegateTreeFilter
+			{
+				mutable size_t Calls = 0;
+
+				CountingTreeFilter(const TreeFilterPtr& filter) : DelegateTreeFilter(filter) { }
+
+				Result IsKept(const TextTree& tree, NodeIndex node, size_t level, TreeFilterContext& context) const override { ++Calls; return DelegateTreeFilter::IsKept(tree, node, level, context); }
+				bool IsNodePredicate() const override { return Filter->IsNodePredicate(); }
+				wstring GetShortName() const override { return L"counting"; }
+				wstring GetDescription() const override { return L""; }
+				TreeFilterPtr Clone() const override { return make_shared<CountingTreeFilter>(*this); }
+			};
+
+			vector<string> lines;
+			for (size_t i = 0; i < 100000; ++i)
+				lines.emplace_back("line " + to_string(i));
+
+			TextTree tree;
+			tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), vector<NodeIndex>(lines.size(), InvalidNode));
+
+			// The regex always keeps the node, so it never decides the and.
+			auto regex = make_shared<CountingTreeFilter>(Regex(L"l.*e"));
+			auto contains = make_shared<CountingTreeFilter>(Contains(L"7"));
+
+			TextTree filtered;
+			FilterTree(tree, filtered, And(regex, contains));
+
+			Assert::AreEqual<size_t>(lines.size(), contains->Calls);
+			Assert::IsTrue(regex->Calls < lines.size() / 2);
+
+			TextTree expected;
+			FilterTree(tree, expected, Contains(L"7"));
+			Assert::AreEqual(expected.CountNodes(), filtered.CountNodes());
+		}
+
+		TEST_METHOD(CompiledFilterKeepsStatefulSubFiltersInPlace)
+		{
+			vector<string> lines;
+			vector<NodeIndex> parents;
+			for (size_t i = 0; i < 20000; ++i)
+			{
+				lines.emplace_back((i % 3) ? "child " + to_string(i) : "root " + to_string(i));
+				parents.emplace_back((i % 3) ? NodeIndex(i - i % 3) : InvalidNode);
+			}
+
+			TextTree tree;
+			tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Any({ Regex(L"root .*5"), Under(Contains(L"7"), false), Contains(L"9"), CountSiblings(Contains(L"2"), 1), Contains(L"ro") }),
+				All({ Regex(L"o.*t"), Contains(L"1"), Under(Contains(L"3")), Not(Contains(L"4")) }),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree expected;
+				FilterTreeVisitor visitor(tree, expected, filter);
+				VisitInOrder(tree, visitor);
+
+				TextTree compiled;
+				FilterTree(tree, compiled, filter);
+
+				wostringstream expectedStream;
+				expectedStream << expected;
+
+				wostringstream compiledStream;
+				compiledStream << compiled;
+
+				Assert::AreEqual(expectedStream.str().c_str(), compiledStream.str().c_str());
+			}
+		}
+
+		TEST_METHOD(CompileNamedFilterInline)
+		{
+			NamedFilters named;
+			named.Add(L"abc", Not(Contains(L"abc")));
+
+			auto compiled = CompileFilter(And(named.Get(L"abc"), Under(Accept())));
+
+			// And, not, contains, under and accept: the named filter is not an instruction.
+			Assert::AreEqual<size_t>(5, compiled->CountInstructions());
+			Assert::AreEqual(compiled.get(), CompileFilter(compiled).get());
+			Assert::AreEqual(wstring(L"If all"), compiled->GetShortName());
+		}
+	};
+}
@@ -51,6 +51,19 @@ namespace TreeReaderTests
          Assert::AreEqual(L"\"abc\"", rebuilt->Contained.c_str());
       }
 
+      TEST_METHOD(ConvertToTextContainsAnyFilter)
+      {
+         auto filter = ContainsAny(vector<wstring>{ L"abc", L"def" });
+
+         const wstring text = ConvertFiltersToText(filter);
+
+         Assert::AreEqual(L"V1: \ncontains-any [ \"abc|def\" ]", text.c_str());
+
+         auto rebuilt = dynamic_pointer_cast<ContainsAnyTreeFilter>(ConvertTextToFilters(text, NamedFilters()));
+         Assert::IsTrue(rebuilt != nullptr);
+         Assert::AreEqual(L"abc|def", rebuilt->Contained.c_str());
+      }
+
       TEST_METHOD(ConvertToTextRegexFilter)
       {
          auto filter = Regex(L"[abc]*");
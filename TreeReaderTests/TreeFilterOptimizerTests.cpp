@@ -0,0 +1,123 @@
+#include "TreeFilterOptimizer.h"
+#include "NamedFilters.h"
+#include "TreeReaderTestHelpers.h"
+#include "CppUnitTest.h"
+
+#include <sstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+using namespace TreeReader;
+
+namespace TreeReaderTests
+{
+	TEST_CLASS(TreeFilterOptimizerTests)
+	{
+	public:
+
+		TEST_METHOD(OptimizeDoubleNegationAndNamedFilter)
+		{
+			NamedFilters named;
+			named.Add(L"abc", Contains(L"abc"));
+
+			auto optimized = OptimizeFilter(Not(Not(named.Get(L"abc"))));
+			Assert::IsNotNull(dynamic_pointer_cast<ContainsTreeFilter>(optimized).get());
+			Assert::IsTrue(optimized == named.Get(L"abc")->Filter);
+		}
+
+		TEST_METHOD(OptimizeNestedCombiners)
+		{
+			auto a = Contains(L"a");
+			auto b = Contains(L"b");
+			auto c = Contains(L"c");
+
+			auto flattened = dynamic_pointer_cast<AndTreeFilter>(OptimizeFilter(All({ a, Accept(), And(b, TreeFilterPtr()), Any({ c }) })));
+			Assert::IsNotNull(flattened.get());
+			Assert::AreEqual<size_t>(3, flattened->Filters.size());
+			Assert::IsTrue(flattened->Filters[0] == a);
+			Assert::IsTrue(flattened->Filters[1] == b);
+			Assert::IsTrue(flattened->Filters[2] == c);
+
+			// Nothing after an accept is reached in an or.
+			auto shortened = dynamic_pointer_cast<OrTreeFilter>(OptimizeFilter(Any({ a, Not(Accept()), Or(Regex(L"b"), Accept()), c })));
+			Assert::IsNotNull(shortened.get());
+			Assert::AreEqual<size_t>(3, shortened->Filters.size());
+			Assert::IsNotNull(dynamic_pointer_cast<RegexTreeFilter>(shortened->Filters[1]).get());
+			Assert::IsNotNull(dynamic_pointer_cast<AcceptTreeFilter>(shortened->Filters[2]).get());
+
+			Assert::IsNotNull(dynamic_pointer_cast<AcceptTreeFilter>(OptimizeFilter(And(Accept(), Accept()))).get());
+			Assert::IsTrue(OptimizeFilter(Or(Not(Accept()), a)) == a);
+
+			// Filters that cannot be simplified are not copied.
+			auto under = Under(Or(a, Regex(L"b")));
+			Assert::IsTrue(OptimizeFilter(under) == under);
+		}
+
+		TEST_METHOD(OptimizeOrOfContains)
+		{
+			auto regex = Regex(L"b");
+			auto combined = dynamic_pointer_cast<OrTreeFilter>(OptimizeFilter(Any({ Contains(L"a"), Or(Contains(L"b"), Contains(L"c")), regex, Contains(L"d"), Contains(L"e|f") })));
+			Assert::IsNotNull(combined.get());
+			Assert::AreEqual<size_t>(4, combined->Filters.size());
+
+			auto any = dynamic_pointer_cast<ContainsAnyTreeFilter>(combined->Filters[0]);
+			Assert::IsNotNull(any.get());
+			Assert::AreEqual(L"a|b|c", any->Contained.c_str());
+			Assert::IsTrue(combined->Filters[1] == regex);
+
+			// A single contains is kept as-is, as is a contains with the separator.
+			Assert::IsNotNull(dynamic_pointer_cast<ContainsTreeFilter>(combined->Filters[2]).get());
+			Assert::IsNotNull(dynamic_pointer_cast<ContainsTreeFilter>(combined->Filters[3]).get());
+
+			// Empty texts are kept, even first, since they are found in every node.
+			auto withEmpty = dynamic_pointer_cast<ContainsAnyTreeFilter>(OptimizeFilter(Any({ Contains(L""), Contains(L"ban") })));
+			Assert::IsNotNull(withEmpty.get());
+			Assert::AreEqual(L"|ban", withEmpty->Contained.c_str());
+
+			auto withEmptyAny = dynamic_pointer_cast<ContainsAnyTreeFilter>(OptimizeFilter(Any({ ContainsAny(L""), Contains(L"ban") })));
+			Assert::IsNotNull(withEmptyAny.get());
+			Assert::AreEqual(L"|ban", withEmptyAny->Contained.c_str());
+		}
+
+		TEST_METHOD(OptimizedFiltersKeepSameNodes)
+		{
+			const TextTree tree = CreateSimpleTree();
+
+			NamedFilters named;
+			named.Add(L"has-m", Contains(L"m"));
+
+			const vector<TreeFilterPtr> filters =
+			{
+				Not(Not(Until(Contains(L"m")))),
+				Any({ Contains(L"a"), Or(Contains(L"p"), Until(Contains(L"s"))), Stop() }),
+				All({ Accept(), NoChild(Contains(L"g")), And(Not(Contains(L"b")), Accept()) }),
+				And(Not(Accept()), Under(Contains(L"a"))),
+				Or(Not(Not(Not(Accept()))), Under(named.Get(L"has-m"))),
+				Under(Not(Not(named.Get(L"has-m"))), false),
+				CountChildren(Any({ Contains(L"g") }), 1),
+				Any({ TreeFilterPtr() }),
+				Any({ Contains(L"b"), Contains(L"w"), Until(Contains(L"s")), Contains(L"q"), Contains(L"") }),
+				Any({ Contains(L""), Contains(L"b") }),
+				Any({ ContainsAny(L""), Contains(L"b") }),
+				All({ }),
+			};
+
+			for (const auto& filter : filters)
+			{
+				TextTree expected;
+				FilterTree(tree, expected, filter);
+
+				TextTree optimized;
+				FilterTree(tree, optimized, OptimizeFilter(filter));
+
+				wostringstream expectedStream;
+				expectedStream << expected;
+
+				wostringstream optimizedStream;
+				optimizedStream << optimized;
+
+				Assert::AreEqual(expectedStream.str().c_str(), optimizedStream.str().c_str());
+			}
+		}
+	};
+}
@@ -1,7 +1,9 @@
 #include "TreeFilter.h"
+#include "TreeFilterCompiler.h"
 #include "TreeReaderTestHelpers.h"
 #include "CppUnitTest.h"
 
+#include <future>
 #include <sstream>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -30,7 +32,7 @@ namespace TreeReaderTests
       {
          TextTree tree = CreateSimpleTree();
          TextTree filtered;
-         FilterTree(tree, filtered, ExactAddress(tree.Roots[0]->TextPtr));
+         FilterTree(tree, filtered, ExactAddress(tree.GetText(tree.GetFirstChild(InvalidNode)).data()));
 
          wostringstream sstream;
          sstream << filtered;
@@ -85,6 +87,60 @@ namespace TreeReaderTests
          Assert::AreEqual(expectedOutput, sstream.str().c_str());
       }
 
+      TEST_METHOD(PrintSimpleTreeWithNestedIfSubTreeFilter)
+      {
+         TextTree filtered;
+         FilterTree(CreateSimpleTree(), filtered, IfSubTree(IfSubTree(Contains(L"w"))));
+
+         wostringstream sstream;
+         sstream << filtered;
+
+         const wchar_t expectedOutput[] =
+            L"abc\n"
+            L"  ghi\n"
+            L"    mno\n";
+         Assert::AreEqual(expectedOutput, sstream.str().c_str());
+      }
+
+      TEST_METHOD(PrintSimpleTreeWithIfSubTreeFilterAfterEditingSubFilter)
+      {
+         const TextTree tree = CreateSimpleTree();
+         auto contains = Contains(L"k");
+         auto filter = IfSubTree(contains);
+
+         TextTree filtered;
+         FilterTree(tree, filtered, filter);
+
+         wostringstream sstream;
+         sstream << filtered;
+         Assert::AreEqual(L"abc\n  def\n", sstream.str().c_str());
+
+         // The matches found while filtering before must not be reused.
+         contains->Contained = L"w";
+         FilterTree(tree, filtered, filter);
+
+         sstream.str(L"");
+         sstream << filtered;
+         Assert::AreEqual(L"abc\n  ghi\n    mno\n      stu\n", sstream.str().c_str());
+      }
+
+      TEST_METHOD(FilterDeepTreeWithIfSubTreeFilter)
+      {
+         auto textLines = CreateTextLines();
+
+         // A single branch where only the deepest node matches.
+         const size_t depth = 100000;
+         TextTree tree;
+         tree.SourceTextLines = textLines;
+         NodeIndex node = InvalidNode;
+         for (size_t i = 0; i < depth; ++i)
+            node = tree.AddChild(node, textLines->Lines[i + 1 < depth ? 0 : 7]);
+
+         TextTree filtered;
+         FilterTree(tree, filtered, IfSubTree(Contains(L"w")));
+         Assert::AreEqual(depth - 1, filtered.CountNodes());
+      }
+
       TEST_METHOD(PrintSimpleTreeWithIfSiblingFilter)
       {
          TextTree filtered;
@@ -99,6 +155,26 @@ namespace TreeReaderTests
          Assert::AreEqual(expectedOutput, sstream.str().c_str());
       }
 
+      TEST_METHOD(FilterWideTreeWithIfSiblingFilter)
+      {
+         auto textLines = CreateTextLines();
+
+         // Many roots where only the last one matches, with children that never match.
+         const size_t width = 200000;
+         TextTree tree;
+         tree.SourceTextLines = textLines;
+         for (size_t i = 0; i < width; ++i)
+         {
+            const NodeIndex root = tree.AddChild(InvalidNode, textLines->Lines[i + 1 < width ? 0 : 7]);
+            tree.AddChild(root, textLines->Lines[1]);
+         }
+
+         TextTree filtered;
+         FilterTree(tree, filtered, IfSibling(Contains(L"w")));
+         Assert::AreEqual(width, filtered.CountNodes());
+         Assert::AreEqual(width, filtered.CountChildren(InvalidNode));
+      }
+
       TEST_METHOD(PrintSimpleTreeWithOrFilter)
 		{
 			TextTree filtered;
@@ -323,5 +399,174 @@ namespace TreeReaderTests
          Assert::AreEqual(expectedOutput, sstream.str().c_str());
       }
 
+      TEST_METHOD(FilterTreeInParallelKeepsSameNodes)
+      {
+         vector<string> lines;
+         vector<NodeIndex> parents;
+         for (size_t i = 0; i < 100000; ++i)
+         {
+            lines.emplace_back((i % 5) ? "child " + to_string(i) : "root " + to_string(i));
+            parents.emplace_back((i % 5 == 0) ? InvalidNode : (i % 5 == 1) ? NodeIndex(i - 1) : NodeIndex(i - i % 5 + 1));
+         }
+
+         TextTree tree;
+         tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+         tree.Freeze();
+
+         const vector<TreeFilterPtr> filters =
+         {
+            Contains(L"7"),
+            Not(Regex(L"[13]$")),
+            Under(Contains(L"99"), false),
+            CountChildren(Contains(L"5"), 2),
+            IfSubTree(Contains(L"42")),
+            And(LevelRange(1, 1), NoChild(Contains(L"6"))),
+            CountSiblings(Contains(L"3"), 1),
+            Or(Until(Contains(L"99999")), Contains(L"8")),
+            IfSibling(Contains(L"root 99995")),
+            IfSibling(Contains(L"child 4243")),
+         };
+
+         // Counting siblings and stopping depend on the roots filtered before.
+         Assert::IsTrue(CompileFilter(filters[5])->CanFilterRootsSeparately());
+         Assert::IsFalse(CompileFilter(filters[6])->CanFilterRootsSeparately());
+         Assert::IsFalse(CompileFilter(filters[7])->CanFilterRootsSeparately());
+         Assert::IsTrue(CompileFilter(filters[8])->CanFilterRootsSeparately());
+
+         // Note: the threads share the nodes found in the index.
+         const auto index = make_shared<const TextTreeIndex>(tree);
+
+         for (const auto& filter : filters)
+         {
+            TextTree expected;
+            FilterTree(tree, expected, filter, {}, 1);
+
+            wostringstream expectedStream;
+            expectedStream << expected;
+
+            for (const auto& filterIndex : { shared_ptr<const TextTreeIndex>(), index })
+            {
+               TextTree filtered;
+               FilterTree(tree, filtered, filter, filterIndex, 4);
+
+               Assert::IsTrue(filtered.IsFrozen());
+
+               wostringstream filteredStream;
+               filteredStream << filtered;
+
+               Assert::AreEqual(expectedStream.str().c_str(), filteredStream.str().c_str());
+            }
+         }
+
+         TextTree expected;
+         FilterTree(tree, expected, filters[0], {}, 1);
+
+         auto [fut, abort] = FilterTreeAsync(make_shared<TextTree>(tree), filters[0], {}, 4);
+         Assert::AreEqual(expected.CountNodes(), fut.get().CountNodes());
+      }
+
+      TEST_METHOD(FilterTreeWithProgress)
+      {
+         vector<string> lines;
+         vector<NodeIndex> parents;
+         for (size_t i = 0; i < 100000; ++i)
+         {
+            lines.emplace_back((i % 5) ? "child " + to_string(i) : "root " + to_string(i));
+            parents.emplace_back((i % 5) ? NodeIndex(i - i % 5) : InvalidNode);
+         }
+
+         TextTree tree;
+         tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+         tree.Freeze();
+
+         for (const size_t threadCount : { 1, 4 })
+         {
+            OperationProgress progress;
+            TextTree filtered;
+            FilterTree(tree, filtered, IfSubTree(Contains(L"42")), {}, threadCount, &progress);
+
+            Assert::AreEqual(tree.CountNodes(), progress.GetTotal());
+            Assert::AreEqual(tree.CountNodes(), progress.GetDone());
+            Assert::AreEqual(1., progress.GetFraction());
+            Assert::IsFalse(filtered.IsEmpty());
+
+            // A cancelled filtering stops right away.
+            OperationProgress cancelled;
+            cancelled.Cancel();
+            TextTree stopped;
+            FilterTree(tree, stopped, IfSubTree(Contains(L"42")), {}, threadCount, &cancelled);
+
+            Assert::IsTrue(stopped.IsEmpty());
+            Assert::AreEqual<size_t>(0, cancelled.GetDone());
+         }
+
+         TextTree expected;
+         FilterTree(tree, expected, Contains(L"42"));
+
+         // The cancelled asynchronous filtering stops early, keeping at most the same nodes.
+         auto [fut, progress] = FilterTreeAsync(make_shared<TextTree>(tree), Contains(L"42"));
+         progress->Cancel();
+         Assert::IsTrue(fut.get().CountNodes() <= expected.CountNodes());
+         Assert::IsTrue(progress->IsCancelled());
+      }
+
+      TEST_METHOD(FilterTreeWithSameFilterInManyThreads)
+      {
+         vector<string> lines;
+         vector<NodeIndex> parents;
+         for (size_t i = 0; i < 30000; ++i)
+         {
+            lines.emplace_back((i % 3) ? "child " + to_string(i) : "root " + to_string(i));
+            parents.emplace_back((i % 3) ? NodeIndex(i - i % 3) : InvalidNode);
+         }
+
+         TextTree tree;
+         tree.AddNodes(vector<string_view>(lines.begin(), lines.end()), parents);
+
+         // All the filters that remember what they have seen while filtering.
+         const TreeFilterPtr filter = Any(
+         {
+            Under(Contains(L"77"), false),
+            CountSiblings(Contains(L"5"), 1),
+            CountChildren(Regex(L"root .*3$"), 1),
+            IfSubTree(Contains(L"99")),
+            IfSubTree(Under(Contains(L"88"))),
+            IfSibling(Regex(L"child .*42")),
+         });
+
+         TextTree expected;
+         FilterTree(tree, expected, filter);
+
+         wostringstream expectedStream;
+         expectedStream << expected;
+
+         // The filter and its compiled form are both used by many threads at once.
+         const TreeFilterPtr compiled = CompileFilter(filter);
+         vector<future<wstring>> results;
+         for (size_t i = 0; i < 8; ++i)
+         {
+            results.emplace_back(async(launch::async, [&tree, &filter, &compiled, i]()
+            {
+               TextTree filtered;
+               if (i % 2)
+               {
+                  FilterTreeVisitor visitor(tree, filtered, filter);
+                  VisitInOrder(tree, visitor);
+               }
+               else
+               {
+                  FilterTree(tree, filtered, compiled);
+               }
+
+               wostringstream stream;
+               stream << filtered;
+               return stream.str();
+            }));
+         }
+
+         for (auto& result : results)
+            Assert::AreEqual(expectedStream.str().c_str(), result.get().c_str());
+      }
+
    };
 }
@@ -41,5 +41,20 @@ namespace TreeReaderTests
 			Assert::AreEqual(wstring(L"aaa bbb ccc"), join(vector<wstring>{ L"aaa", L"bbb", L"ccc" }));
 			Assert::AreEqual(wstring(L"aaa,bbb,ccc"), join(vector<wstring>{ L"aaa", L"bbb", L"ccc" }, L','));
 		}
+
+		TEST_METHOD(ConvertUtf8)
+		{
+			Assert::AreEqual(string("abc"), ConvertToUtf8(L"abc"));
+			Assert::AreEqual(string("h\xC3\xA9t\xE2\x82\xAC\xF0\x9F\x98\x80"), ConvertToUtf8(L"h\u00E9t\u20AC\U0001F600"));
+
+			Assert::AreEqual(wstring(L"abc"), ConvertFromUtf8("abc"));
+			Assert::AreEqual(wstring(L"h\u00E9t\u20AC\U0001F600"), ConvertFromUtf8("h\xC3\xA9t\xE2\x82\xAC\xF0\x9F\x98\x80"));
+		}
+
+		TEST_METHOD(ConvertInvalidUtf8AsLatin1)
+		{
+			Assert::AreEqual(wstring(L"h\u00E9t\u00E9"), ConvertFromUtf8("h\xE9t\xE9"));
+			Assert::AreEqual(wstring(L"\u00C3"), ConvertFromUtf8("\xC3"));
+		}
 	};
 }
@@ -9,14 +9,14 @@ namespace TreeReaderTests
 	{
 		auto textLines = make_shared<TextLinesTextHolder>();
 
-		textLines->Lines.push_back(L"abc");
-		textLines->Lines.push_back(L"def");
-		textLines->Lines.push_back(L"ghi");
-		textLines->Lines.push_back(L"jkl");
-		textLines->Lines.push_back(L"mno");
-		textLines->Lines.push_back(L"pqr");
-		textLines->Lines.push_back(L"stu");
-		textLines->Lines.push_back(L"vwx");
+		textLines->Lines.push_back("abc");
+		textLines->Lines.push_back("def");
+		textLines->Lines.push_back("ghi");
+		textLines->Lines.push_back("jkl");
+		textLines->Lines.push_back("mno");
+		textLines->Lines.push_back("pqr");
+		textLines->Lines.push_back("stu");
+		textLines->Lines.push_back("vwx");
 
 		return textLines;
 	}
@@ -28,7 +28,7 @@ namespace TreeReaderTests
        auto textLines = CreateTextLines();
        textTree.SourceTextLines = textLines;
 
-		 auto r0 = textTree.AddChild(nullptr, textLines->Lines.at(0).c_str());
+		 auto r0 = textTree.AddChild(InvalidNode, textLines->Lines.at(0).c_str());
 		 auto r0c0 = textTree.AddChild(r0, textLines->Lines.at(1).c_str());
 		 auto r0c1 = textTree.AddChild(r0, textLines->Lines.at(2).c_str());
 		 auto r0c0c0 = textTree.AddChild(r0c0, textLines->Lines.at(3).c_str());